@@ -20,19 +20,198 @@
 #define UNITY_UTIL_FILEIO_H
 
 #include <unity/SymbolExport.h>
+#include <unity/util/NonCopyable.h>
 
+#include <cstddef>
+#include <functional>
 #include <string>
 #include <vector>
 
+struct stat;
+
 namespace unity
 {
 
 namespace util
 {
 
+/**
+\brief Reads the whole of a regular file or pipe.
+
+Files that report a size of zero, such as those in /proc and /sys, are read until
+the end of the file.
+\throws FileException The file cannot be opened or read, or is neither a regular file nor a pipe.
+*/
 UNITY_API std::string read_text_file(std::string const& filename);
 UNITY_API std::vector<uint8_t> read_binary_file(std::string const& filename);
 
+/** The outcome of reading one file with read_files(). */
+struct FileReadResult
+{
+    /** The contents of the file, if it could be read. */
+    std::string contents;
+    /** The error message if the file could not be read; empty otherwise. */
+    std::string error;
+};
+
+/**
+\brief Reads many files concurrently.
+
+The files are read with read_text_file() on a pool of at most <code>max_threads</code>
+threads; zero uses one thread per core, but at least eight, because the threads
+spend most of their time waiting for the disk. This hides the latency of opening
+and reading many small files on a cold cache.
+
+The result has one entry per file name, in the same order. A file that cannot be
+read does not stop the others from being read; its error is reported in its entry.
+*/
+UNITY_API std::vector<FileReadResult> read_files(std::vector<std::string> const& filenames,
+                                                 unsigned max_threads = 0);
+
+/**
+\brief Reads a regular file or pipe in chunks of <code>chunk_size</code> bytes.
+
+Each chunk is passed to <code>callback</code>, which returns true to continue or false
+to stop reading. Every chunk except the last one is exactly <code>chunk_size</code>
+bytes long. The callback is not called for an empty file. The chunk is only valid for
+the duration of the call. Memory use does not depend on the size of the file.
+\throws InvalidArgumentException <code>chunk_size</code> is zero.
+\throws FileException The file cannot be opened or read, or is neither a regular file nor a pipe.
+*/
+UNITY_API void read_file_chunks(std::string const& filename,
+                                std::function<bool(char const* data, std::size_t size)> const& callback,
+                                std::size_t chunk_size = 64 * 1024);
+
+/**
+\brief Read-only memory mapping of a file, as returned by map_file().
+
+The contents of the file are accessed directly from the page cache, without
+copying them to the heap. The mapping is released when the MappedFile is destroyed.
+An empty file has no mapping: data() returns nullptr and size() returns 0.
+
+The mapping is private, but changes that other processes make to the file may still
+become visible through it. Truncating the file while it is mapped causes SIGBUS on
+access to the pages beyond the new end of the file, so only map files that are
+replaced rather than rewritten in place.
+*/
+
+class UNITY_API MappedFile final
+{
+public:
+    /// @cond
+    NONCOPYABLE(MappedFile);
+    /// @endcond
+
+    /** Constructs an empty instance. */
+    MappedFile() noexcept;
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+    ~MappedFile() noexcept;
+
+    char const* data() const noexcept
+    {
+        return data_;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    char const* begin() const noexcept
+    {
+        return data_;
+    }
+
+    char const* end() const noexcept
+    {
+        return data_ + size_;
+    }
+
+    /** Returns a copy of the contents. */
+    std::string str() const
+    {
+        return std::string(data_, size_);
+    }
+
+private:
+    MappedFile(char const* data, std::size_t size) noexcept;
+
+    char const* data_;
+    std::size_t size_;
+
+    friend UNITY_API MappedFile map_file(std::string const& filename);
+};
+
+/**
+\brief Maps a regular file into memory for reading.
+\throws FileException The file cannot be opened, is not a regular file, or cannot be mapped.
+*/
+UNITY_API MappedFile map_file(std::string const& filename);
+
+/** How far write_text_file() and related functions go to make the new contents durable. */
+enum class SyncPolicy
+{
+    /** No fsync(). The file is still replaced atomically, but a crash can lose the new contents. */
+    None,
+    /** fsync() the new contents before they replace the file. */
+    File,
+    /** As for File, and also fsync() the directory, so that the replacement itself survives a crash. */
+    FileAndDirectory
+};
+
+/**
+\brief Replaces the contents of a file atomically.
+
+The new contents are written to a temporary file in the same directory, which is
+then renamed over <code>filename</code>. Readers see either the old or the new
+contents, never a mix of the two. Where the kernel and file system support it,
+the temporary file is created with O_TMPFILE, so it has no name until it is
+complete, and nothing is left behind if the process is killed while writing.
+
+If <code>filename</code> exists, its permission bits are copied to the new file;
+otherwise, the file is created with mode 0666, less the umask. Ownership and
+extended attributes are not preserved.
+
+If <code>written</code> is not null, it receives the status of the new file, taken
+with fstat() before the file is renamed into place. Unlike a stat() of
+<code>filename</code> after the call, this identifies the file that was written
+even if another process replaces it in the meantime.
+\throws FileException The file cannot be written.
+*/
+UNITY_API void write_text_file(std::string const& filename,
+                               std::string const& contents,
+                               SyncPolicy policy = SyncPolicy::File,
+                               struct ::stat* written = nullptr);
+UNITY_API void write_binary_file(std::string const& filename,
+                                 std::vector<uint8_t> const& contents,
+                                 SyncPolicy policy = SyncPolicy::File,
+                                 struct ::stat* written = nullptr);
+
+/** One piece of the contents for write_file_chunks(). */
+struct FileChunk
+{
+    const void* data;
+    std::size_t size;
+};
+
+/**
+\brief Replaces the contents of a file atomically with the concatenation of <code>chunks</code>.
+
+This behaves like write_text_file(), but writes the chunks with writev(), so a large
+payload that is assembled from several buffers does not need to be copied into one.
+\throws FileException The file cannot be written.
+*/
+UNITY_API void write_file_chunks(std::string const& filename,
+                                 std::vector<FileChunk> const& chunks,
+                                 SyncPolicy policy = SyncPolicy::File,
+                                 struct ::stat* written = nullptr);
+
 } // namespace util
 
 } // namespace unity
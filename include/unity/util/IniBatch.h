@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INIBATCH_H
+#define UNITY_UTIL_INIBATCH_H
+
+#include <unity/SymbolExport.h>
+#include <unity/util/NonCopyable.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+class IniParser;
+
+namespace internal
+{
+struct IniBatchPrivate;
+}
+
+/**
+\brief A set of changes that is applied to an IniParser as a whole.
+
+IniParser::batch() returns an empty batch. The set and remove methods of the batch
+only record changes; they neither lock nor modify the parser. commit() then applies
+all recorded changes while it holds the parser's lock once, so readers, sync(), and
+background writes see either none or all of the changes, never part of them:
+
+~~~
+auto batch = parser.batch();
+batch.set_int("Window", "x", x);
+batch.set_int("Window", "y", y);
+batch.set_int("Window", "width", width);
+batch.set_int("Window", "height", height);
+batch.commit(true);  // Apply and write the file once.
+~~~
+
+The set methods have the same semantics as the corresponding IniParser methods.
+Unlike IniParser::remove_group() and IniParser::remove_key(), removing a group or
+key that does not exist is not an error. Changes are applied in the order in which
+they were recorded. Destroying a batch without committing it discards its changes.
+
+A batch must not outlive its parser, and it must not be used by more than one
+thread at a time. After commit(), the batch is empty and can be reused.
+*/
+
+class UNITY_API IniBatch final
+{
+public:
+    /// @cond
+    NONCOPYABLE(IniBatch);
+    /// @endcond
+
+    IniBatch(IniBatch&&) noexcept;
+    IniBatch& operator=(IniBatch&&) noexcept;
+    ~IniBatch() noexcept;
+
+    void remove_group(const std::string& group);
+    void remove_key(const std::string& group, const std::string& key);
+
+    void set_string(const std::string& group, const std::string& key, const std::string& value);
+    void set_locale_string(const std::string& group,
+                           const std::string& key,
+                           const std::string& value,
+                           const std::string& locale = std::string());
+    void set_boolean(const std::string& group, const std::string& key, bool value);
+    void set_int(const std::string& group, const std::string& key, int value);
+    void set_double(const std::string& group, const std::string& key, double value);
+
+    void set_string_array(const std::string& group, const std::string& key, const std::vector<std::string>& value);
+    void set_locale_string_array(const std::string& group,
+                                 const std::string& key,
+                                 const std::vector<std::string>& value,
+                                 const std::string& locale = std::string());
+    void set_boolean_array(const std::string& group, const std::string& key, const std::vector<bool>& value);
+    void set_int_array(const std::string& group, const std::string& key, const std::vector<int>& value);
+    void set_double_array(const std::string& group, const std::string& key, const std::vector<double>& value);
+
+    /** Returns the number of changes recorded since the batch was created or last committed. */
+    std::size_t size() const noexcept;
+
+    /** Discards the recorded changes. */
+    void clear() noexcept;
+
+    /**
+    \brief Applies the recorded changes to the parser under a single lock acquisition.
+
+    If <code>sync</code> is true, the parser then writes its unsaved changes, as IniParser::sync() does.
+    \throws FileException or LogicException The file cannot be written. The changes are applied
+    to the parser even in that case.
+    */
+    void commit(bool sync = false);
+
+private:
+    explicit IniBatch(IniParser& parser);
+
+    std::unique_ptr<internal::IniBatchPrivate> p;
+
+    friend class IniParser;
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
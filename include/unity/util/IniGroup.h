@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INIGROUP_H
+#define UNITY_UTIL_INIGROUP_H
+
+#include <unity/SymbolExport.h>
+#include <unity/util/DefinesPtrs.h>
+#include <unity/util/NonCopyable.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+class IniParser;
+
+namespace internal
+{
+struct IniGroupPrivate;
+}
+
+/**
+\brief Immutable snapshot of one group of an IniParser.
+
+IniParser::get_group() copies the keys and values of a group while it holds the
+parser's lock once. The snapshot does not refer back to the parser: later changes
+to the parser are not visible in the snapshot, and lookups on the snapshot do no
+locking. This makes it cheap to read many keys of the same group, such as the
+"Desktop Entry" group of a .desktop file.
+
+The read methods have the same semantics as the corresponding IniParser methods,
+including locale fallback for get_locale_string(). The get methods throw
+LogicException for missing keys or values of the wrong type; the try_get methods
+return false instead and leave <code>value</code> unchanged.
+
+All methods are thread-safe.
+*/
+
+class UNITY_API IniGroup final
+{
+public:
+    /// @cond
+    NONCOPYABLE(IniGroup);
+    UNITY_DEFINES_PTRS(IniGroup);
+    /// @endcond
+
+    IniGroup(IniGroup&&) noexcept;
+    IniGroup& operator=(IniGroup&&) noexcept;
+    ~IniGroup() noexcept;
+
+    /** Returns the name of the group. */
+    std::string name() const;
+
+    /** Returns the keys in the snapshot, in file order. */
+    std::vector<std::string> get_keys() const;
+
+    bool has_key(const std::string& key) const noexcept;
+
+    std::string get_string(const std::string& key) const;
+    std::string get_locale_string(const std::string& key, const std::string& locale = std::string()) const;
+    bool get_boolean(const std::string& key) const;
+    int get_int(const std::string& key) const;
+    double get_double(const std::string& key) const;
+
+    std::vector<std::string> get_string_array(const std::string& key) const;
+    std::vector<std::string> get_locale_string_array(const std::string& key,
+                                                     const std::string& locale = std::string()) const;
+    std::vector<bool> get_boolean_array(const std::string& key) const;
+    std::vector<int> get_int_array(const std::string& key) const;
+    std::vector<double> get_double_array(const std::string& key) const;
+
+    bool try_get_string(const std::string& key, std::string& value) const;
+    bool try_get_locale_string(const std::string& key,
+                               std::string& value,
+                               const std::string& locale = std::string()) const;
+    bool try_get_boolean(const std::string& key, bool& value) const noexcept;
+    bool try_get_int(const std::string& key, int& value) const noexcept;
+    bool try_get_double(const std::string& key, double& value) const noexcept;
+
+    bool try_get_string_array(const std::string& key, std::vector<std::string>& value) const;
+    bool try_get_locale_string_array(const std::string& key,
+                                     std::vector<std::string>& value,
+                                     const std::string& locale = std::string()) const;
+    bool try_get_boolean_array(const std::string& key, std::vector<bool>& value) const;
+    bool try_get_int_array(const std::string& key, std::vector<int>& value) const;
+    bool try_get_double_array(const std::string& key, std::vector<double>& value) const;
+
+private:
+    IniGroup(internal::IniGroupPrivate* d) noexcept;
+
+    std::unique_ptr<internal::IniGroupPrivate> p;
+
+    friend class IniParser;
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INIKEY_H
+#define UNITY_UTIL_INIKEY_H
+
+#include <unity/SymbolExport.h>
+
+#include <cstdint>
+#include <string>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+struct IniKeyAccess;
+}
+
+/**
+\brief Pre-resolved (group, key) pair for repeated IniParser lookups.
+
+An IniKey hashes its group and key names once, when it is constructed. Lookups that
+pass an IniKey to an IniParser use the stored hashes instead of hashing the names
+again, and compare names only when the hashes match. An IniKey is not tied to a
+particular parser, so a single instance can be used with any number of parsers,
+for example:
+
+~~~
+static const IniKey name_key("Desktop Entry", "Name");
+
+for (auto const& file : files)
+{
+    IniParser parser(file.c_str(), IniParser::Engine::Native);
+    cout << parser.get_locale_string(name_key) << endl;
+}
+~~~
+
+The speed-up applies to the native engine; with the GKeyFile engine, an IniKey
+only saves the construction of temporary strings at the call site.
+
+IniKey is an immutable value type and is safe to share between threads.
+*/
+
+class UNITY_API IniKey final
+{
+public:
+    IniKey(std::string group, std::string key);
+
+    IniKey(IniKey const&) = default;
+    IniKey(IniKey&&) = default;
+    IniKey& operator=(IniKey const&) = default;
+    IniKey& operator=(IniKey&&) = default;
+    ~IniKey() = default;
+
+    const std::string& group() const noexcept
+    {
+        return group_;
+    }
+
+    const std::string& key() const noexcept
+    {
+        return key_;
+    }
+
+private:
+    std::string group_;
+    std::string key_;
+    std::uint32_t group_hash_;
+    std::uint32_t key_hash_;
+
+    friend struct internal::IniKeyAccess;
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
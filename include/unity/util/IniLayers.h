@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UNITY_UTIL_INILAYERS_H
+#define UNITY_UTIL_INILAYERS_H
+
+#include <unity/SymbolExport.h>
+#include <unity/util/DefinesPtrs.h>
+#include <unity/util/IniParser.h>
+#include <unity/util/NonCopyable.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+struct IniLayersPrivate;
+}
+
+/**
+\brief Merged, read-only view of several IniParser instances in order of precedence.
+
+A setting that exists in more than one layer is taken from the first layer that has it,
+so the user's configuration can override system-wide defaults without a chain of lookups
+that each throw on a miss:
+
+~~~
+auto config = IniLayers::from_xdg("myapp/myapp.conf");
+int size = config->get_int_or("Window", "size", 100);
+~~~
+
+The view keeps a merged table that maps each group and key to the raw value of the layer
+that supplies it, so a lookup is a single hash table probe no matter how many layers there
+are. The table is kept up to date incrementally: when a layer is reloaded (by
+IniParser::reload() or a watch()), only the keys that the reload reports as changed are
+merged again, and when a layer is changed with its set or remove methods or an IniBatch,
+only the keys that were changed are.
+
+The read methods have the same semantics as the corresponding IniParser methods. For a
+localized string, the layer that supplies it is the first one that has the key, either
+untranslated or in a translation for one of the variants of the locale; the best match
+within that layer is returned. So a translation in a system-wide layer does not override
+an untranslated value set by the user. The get
+methods throw LogicException for keys that are missing from every layer or values of the
+wrong type; the try_get methods return false instead and leave <code>value</code> unchanged.
+
+All methods are thread-safe.
+*/
+
+class UNITY_API IniLayers final
+{
+public:
+    /// @cond
+    NONCOPYABLE(IniLayers);
+    UNITY_DEFINES_PTRS(IniLayers);
+    /// @endcond
+
+    /**
+    \brief Merges the given parsers. The first parser takes precedence over the second, and so on.
+    \throws InvalidArgumentException One of the parsers is null.
+    */
+    explicit IniLayers(std::vector<IniParser::SPtr> layers);
+
+    /**
+    \brief Loads a configuration file from the XDG configuration directories.
+
+    The layers are <code>$XDG_CONFIG_HOME/name</code>, followed by <code>name</code> in
+    each of the directories in <code>$XDG_CONFIG_DIRS</code>, in that order. Files that
+    do not exist are skipped; if none exists, the view is empty.
+    \throws FileException One of the files cannot be read or is not a valid ini file.
+    */
+    static UPtr from_xdg(const std::string& name, IniParser::Engine engine = IniParser::Engine::GKeyFile);
+
+    ~IniLayers() noexcept;
+
+    /** Returns the number of layers. */
+    std::size_t size() const noexcept;
+
+    /** Returns a layer. The layer with index 0 takes precedence over all others. */
+    IniParser::SPtr layer(std::size_t index) const;
+
+    /** Returns the index of the layer that supplies a key, or -1 if no layer has the key. */
+    int layer_of(const std::string& group, const std::string& key) const noexcept;
+
+    /** Returns the groups of all layers, in sorted order. */
+    std::vector<std::string> get_groups() const;
+    /** Returns the keys of a group in all layers, in sorted order. */
+    std::vector<std::string> get_keys(const std::string& group) const;
+
+    bool has_group(const std::string& group) const noexcept;
+    bool has_key(const std::string& group, const std::string& key) const noexcept;
+
+    std::string get_string(const std::string& group, const std::string& key) const;
+    std::string get_locale_string(const std::string& group,
+                                  const std::string& key,
+                                  const std::string& locale = std::string()) const;
+    bool get_boolean(const std::string& group, const std::string& key) const;
+    int get_int(const std::string& group, const std::string& key) const;
+    double get_double(const std::string& group, const std::string& key) const;
+
+    std::vector<std::string> get_string_array(const std::string& group, const std::string& key) const;
+    std::vector<std::string> get_locale_string_array(const std::string& group,
+                                                     const std::string& key,
+                                                     const std::string& locale = std::string()) const;
+    std::vector<bool> get_boolean_array(const std::string& group, const std::string& key) const;
+    std::vector<int> get_int_array(const std::string& group, const std::string& key) const;
+    std::vector<double> get_double_array(const std::string& group, const std::string& key) const;
+
+    bool try_get_string(const std::string& group, const std::string& key, std::string& value) const;
+    bool try_get_locale_string(const std::string& group,
+                               const std::string& key,
+                               std::string& value,
+                               const std::string& locale = std::string()) const;
+    bool try_get_boolean(const std::string& group, const std::string& key, bool& value) const noexcept;
+    bool try_get_int(const std::string& group, const std::string& key, int& value) const noexcept;
+    bool try_get_double(const std::string& group, const std::string& key, double& value) const noexcept;
+
+    bool try_get_string_array(const std::string& group, const std::string& key, std::vector<std::string>& value) const;
+    bool try_get_locale_string_array(const std::string& group,
+                                     const std::string& key,
+                                     std::vector<std::string>& value,
+                                     const std::string& locale = std::string()) const;
+    bool try_get_boolean_array(const std::string& group, const std::string& key, std::vector<bool>& value) const;
+    bool try_get_int_array(const std::string& group, const std::string& key, std::vector<int>& value) const;
+    bool try_get_double_array(const std::string& group, const std::string& key, std::vector<double>& value) const;
+
+    std::string get_string_or(const std::string& group,
+                              const std::string& key,
+                              const std::string& default_value) const;
+    std::string get_locale_string_or(const std::string& group,
+                                     const std::string& key,
+                                     const std::string& default_value,
+                                     const std::string& locale = std::string()) const;
+    bool get_boolean_or(const std::string& group, const std::string& key, bool default_value) const noexcept;
+    int get_int_or(const std::string& group, const std::string& key, int default_value) const noexcept;
+    double get_double_or(const std::string& group, const std::string& key, double default_value) const noexcept;
+
+    /**
+    \brief Merges a layer again.
+
+    Only the keys that the layer has now, or supplied before, are merged again. Changes
+    to a layer are merged as they happen, so this is not needed to see them.
+    */
+    void update(std::size_t index);
+
+    /**
+    \brief Calls IniParser::reload() for every layer. The merged table is updated for each
+    layer that was reloaded.
+    \return True if any layer was reloaded.
+    \throws FileException A file cannot be read or is not a valid ini file. The layers
+    before it have been reloaded in that case.
+    \throws LogicException A layer was not loaded from a file.
+    */
+    bool reload();
+
+private:
+    std::shared_ptr<internal::IniLayersPrivate> p;  // Shared with the change callbacks of the layers.
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
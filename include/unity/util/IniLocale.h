@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INILOCALE_H
+#define UNITY_UTIL_INILOCALE_H
+
+#include <unity/SymbolExport.h>
+
+#include <string>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+/**
+\brief Pre-computed locale fallback chain for IniParser lookups of translated keys.
+
+To look up a translated key, such as "Name[de_DE]", GKeyFile expands the locale into
+its variants on every call. For example, "de_DE.UTF-8@euro" expands to eight variants,
+from "de_DE.UTF-8@euro" itself through "de_DE@euro" and "de_DE" down to "de", as
+returned by <code>g_get_locale_variants()</code>. An IniLocale does this once, when it
+is constructed. Lookups that
+pass an IniLocale to an IniParser probe the stored variants in order, and fall back to
+the untranslated key if none of them exists, for example:
+
+~~~
+const IniLocale locale("de_DE.UTF-8");
+
+for (auto const& parser : parsers)
+{
+    cout << parser->get_locale_string("Desktop Entry", "Name", locale) << endl;
+}
+~~~
+
+An IniLocale constructed from an empty string uses the languages of the current
+message locale, as returned by <code>g_get_language_names()</code> when the IniLocale
+is constructed. It does not follow later changes to the locale environment variables.
+
+IniLocale is an immutable value type and is safe to share between threads.
+*/
+
+class UNITY_API IniLocale final
+{
+public:
+    explicit IniLocale(std::string locale = std::string());
+
+    IniLocale(IniLocale const&) = default;
+    IniLocale(IniLocale&&) = default;
+    IniLocale& operator=(IniLocale const&) = default;
+    IniLocale& operator=(IniLocale&&) = default;
+    ~IniLocale() = default;
+
+    /**
+    \brief Returns the locale this IniLocale was constructed from.
+    */
+    const std::string& name() const noexcept
+    {
+        return name_;
+    }
+
+    /**
+    \brief Returns the variants of the locale, in the order in which they are looked up.
+    */
+    const std::vector<std::string>& variants() const noexcept
+    {
+        return variants_;
+    }
+
+private:
+    std::string name_;
+    std::vector<std::string> variants_;
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
@@ -21,8 +21,18 @@
 
 #include <unity/SymbolExport.h>
 #include <unity/util/DefinesPtrs.h>
-
+#include <unity/util/IniBatch.h>
+#include <unity/util/IniGroup.h>
+#include <unity/util/IniKey.h>
+#include <unity/util/IniLocale.h>
+#include <unity/util/IniVisitor.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace unity
@@ -33,6 +43,7 @@ namespace util
 
 namespace internal
 {
+struct IniLayersPrivate;
 struct IniParserPrivate;
 }
 
@@ -61,17 +72,61 @@ The array methods use a semicolon as a separator.
 
 To write unsaved changes back to the configuration file, call
 sync(). The sync() method will throw a FileException if it
-fails to write to file.
+fails to write to file. For data that changes frequently,
+sync_async() writes on a background thread and folds repeated
+calls into a single write; flush() waits for that write.
 
 The get methods indicate errors by throwing LogicException.
 
-All methods are thread-safe.
+By default, files are parsed with GKeyFile. Passing Engine::Native to the
+constructor selects a read-optimized engine instead: the file is mapped
+into memory and indexed by offset, so loading does not copy any group,
+key, or value, and a value is only converted when it is requested. Both
+engines accept the same syntax and return the same results. The native
+engine hands its data to GKeyFile on the first call to a write method,
+so all methods are available regardless of the engine.
+
+Engine::Lazy goes one step further for files of which only a few groups
+are read, such as a .desktop file with many "Desktop Action" groups: it
+indexes only the group headers when the file is loaded, and parses the
+keys of a group the first time the group is read. Groups that are never
+read cost neither time nor memory. Because the body of a group is only
+checked when it is parsed, an invalid line in a group is not reported by
+the constructor; instead, reading from that group throws LogicException
+(and the try_get methods return false).
+
+All methods are thread-safe. Each instance has its own reader/writer lock:
+the read methods of an instance can run concurrently with each other, while
+the write methods have exclusive access to the instance. sync() holds the lock
+only while it serializes the data, not while it writes the file. Separate
+instances never contend with each other. Readers that must never wait for a
+writer, such as a thread that handles input, can read from snapshot() instead.
 */
 
 class UNITY_API IniParser final {
 public:
+    /** The parser that backs an instance. */
+    enum class Engine
+    {
+        GKeyFile, /**< Load the file with GKeyFile. */
+        Native,   /**< Map the file and index it in place. */
+        Lazy      /**< Like Native, but parse the keys of each group only when the group is first read. */
+    };
+
     /** Parse the given file. */
     IniParser(const char* filename);
+    /** Parse the given file with the given engine. */
+    IniParser(const char* filename, Engine engine);
+    /**
+    \brief Parse the given file with the native engine, using a compiled cache.
+
+    The parser keeps a binary copy of the parsed file in <code>cache_dir</code>,
+    which is created if it does not exist. The cache file records the device, inode,
+    size, and modification time of the ini file; as long as they do not change, later
+    parsers map the cache file and do not parse the text at all. A stale or corrupt
+    cache file is ignored and replaced. Failure to write the cache is not an error.
+    */
+    IniParser(const char* filename, const std::string& cache_dir);
     ~IniParser() noexcept;
 
     /// @cond
@@ -81,6 +136,112 @@ public:
     IniParser() = delete;
     /// @endcond
 
+    /**
+    \brief Parse ini data that is already in memory.
+
+    The parser takes ownership of the string, so passing an rvalue (such as
+    the return value of read_text_file()) does not copy it again.
+    A parser created from data has no file to write back to; calling sync()
+    after modifying it throws LogicException.
+    \throws FileException The data is not a valid ini file.
+    */
+    static UPtr from_data(std::string data, Engine engine = Engine::GKeyFile);
+
+    /**
+    \brief Parse ini data from a byte buffer. The buffer is not referenced after the call returns.
+    \throws FileException The data is not a valid ini file.
+    */
+    static UPtr from_data(const void* data, std::size_t size, Engine engine = Engine::GKeyFile);
+
+    /**
+    \brief Parse ini data from an open file descriptor.
+
+    The descriptor remains owned by the caller. A regular file is loaded in full
+    (the native engine maps it); other descriptors, such as pipes, are read from
+    their current position until end of file. As for from_data(), sync() cannot
+    write a modified parser back.
+    \throws FileException The descriptor cannot be read or does not contain a valid ini file.
+    */
+    static UPtr from_fd(int fd, Engine engine = Engine::GKeyFile);
+
+    /** The result of load_all(). */
+    struct LoadResult
+    {
+        /** The parsers for the files that loaded successfully, by path. */
+        std::map<std::string, UPtr> parsers;
+        /** The error messages for the paths that could not be loaded, by path. */
+        std::map<std::string, std::string> errors;
+    };
+
+    /**
+    \brief Loads many files in parallel.
+
+    Each path can be a file or a directory. For a directory, every file in it (but
+    not in its subdirectories) whose name ends with <code>suffix</code> is loaded; an
+    empty suffix selects all files. Files are parsed on a pool of at most
+    <code>max_threads</code> worker threads; zero uses one thread per core.
+
+    A file that cannot be loaded does not stop the others from loading: its error
+    is reported in the result instead, and so is a path that does not exist or a
+    directory that cannot be read.
+
+    ~~~
+    auto result = IniParser::load_all({ "/usr/share/applications", "/usr/local/share/applications" },
+                                      ".desktop", IniParser::Engine::Native);
+    ~~~
+    */
+    static LoadResult load_all(const std::vector<std::string>& paths,
+                               const std::string& suffix = std::string(),
+                               Engine engine = Engine::GKeyFile,
+                               unsigned max_threads = 0);
+
+    /**
+    \brief Turns sharing of group and key names between parsers on or off.
+
+    Many files repeat the same names: every .desktop file has a "Desktop Entry" group
+    with keys such as Name, Exec, and Icon, and the same translated keys such as
+    "Name[de]". While sharing is on, each parser that is loaded with Engine::Native
+    interns its group and key names in a table that is shared by the whole process,
+    copies its values into a buffer of its own, and then releases the text of the
+    file. Each distinct name is stored once, no matter how many parsers use it.
+
+    Sharing costs some time while loading, and a parser that shares names does not
+    keep the comments and formatting of the file in memory: the first write method
+    that is called hands an equivalent file without comments to GKeyFile. sync()
+    still keeps the comments of the file on disk unless the file changed since it
+    was loaded. Names are never removed from the table. Engine::Lazy parsers and
+    parsers loaded with a compiled cache are not affected.
+
+    Sharing is off by default. Turning it on or off affects parsers that are loaded
+    from then on, including by reload().
+    */
+    static void share_names(bool enable) noexcept;
+
+    /** Size of the table of shared names. */
+    struct SharedNameStats
+    {
+        std::size_t names;  /**< Distinct names in the table. */
+        std::size_t bytes;  /**< Total length of the names. */
+    };
+
+    /** Returns the size of the table of shared names. */
+    static SharedNameStats shared_name_stats() noexcept;
+
+    /**
+    \brief Streams through an ini file without loading it into a parser.
+
+    The file is read in chunks of <code>chunk_size</code> bytes, and the callbacks of
+    <code>visitor</code> are called for each group, key, and comment as they are read.
+    Memory use does not grow with the size of the file: it is bounded by the chunk size
+    and the length of the longest line. This suits very large files that only need to be
+    scanned once, for example to build a custom index.
+
+    The syntax rules are those of the native engine. Lines before an invalid line have
+    already been reported when the error is thrown.
+    \throws FileException The file cannot be read, or contains an invalid line.
+    */
+    static void visit(const char* filename, IniVisitor& visitor, std::size_t chunk_size = 64 * 1024);
+
     //{@
 
     /** @name Read Methods
@@ -112,6 +273,165 @@ public:
     std::vector<std::string> get_groups() const;
     std::vector<std::string> get_keys(const std::string& group) const;
 
+    /** @name Enumeration Methods
+     * These member functions are alternatives to get_groups() and get_keys() that do not
+     * build a vector. They call <code>callback</code> with each name, in the same order,
+     * until the callback returns false. The name is passed as a pointer and a length; it is
+     * not NUL-terminated and is only valid for the duration of the call.<br>
+     * With the native engines, the names point into the parsed data, so no memory is
+     * allocated per name. With the GKeyFile engine, GLib copies the list of names once.<br>
+     * The callback runs while the parser's lock is held, so it must not call methods of
+     * the same parser. for_each_key() throws LogicException if the group does not exist.
+     **/
+
+    typedef std::function<bool(const char* name, std::size_t size)> NameCallback;
+
+    void for_each_group(const NameCallback& callback) const;
+    void for_each_key(const std::string& group, const NameCallback& callback) const;
+
+    /** @name Non-throwing Read Methods
+     * These member functions do not throw if a group or key does not exist, or if its value
+     * cannot be converted to the requested type.<br>
+     * The try_get methods return true and set <code>value</code> if the lookup succeeds;
+     * otherwise, they return false and leave <code>value</code> unchanged.<br>
+     * The get..._or methods return the value if the lookup succeeds, and <code>default_value</code>
+     * otherwise.<br>
+     * A missing group or key does not allocate memory, so these methods are suitable for
+     * optional keys on hot paths.
+     **/
+
+    bool try_get_string(const std::string& group, const std::string& key, std::string& value) const;
+    bool try_get_locale_string(const std::string& group,
+                               const std::string& key,
+                               std::string& value,
+                               const std::string& locale = std::string()) const;
+    bool try_get_boolean(const std::string& group, const std::string& key, bool& value) const noexcept;
+    bool try_get_int(const std::string& group, const std::string& key, int& value) const noexcept;
+    bool try_get_double(const std::string& group, const std::string& key, double& value) const noexcept;
+
+    bool try_get_string_array(const std::string& group,
+                              const std::string& key,
+                              std::vector<std::string>& value) const;
+    bool try_get_locale_string_array(const std::string& group,
+                                     const std::string& key,
+                                     std::vector<std::string>& value,
+                                     const std::string& locale = std::string()) const;
+    bool try_get_boolean_array(const std::string& group, const std::string& key, std::vector<bool>& value) const;
+    bool try_get_int_array(const std::string& group, const std::string& key, std::vector<int>& value) const;
+    bool try_get_double_array(const std::string& group, const std::string& key, std::vector<double>& value) const;
+
+    std::string get_string_or(const std::string& group,
+                              const std::string& key,
+                              const std::string& default_value) const;
+    std::string get_locale_string_or(const std::string& group,
+                                     const std::string& key,
+                                     const std::string& default_value,
+                                     const std::string& locale = std::string()) const;
+    bool get_boolean_or(const std::string& group, const std::string& key, bool default_value) const noexcept;
+    int get_int_or(const std::string& group, const std::string& key, int default_value) const noexcept;
+    double get_double_or(const std::string& group, const std::string& key, double default_value) const noexcept;
+
+    std::vector<std::string> get_string_array_or(const std::string& group,
+                                                 const std::string& key,
+                                                 const std::vector<std::string>& default_value) const;
+    std::vector<std::string> get_locale_string_array_or(const std::string& group,
+                                                        const std::string& key,
+                                                        const std::vector<std::string>& default_value,
+                                                        const std::string& locale = std::string()) const;
+    std::vector<bool> get_boolean_array_or(const std::string& group,
+                                           const std::string& key,
+                                           const std::vector<bool>& default_value) const;
+    std::vector<int> get_int_array_or(const std::string& group,
+                                      const std::string& key,
+                                      const std::vector<int>& default_value) const;
+    std::vector<double> get_double_array_or(const std::string& group,
+                                            const std::string& key,
+                                            const std::vector<double>& default_value) const;
+
+    /** @name Buffer Read Methods
+     * These member functions parse a list into a caller-provided buffer instead of a new vector.
+     * They split and convert the list in a single pass and store at most <code>buf_size</code>
+     * elements in <code>buf</code>. They return (or, for the try_get methods, set <code>count</code>
+     * to) the number of elements in the list, which is larger than <code>buf_size</code> if
+     * the list does not fit, so a caller can retry with a larger buffer:
+     *
+     * ~~~
+     * int buf[16];
+     * size_t n = parser.get_int_array("group", "key", buf, 16);
+     * vector<int> v(buf, buf + min(n, size_t(16)));
+     * ~~~
+     *
+     * Elements are validated even if they do not fit. With the native engine, these methods do
+     * not allocate memory unless an element contains an escape sequence. Errors are reported
+     * as for the corresponding methods that return a vector; after an error, <code>buf</code>
+     * may have been partially written.
+     **/
+
+    std::size_t get_boolean_array(const std::string& group, const std::string& key,
+                                  bool* buf, std::size_t buf_size) const;
+    std::size_t get_int_array(const std::string& group, const std::string& key,
+                              int* buf, std::size_t buf_size) const;
+    std::size_t get_double_array(const std::string& group, const std::string& key,
+                                 double* buf, std::size_t buf_size) const;
+
+    bool try_get_boolean_array(const std::string& group, const std::string& key,
+                               bool* buf, std::size_t buf_size, std::size_t& count) const;
+    bool try_get_int_array(const std::string& group, const std::string& key,
+                           int* buf, std::size_t buf_size, std::size_t& count) const;
+    bool try_get_double_array(const std::string& group, const std::string& key,
+                              double* buf, std::size_t buf_size, std::size_t& count) const;
+
+    /** @name Pre-resolved Key Lookups
+     * These member functions behave like the corresponding methods that take a group and a key,
+     * but use an IniKey that was constructed in advance. With the native engine, they do not hash
+     * the group and key names, which speeds up code that looks up the same keys in many files.
+     **/
+
+    bool has_key(const IniKey& key) const;
+    std::string get_string(const IniKey& key) const;
+    std::string get_locale_string(const IniKey& key, const std::string& locale = std::string()) const;
+    bool get_boolean(const IniKey& key) const;
+    int get_int(const IniKey& key) const;
+    double get_double(const IniKey& key) const;
+
+    bool try_get_string(const IniKey& key, std::string& value) const;
+    bool try_get_locale_string(const IniKey& key, std::string& value, const std::string& locale = std::string()) const;
+    bool try_get_boolean(const IniKey& key, bool& value) const noexcept;
+    bool try_get_int(const IniKey& key, int& value) const noexcept;
+    bool try_get_double(const IniKey& key, double& value) const noexcept;
+
+    /** @name Pre-computed Locale Lookups
+     * These member functions behave like the corresponding methods that take a locale name,
+     * but use an IniLocale that was constructed in advance. They probe the translated keys
+     * in the order given by IniLocale::variants() instead of expanding the locale again.
+     **/
+
+    std::string get_locale_string(const std::string& group, const std::string& key, const IniLocale& locale) const;
+    std::vector<std::string> get_locale_string_array(const std::string& group,
+                                                     const std::string& key,
+                                                     const IniLocale& locale) const;
+    bool try_get_locale_string(const std::string& group,
+                               const std::string& key,
+                               std::string& value,
+                               const IniLocale& locale) const;
+    bool try_get_locale_string_array(const std::string& group,
+                                     const std::string& key,
+                                     std::vector<std::string>& value,
+                                     const IniLocale& locale) const;
+    std::string get_locale_string(const IniKey& key, const IniLocale& locale) const;
+    bool try_get_locale_string(const IniKey& key, std::string& value, const IniLocale& locale) const;
+
+    /** @name Group Snapshots
+     * These member functions copy a group into an immutable IniGroup, taking the lock and
+     * walking the group only once. Further lookups on the snapshot do not lock the parser.<br>
+     * The second overload copies only the given keys, together with their translations
+     * (such as "Name[de]" for "Name"). Keys that do not exist are skipped.<br>
+     * A non-existent group throws LogicException.
+     **/
+
+    IniGroup get_group(const std::string& group) const;
+    IniGroup get_group(const std::string& group, const std::vector<std::string>& keys) const;
+
     /** @name Write Methods
      * These member functions provide write access to configuration entries by group and key.<br>
      * Attempts to remove groups or keys that do not exist throw LogicException.<br>
@@ -140,17 +460,149 @@ public:
     void set_int_array(const std::string& group, const std::string& key, const std::vector<int>& value);
     void set_double_array(const std::string& group, const std::string& key, const std::vector<double>& value);
 
-    /** @name Sync Method
-     * This member function writes unsaved changes back to the configuration file.<br>
-     * A failure to write to the file throws a FileException.
+    /**
+    \brief Returns an empty batch of changes for this parser.
+
+    Changes that are recorded in the batch are applied by IniBatch::commit() under a single
+    lock acquisition, so that no reader or sync sees only some of them.
+    */
+    IniBatch batch();
+
+    /**
+    \brief Returns an immutable snapshot of the current contents.
+
+    The first call turns snapshots on. From then on, every change, including
+    IniBatch::commit() and reload(), publishes a new snapshot before it releases the
+    lock, and snapshot() only loads the current one atomically. It never waits for the
+    lock, so a thread that reads through snapshots is not held up by writers or by a
+    sync() in progress. A snapshot never changes; call snapshot() again to see later changes.
+
+    A snapshot is a parser that uses the native engine and has no file. Publishing copies
+    and parses the contents once per change, which suits data that is read much more often
+    than it is changed. Use batch() to publish several changes at once.
+    */
+    SCPtr snapshot() const;
+
+    /** @name Sync Methods
+     * These member functions write unsaved changes back to the configuration file.<br>
+     * The file is replaced atomically: the data is written to a temporary file that is
+     * then renamed over the original, so readers never see a partially written file.<br>
+     * A failure to write to the file throws a FileException. Unsaved changes to a parser
+     * created by from_data() or from_fd() cannot be written and throw LogicException.
       **/
 
+    /**
+    \brief Writes unsaved changes and returns when the file has been written.
+    */
     void sync();
 
+    /**
+    \brief Schedules a write of unsaved changes on a background thread and returns immediately.
+
+    The write takes place <code>delay</code> after the first call. Further calls before
+    the write starts do not schedule another write; their changes are included in the
+    pending one. This makes it cheap to call sync_async() after every change, even
+    many times per second.
+
+    A background write that fails leaves the changes unsaved. The error is reported by
+    the next call to flush(). The destructor completes a pending write, but cannot
+    report errors, so call flush() before destroying the parser if errors matter.
+    \throws LogicException The parser was created by from_data() or from_fd() and has unsaved changes.
+    */
+    void sync_async(std::chrono::milliseconds delay = std::chrono::milliseconds(100));
+
+    /**
+    \brief Starts a pending background write immediately and waits for it to complete.
+    \throws FileException or LogicException The last background write failed.
+    */
+    void flush();
+
+    /** @name Reloading
+     * These member functions pick up changes that other processes make to the configuration file.<br>
+     * A reload replaces the contents of the parser with the contents of the file. Unsaved changes
+     * are discarded. After a reload, the registered callbacks are called with the groups and keys
+     * that were added, removed, or changed, so that consumers can update incrementally.<br>
+     * A parser created by from_data() or from_fd() has no file to reload from; these methods
+     * throw LogicException for such a parser.
+      **/
+
+    /** Differences between the contents of a parser before and after a reload. */
+    struct Changes
+    {
+        std::vector<std::string> added_groups;
+        std::vector<std::string> removed_groups;
+        /** Keys as (group, key) pairs, including the keys of added and removed groups. */
+        std::vector<std::pair<std::string, std::string>> added_keys;
+        std::vector<std::pair<std::string, std::string>> removed_keys;
+        std::vector<std::pair<std::string, std::string>> changed_keys;
+
+        bool empty() const noexcept
+        {
+            return added_groups.empty() && removed_groups.empty() && added_keys.empty()
+                   && removed_keys.empty() && changed_keys.empty();
+        }
+    };
+
+    typedef std::function<void(const Changes&)> ChangeCallback;
+
+    /**
+    \brief Reloads the file if it changed since it was loaded or last written.
+
+    Unsaved changes, including those waiting for sync_async(), are not lost: they
+    are applied on top of the new contents of the file, so a changed key keeps its
+    local value and a removed key or group stays removed. They remain unsaved, and
+    the next sync() writes them into the new version of the file.
+
+    The callbacks are called on the calling thread, without any locks held, so
+    they can call any method of the parser. They report the difference between
+    the old and the new contents, with the unsaved changes applied to both.
+    \return True if the file was reloaded.
+    \throws FileException The file cannot be read or is not a valid ini file. The
+    contents of the parser are unchanged in that case.
+    */
+    bool reload();
+
+    /**
+    \brief Watches the file with inotify and reloads it when it changes.
+
+    The parser watches the directory that contains the file, so changes made by
+    replacing the file (as sync() does) are seen as well. Reloads happen on a
+    background thread, which also calls the callbacks. If the new contents of the
+    file cannot be loaded, the parser keeps its current contents and waits for the
+    next change. Watching stops when the parser is destroyed. Calling watch() again
+    has no effect.
+    \throws SyscallException The inotify watch cannot be set up.
+    */
+    void watch();
+
+    /**
+    \brief Registers a callback for changes found by reload().
+    \return An identifier that can be passed to remove_change_callback().
+    */
+    unsigned add_change_callback(ChangeCallback callback);
+
+    /** Removes a callback. Unknown identifiers are ignored. */
+    void remove_change_callback(unsigned id);
+
     //@}
 
 private:
+    IniParser(internal::IniParserPrivate* d) noexcept;
+
+    void apply(internal::IniBatchPrivate& batch);
+    void publish_snapshot() const;
+    bool get_raw(const std::string& group, const std::string& key, std::string& value) const;
+
+    // Called after a set or remove method, or IniBatch::commit(), changed a key. The key
+    // is empty if a group was removed. The callbacks run without any locks held.
+    typedef std::function<void(const std::string& group, const std::string& key)> EditCallback;
+    unsigned add_edit_callback(EditCallback callback);
+    void remove_edit_callback(unsigned id);
+
     internal::IniParserPrivate* p;
+
+    friend class IniBatch;
+    friend struct internal::IniLayersPrivate;
 };
 
 
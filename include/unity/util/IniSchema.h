@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UNITY_UTIL_INISCHEMA_H
+#define UNITY_UTIL_INISCHEMA_H
+
+#include <unity/SymbolExport.h>
+
+#include <bitset>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/**
+\file IniSchema.h
+\def UNITY_INI_KEY(name, type, group, key)
+\brief Macro to declare a typed key for use with IniSchema.
+
+The macro defines a struct called <code>name</code> that stands for the value of
+<code>key</code> in <code>group</code>, converted to <code>type</code>. The type must be
+one of <code>std::string</code>, <code>bool</code>, <code>int</code>, <code>double</code>,
+or a <code>std::vector</code> of one of these. For example:
+
+~~~
+* UNITY_INI_KEY(WindowWidth, int, "Window", "Width");
+* UNITY_INI_KEY(WindowTitle, std::string, "Window", "Title");
+~~~
+*/
+
+#define UNITY_INI_KEY(name, value_type, group_name, key_name) \
+    struct name                                               \
+    {                                                         \
+        typedef value_type type;                              \
+        static const char* group() noexcept                   \
+        {                                                     \
+            return group_name;                                \
+        }                                                     \
+        static const char* key() noexcept                     \
+        {                                                     \
+            return key_name;                                  \
+        }                                                     \
+    }
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+template<typename Key, typename... Keys>
+struct IniSchemaContains : std::false_type
+{
+};
+
+template<typename Key, typename First, typename... Rest>
+struct IniSchemaContains<Key, First, Rest...>
+    : std::integral_constant<bool, std::is_same<Key, First>::value || IniSchemaContains<Key, Rest...>::value>
+{
+};
+
+template<typename... Keys>
+struct IniSchemaUnique : std::true_type
+{
+};
+
+template<typename First, typename... Rest>
+struct IniSchemaUnique<First, Rest...>
+    : std::integral_constant<bool, !IniSchemaContains<First, Rest...>::value && IniSchemaUnique<Rest...>::value>
+{
+};
+
+// Position of Key in Keys. Callers check IniSchemaContains first, so the
+// terminating case only exists to keep the error message short.
+template<typename Key, typename... Keys>
+struct IniSchemaIndex : std::integral_constant<std::size_t, 0>
+{
+};
+
+template<typename Key, typename First, typename... Rest>
+struct IniSchemaIndex<Key, First, Rest...>
+    : std::integral_constant<std::size_t,
+                             std::is_same<Key, First>::value ? 0 : 1 + IniSchemaIndex<Key, Rest...>::value>
+{
+};
+
+// Maps a value type to the try_get method that reads it.
+template<typename T>
+struct IniSchemaReader
+{
+    static_assert(sizeof(T) == 0,
+                  "IniSchema: key type must be std::string, bool, int, double, or a std::vector of these");
+};
+
+#define UNITY_INI_SCHEMA_READER(value_type, method)                                         \
+    template<>                                                                              \
+    struct IniSchemaReader<value_type>                                                      \
+    {                                                                                       \
+        template<typename Source>                                                           \
+        static bool read(Source const& s, const char* group, const char* key, value_type& v) \
+        {                                                                                   \
+            return s.method(group, key, v);                                                 \
+        }                                                                                   \
+    }
+
+UNITY_INI_SCHEMA_READER(std::string, try_get_string);
+UNITY_INI_SCHEMA_READER(bool, try_get_boolean);
+UNITY_INI_SCHEMA_READER(int, try_get_int);
+UNITY_INI_SCHEMA_READER(double, try_get_double);
+UNITY_INI_SCHEMA_READER(std::vector<std::string>, try_get_string_array);
+UNITY_INI_SCHEMA_READER(std::vector<bool>, try_get_boolean_array);
+UNITY_INI_SCHEMA_READER(std::vector<int>, try_get_int_array);
+UNITY_INI_SCHEMA_READER(std::vector<double>, try_get_double_array);
+
+#undef UNITY_INI_SCHEMA_READER
+
+[[noreturn]] UNITY_API void throw_missing_schema_key(const char* group, const char* key);
+
+} // namespace internal
+
+/**
+\brief Typed, compile-time checked view of a fixed set of keys.
+
+An IniSchema is declared with a list of keys, each of which is declared with
+UNITY_INI_KEY(). Binding the schema to an IniParser (or an IniLayers) looks up
+and converts every key once. After that, get<Key>() returns the converted value
+from a slot whose position is fixed at compile time: there is no string lookup,
+no hashing, and no locking. Using a key that is not part of the schema, or
+assigning the value to a variable of the wrong type, fails to compile.
+
+~~~
+UNITY_INI_KEY(WindowWidth, int, "Window", "Width");
+UNITY_INI_KEY(WindowTitle, std::string, "Window", "Title");
+
+typedef IniSchema<WindowWidth, WindowTitle> WindowConfig;
+
+IniParser parser("app.conf");
+WindowConfig config(parser);
+int width = config.get<WindowWidth>();
+std::string title = config.get_or<WindowTitle>("Untitled");
+~~~
+
+A key whose value is missing or cannot be converted to the declared type is
+absent from the schema: has() returns false for it, get() throws LogicException,
+and get_or() returns the default value. Binding never throws for absent keys.
+
+The schema is a copy of the values at the time of the last bind(). To pick up
+changes, call bind() again, for example from an IniParser change callback.
+
+The const methods can be called concurrently; bind() must not run concurrently
+with any other method on the same schema.
+*/
+
+template<typename... Keys>
+class IniSchema final
+{
+    static_assert(internal::IniSchemaUnique<Keys...>::value, "IniSchema: a key appears more than once");
+
+    template<typename Key>
+    using Slot = internal::IniSchemaIndex<Key, Keys...>;
+
+public:
+    /** Constructs a schema in which all keys are absent. */
+    IniSchema() = default;
+
+    /** Constructs a schema and binds it to <code>source</code>. */
+    template<typename Source>
+    explicit IniSchema(Source const& source)
+    {
+        bind(source);
+    }
+
+    IniSchema(IniSchema const&) = default;
+    IniSchema(IniSchema&&) = default;
+    IniSchema& operator=(IniSchema const&) = default;
+    IniSchema& operator=(IniSchema&&) = default;
+    ~IniSchema() = default;
+
+    /**
+    \brief Looks up and converts every key in <code>source</code>.
+
+    <code>source</code> can be an IniParser or an IniLayers. If a lookup throws
+    (for example, because memory runs out), the schema is unchanged.
+    */
+    template<typename Source>
+    void bind(Source const& source)
+    {
+        std::tuple<typename Keys::type...> values;
+        std::bitset<sizeof...(Keys)> present;
+        typedef int expand[];
+        (void)expand{ 0, (present[Slot<Keys>::value] = internal::IniSchemaReader<typename Keys::type>::read(
+                              source, Keys::group(), Keys::key(), std::get<Slot<Keys>::value>(values)),
+                          0)... };
+        values_.swap(values);
+        present_ = present;
+    }
+
+    /** Returns the number of keys in the schema. */
+    static constexpr std::size_t size() noexcept
+    {
+        return sizeof...(Keys);
+    }
+
+    /** Returns true if <code>Key</code> had a value of the declared type at the last bind(). */
+    template<typename Key>
+    bool has() const noexcept
+    {
+        static_assert(internal::IniSchemaContains<Key, Keys...>::value, "IniSchema: key is not part of this schema");
+        return present_[Slot<Key>::value];
+    }
+
+    /**
+    \brief Returns the value of <code>Key</code>.
+    \throws LogicException if the key is absent.
+    */
+    template<typename Key>
+    typename Key::type const& get() const
+    {
+        if (!has<Key>())
+        {
+            internal::throw_missing_schema_key(Key::group(), Key::key());
+        }
+        return std::get<Slot<Key>::value>(values_);
+    }
+
+    /** Returns the value of <code>Key</code>, or <code>default_value</code> if the key is absent. */
+    template<typename Key>
+    typename Key::type get_or(typename Key::type const& default_value) const
+    {
+        return has<Key>() ? std::get<Slot<Key>::value>(values_) : default_value;
+    }
+
+private:
+    std::tuple<typename Keys::type...> values_;
+    std::bitset<sizeof...(Keys)> present_;
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
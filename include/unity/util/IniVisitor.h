@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INIVISITOR_H
+#define UNITY_UTIL_INIVISITOR_H
+
+#include <unity/SymbolExport.h>
+
+#include <string>
+
+namespace unity
+{
+
+namespace util
+{
+
+/**
+\brief Callbacks for IniParser::visit(), which streams through an ini file.
+
+Derive from IniVisitor and override the callbacks for the parts of the file that
+are of interest. The callbacks are called in file order. Each returns true to
+continue, or false to stop reading the file. The default implementations do nothing
+and return true.
+
+The strings that are passed to the callbacks are only valid for the duration of
+the call; copy them to keep them. Values are passed raw, exactly as they appear in
+the file after the '=' and any white space that follows it, so escape sequences
+such as "\s" and list separators are not processed.
+
+A group that appears more than once in the file is reported each time it appears;
+duplicate keys are reported as they appear, too.
+*/
+
+class UNITY_API IniVisitor
+{
+public:
+    virtual ~IniVisitor();
+
+    /** Called for each group header. */
+    virtual bool group(const std::string& group);
+
+    /** Called for each key of the current group. */
+    virtual bool key_value(const std::string& group, const std::string& key, const std::string& value);
+
+    /** Called for each comment line, with the text after the '#'. Blank lines are not reported. */
+    virtual bool comment(const std::string& text);
+};
+
+} // namespace util
+
+} // namespace unity
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INTERNAL_INIBATCHPRIVATE_H
+#define UNITY_UTIL_INTERNAL_INIBATCHPRIVATE_H
+
+typedef struct _GKeyFile GKeyFile;
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+class IniParser;
+
+namespace internal
+{
+
+// One recorded change. apply() is called with the parser's GKeyFile and the group
+// and key names while IniParser holds its writer lock. The key is empty for a change
+// that affects a whole group. Translated keys are recorded by their full name, such
+// as "Name[de]", which is what GKeyFile stores.
+
+struct IniBatchOp
+{
+    std::string group;
+    std::string key;
+    std::function<void(GKeyFile*, char const*, char const*)> apply;
+};
+
+struct IniBatchPrivate
+{
+    IniParser* parser;
+    std::vector<IniBatchOp> ops;
+};
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
+
+#endif
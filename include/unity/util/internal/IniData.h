@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INTERNAL_INIDATA_H
+#define UNITY_UTIL_INTERNAL_INIDATA_H
+
+#include <unity/util/DefinesPtrs.h>
+#include <unity/util/NonCopyable.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+// A view of a range of bytes inside the text of an ini file. The bytes are
+// not NUL-terminated.
+
+struct IniSpan
+{
+    char const* data;
+    std::size_t size;
+
+    std::string str() const
+    {
+        return std::string(data, size);
+    }
+
+    bool equals(char const* s, std::size_t len) const noexcept
+    {
+        return size == len && std::memcmp(data, s, len) == 0;
+    }
+};
+
+// A group or key name together with its hash, as computed by ini_hash(). Lookups
+// that take an IniName do not hash the name again.
+
+struct IniName
+{
+    char const* data;
+    std::size_t size;
+    std::uint32_t hash;
+};
+
+// FNV-1a hash of a group or key name.
+std::uint32_t ini_hash(char const* s, std::size_t len) noexcept;
+
+// Returns the locale variants that a lookup of a translated key probes, in order.
+// An empty locale selects the languages of the current message locale.
+std::vector<std::string> locale_variants(std::string const& locale);
+
+// Outcome of a lookup or a value conversion. The native engine reports errors
+// as status codes so that callers that do not throw never allocate on a miss.
+
+enum class IniStatus
+{
+    Ok,
+    GroupNotFound,
+    KeyNotFound,
+    InvalidValue,
+    InvalidGroup,  // The body of a lazily parsed group contains an invalid line.
+    ParseFailed    // A lazily parsed group could not be parsed for lack of memory or threads.
+};
+
+// Builds the error text for a status, using the same wording as GKeyFile.
+std::string ini_status_message(IniStatus status, std::string const& group, std::string const& key);
+
+// Throws LogicException if status is not Ok. The message has the same format as
+// the errors that IniParser reports for GKeyFile.
+void check_ini_status(IniStatus status,
+                      char const* prefix,
+                      std::string const& filename,
+                      std::string const& group,
+                      std::string const& key);
+
+// Returns the number of names in the process-wide table that IniData::compact()
+// interns group and key names in, and the number of bytes they take up.
+void interned_name_stats(std::size_t& count, std::size_t& bytes) noexcept;
+
+// Reads everything that remains to be read from fd. Throws FileException on error.
+std::string read_fd(int fd, std::string const& name);
+
+// One line of an ini file.
+struct IniLine
+{
+    enum class Kind
+    {
+        Blank,
+        Comment,
+        Group,
+        Key
+    };
+
+    Kind kind;
+    IniSpan name;   // Group name, or key.
+    IniSpan value;  // Raw value of a key, or the text of a comment after the '#'.
+};
+
+// Classifies a line (without its '\n') by the rules of the native engine. in_group is
+// false before the first group header. Throws FileException for an invalid line.
+IniLine parse_line(char const* begin, char const* end, std::string const& name, bool in_group);
+
+// Reads fd in chunks of chunk_size bytes and calls handler for each line, until the
+// end of the file or until handler returns false. Memory use is bounded by chunk_size
+// and the length of the longest line. Throws FileException on read or parse errors.
+void scan_lines(int fd,
+                std::string const& name,
+                std::size_t chunk_size,
+                std::function<bool(IniLine const&)> const& handler);
+
+//
+// Read-only, flat index over the text of an ini file.
+//
+// The text is either mapped from a file or owned by the instance. Parsing
+// records only offsets: one Group record per distinct group and one Entry
+// record per key line, stored in two contiguous arrays. The entries of a
+// group are contiguous and in file order. Lookups return IniSpans that point
+// into the text, so nothing is copied until a value is converted.
+//
+// Compacted data no longer refers to the text: the group and key names point
+// into a process-wide table that holds one copy of each distinct name, and the
+// values are copied into a buffer of their own, so the text (or the mapping of
+// the file) is released. Comments and formatting are lost; to_text() rebuilds
+// an equivalent ini file from the groups and entries.
+//
+// In lazy mode, opening the text records only the group headers and the
+// ranges of text that hold the body of each group. A body is parsed into its
+// own entry table the first time a lookup needs it, so groups that are never
+// read cost neither parse time nor memory. A syntax error in a body is then
+// not thrown when the text is opened; lookups in that group return
+// IniStatus::InvalidGroup instead. If parsing a body fails for lack of
+// resources, the lookup returns IniStatus::ParseFailed and the next lookup
+// parses the body again.
+//
+// The accepted syntax and the value conversions follow GKeyFile, so that the
+// data can be handed to a GKeyFile (see text()) when a caller wants to write.
+//
+
+class IniData final
+{
+public:
+    NONCOPYABLE(IniData);
+    UNITY_DEFINES_PTRS(IniData);
+
+    // Maps and indexes the given file. Throws FileException if the file cannot
+    // be read or is not a valid ini file. If lazy is set, the bodies of the
+    // groups are parsed on first access.
+    static UPtr open(std::string const& filename, bool lazy = false);
+
+    // Indexes the contents of an open file descriptor, which remains owned by the
+    // caller. Regular files are mapped in full; anything else (such as a pipe) is
+    // read from its current position. The name is used in error messages.
+    static UPtr from_fd(int fd, std::string const& name, bool lazy = false);
+
+    // Takes ownership of the text and indexes it.
+    static UPtr from_string(std::string text, std::string const& name, bool lazy = false);
+
+    // Like open(), but also keeps a compiled copy of the index, together with the
+    // text, in cache_file. If cache_file was written for the same version of the
+    // file (same device, inode, size, and modification time), it is mapped and used
+    // as is, without parsing. A missing, stale, or corrupt cache file is replaced
+    // after parsing the text; failure to write it is ignored.
+    static UPtr open_cached(std::string const& filename, std::string const& cache_file);
+
+    ~IniData();
+
+    // The text the data was parsed from. Not available once the data was compacted.
+    IniSpan text() const noexcept
+    {
+        return IniSpan{ data_, size_ };
+    }
+
+    // Returns the text, or rebuilds an equivalent ini file if the data was compacted.
+    std::string to_text() const;
+
+    bool lazy() const noexcept
+    {
+        return lazy_;
+    }
+
+    bool compacted() const noexcept
+    {
+        return compacted_;
+    }
+
+    // Interns the names and releases the text. Data in lazy mode is left as it is.
+    void compact();
+
+    bool has_group(std::string const& group) const noexcept;
+    IniStatus has_key(std::string const& group, std::string const& key, bool& found) const noexcept;
+    IniStatus has_key(IniName const& group, IniName const& key, bool& found) const noexcept;
+
+    // Returns the raw (still escaped) value for group/key.
+    IniStatus get_value(std::string const& group, std::string const& key, IniSpan& value) const noexcept;
+    IniStatus get_value(IniName const& group, IniName const& key, IniSpan& value) const noexcept;
+
+    // Returns the raw value of the best match for key in the given locale. An empty
+    // locale selects the current message locale, as for GKeyFile.
+    IniStatus get_locale_value(std::string const& group,
+                               std::string const& key,
+                               std::string const& locale,
+                               IniSpan& value) const;
+    IniStatus get_locale_value(IniName const& group,
+                               IniName const& key,
+                               std::string const& locale,
+                               IniSpan& value) const;
+
+    // As above, but probes a list of variants that was computed in advance by locale_variants().
+    IniStatus get_locale_value(std::string const& group,
+                               std::string const& key,
+                               std::vector<std::string> const& variants,
+                               IniSpan& value) const noexcept;
+    IniStatus get_locale_value(IniName const& group,
+                               IniName const& key,
+                               std::vector<std::string> const& variants,
+                               IniSpan& value) const noexcept;
+
+    std::string start_group() const;
+    std::vector<std::string> groups() const;
+    IniStatus keys(std::string const& group, std::vector<std::string>& keys) const;
+
+    // As above, but pass each name to f, until f returns false. The names point into the
+    // text (or into the name table), so nothing is copied.
+    void for_each_group(std::function<bool(char const*, std::size_t)> const& f) const;
+    IniStatus for_each_key(std::string const& group, std::function<bool(char const*, std::size_t)> const& f) const;
+
+    // Appends the raw key/value pairs of a group, in file order.
+    IniStatus entries(std::string const& group, std::vector<std::pair<IniSpan, IniSpan>>& entries) const;
+
+    // Value conversions. These apply the GKeyFile escaping and list rules to a raw value.
+    static IniStatus to_string(IniSpan raw, std::string& value);
+    static IniStatus to_string_list(IniSpan raw, std::vector<std::string>& value);
+    static IniStatus to_boolean(IniSpan raw, bool& value) noexcept;
+    static IniStatus to_int(IniSpan raw, int& value) noexcept;
+    static IniStatus to_double(IniSpan raw, double& value) noexcept;
+    static IniStatus to_boolean_list(IniSpan raw, std::vector<bool>& value);
+    static IniStatus to_int_list(IniSpan raw, std::vector<int>& value);
+    static IniStatus to_double_list(IniSpan raw, std::vector<double>& value);
+
+    // As above, but store at most buf_size elements in buf, and set count to the number
+    // of elements in the list. These do not allocate unless an element contains an escape
+    // sequence. On error, buf may have been partially written.
+    static IniStatus to_boolean_buffer(IniSpan raw, bool* buf, std::size_t buf_size, std::size_t& count);
+    static IniStatus to_int_buffer(IniSpan raw, int* buf, std::size_t buf_size, std::size_t& count);
+    static IniStatus to_double_buffer(IniSpan raw, double* buf, std::size_t buf_size, std::size_t& count);
+
+private:
+    struct Group
+    {
+        std::uint32_t name_offset;
+        std::uint32_t name_size;
+        std::uint32_t hash;
+        std::uint32_t first_entry;  // Index into entries_ and sorted_.
+        std::uint32_t num_entries;
+    };
+
+    struct Entry
+    {
+        std::uint32_t key_offset;
+        std::uint32_t key_size;
+        std::uint32_t value_offset;
+        std::uint32_t value_size;
+        std::uint32_t hash;
+    };
+
+    // A read-only array that lives either in one of the store vectors or in a mapped cache file.
+    template<typename T>
+    struct Table
+    {
+        T const* data = nullptr;
+        std::uint32_t count = 0;
+
+        T const* begin() const noexcept
+        {
+            return data;
+        }
+        T const* end() const noexcept
+        {
+            return data + count;
+        }
+        std::uint32_t size() const noexcept
+        {
+            return count;
+        }
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+        T const& operator[](std::uint32_t i) const noexcept
+        {
+            return data[i];
+        }
+        void assign(std::vector<T> const& v) noexcept
+        {
+            data = v.data();
+            count = v.size();
+        }
+    };
+
+    // Identifies the version of a file that a cache was built from.
+    struct CacheKey
+    {
+        std::uint64_t dev;
+        std::uint64_t ino;
+        std::uint64_t size;
+        std::int64_t mtime_sec;
+        std::int64_t mtime_nsec;
+    };
+
+    // The entries of one group, wherever they are stored.
+    struct GroupView
+    {
+        Entry const* entries;         // In file order.
+        std::uint32_t size;
+        std::uint32_t const* sorted;  // Indexes into base, sorted by hash.
+        Entry const* base;
+    };
+
+    // A group in lazy mode. The body is parsed by the first lookup that needs it.
+    // parse_group() throws only if it runs out of memory; call_once() then leaves
+    // parsed unset, so that a later lookup tries again.
+    struct LazyGroup
+    {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> bodies;  // [begin, end) of each occurrence.
+        std::once_flag parsed;
+        IniStatus status = IniStatus::Ok;
+        std::vector<Entry> entries;
+        std::vector<std::uint32_t> sorted;  // Indexes into entries.
+    };
+
+    IniData();
+
+    void parse(std::string const& name);
+    void index_groups(std::string const& name);
+    void parse_group(LazyGroup& group) const;
+    Entry entry_of(IniLine const& line) const noexcept;
+
+    static UPtr map_cache(std::string const& cache_file, CacheKey const& key);
+    void write_cache(std::string const& cache_file, CacheKey const& key) const;
+    bool valid_index() const noexcept;
+    std::uint64_t checksum() const noexcept;
+
+    std::uint32_t add_group(IniName const& name,
+                            std::uint32_t offset,
+                            std::unordered_multimap<std::uint32_t, std::uint32_t>& seen,
+                            bool& added);
+    void build_group_index();
+    Group const* find_group(IniName const& name) const noexcept;
+    IniStatus find_group(IniName const& name, GroupView& view) const noexcept;
+    Entry const* find_entry(GroupView const& group, IniName const& key) const noexcept;
+    Entry const* find_translation(GroupView const& group, IniName const& key, char const* lang, std::size_t lang_size)
+        const noexcept;
+    template<typename Equals>
+    Entry const* find_entry(GroupView const& group, std::uint32_t hash, Equals equals) const noexcept;
+
+    IniSpan span(std::uint32_t offset, std::uint32_t size) const noexcept
+    {
+        return IniSpan{ data_ + offset, size };
+    }
+
+    // Once compacted, name offsets are indexes into names_.
+    IniSpan name(std::uint32_t offset, std::uint32_t size) const noexcept
+    {
+        return compacted_ ? IniSpan{ names_[offset], size } : span(offset, size);
+    }
+
+    char const* data_;
+    std::size_t size_;
+    void* map_;             // The mapped file or cache file, if any.
+    std::size_t map_size_;
+    std::string owned_;
+
+    Table<Group> groups_;
+    Table<std::uint32_t> group_index_;  // Indexes into groups_ sorted by hash.
+    Table<Entry> entries_;         // Entries of each group in file order.
+    Table<std::uint32_t> sorted_;  // Per group, indexes into entries_ sorted by hash.
+
+    // Backing storage for the tables if the text was parsed rather than loaded from a cache.
+    std::vector<Group> group_store_;
+    std::vector<std::uint32_t> group_index_store_;
+    std::vector<Entry> entry_store_;
+    std::vector<std::uint32_t> sorted_store_;
+
+    bool compacted_ = false;
+    std::vector<char const*> names_;
+
+    bool lazy_ = false;
+    std::vector<std::unique_ptr<LazyGroup>> lazy_groups_;  // Parallel to groups_ in lazy mode.
+};
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
+
+#endif
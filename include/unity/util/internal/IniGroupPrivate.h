@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INTERNAL_INIGROUPPRIVATE_H
+#define UNITY_UTIL_INTERNAL_INIGROUPPRIVATE_H
+
+#include <unity/util/internal/IniData.h>
+
+#include <string>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+// The snapshot holds a private single-group IniData that IniParser builds
+// from the raw values of the group, so lookups and conversions are shared
+// with the native engine.
+
+struct IniGroupPrivate
+{
+    std::string filename;  // Of the parser the snapshot was taken from, for error messages.
+    std::string name;
+    IniData::UPtr data;
+};
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
+
+#endif
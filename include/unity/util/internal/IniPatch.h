@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITY_UTIL_INTERNAL_INIPATCH_H
+#define UNITY_UTIL_INTERNAL_INIPATCH_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+//
+// A set of changes to the text of a valid ini file that touches only the lines
+// that change. Everything else, including comments, blank lines, spacing around
+// '=', and the order of groups and keys, is copied unchanged.
+//
+// Values are raw: they must already be escaped the way GKeyFile writes them
+// (as returned by g_key_file_get_value()).
+//
+
+class IniPatch final
+{
+public:
+    // Sets key to value. If the key occurs more than once, its last occurrence
+    // (the one GKeyFile uses) is changed in place. A new key is added after the
+    // last key of the group; a new group is added at the end of the text.
+    void set_value(std::string const& group, std::string const& key, std::string const& value);
+
+    // Removes every occurrence of key.
+    void remove_key(std::string const& group, std::string const& key);
+
+    // Removes every occurrence of group with its keys. Comments and blank lines
+    // after the last key are kept, because GKeyFile attaches comments to the
+    // group or key that follows them. Values that are set for the same group
+    // replace the first occurrence of the group in place.
+    void remove_group(std::string const& group);
+
+    bool empty() const noexcept;
+
+    // Returns text with the changes applied.
+    std::string apply(std::string const& text) const;
+
+private:
+    // Per group, the keys to set in the order they were added, and the keys to remove.
+    struct GroupChanges
+    {
+        bool removed = false;
+        std::vector<std::pair<std::string, std::string>> values;
+        std::set<std::string> removed_keys;
+    };
+
+    std::map<std::string, GroupChanges> groups_;
+    std::vector<std::string> order_;  // Groups in the order they were first changed.
+
+    GroupChanges& changes_for(std::string const& group);
+};
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef UNITY_UTIL_INTERNAL_PARALLELFOR_H
+#define UNITY_UTIL_INTERNAL_PARALLELFOR_H
+
+#include <cstddef>
+#include <functional>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+//
+// Calls task(i) for each i in [0, count) on up to num_threads threads, the
+// calling thread included, and returns once all calls have finished. Each
+// thread takes the next index until none are left, so the threads share
+// nothing but a counter.
+//
+// If a thread cannot be started, the threads that did start (and the calling
+// thread) run the remaining calls. If a call throws, the remaining indexes are
+// still handed out, all threads are joined, and the first exception is
+// rethrown.
+//
+
+void parallel_for(std::size_t count, std::size_t num_threads, std::function<void(std::size_t)> const& task);
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
+
+#endif
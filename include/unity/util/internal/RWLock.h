@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UNITY_UTIL_INTERNAL_RWLOCK_H
+#define UNITY_UTIL_INTERNAL_RWLOCK_H
+
+typedef struct _GRWLock GRWLock;
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+//
+// Scoped guards for a GRWLock. Any number of readers can hold the lock
+// at the same time; a writer holds it exclusively.
+//
+
+class ReaderLock final
+{
+public:
+    explicit ReaderLock(GRWLock& lock);
+    ~ReaderLock();
+
+    ReaderLock(ReaderLock const&) = delete;
+    ReaderLock& operator=(ReaderLock const&) = delete;
+
+private:
+    GRWLock& lock_;
+};
+
+class WriterLock final
+{
+public:
+    explicit WriterLock(GRWLock& lock);
+    ~WriterLock();
+
+    WriterLock(WriterLock const&) = delete;
+    WriterLock& operator=(WriterLock const&) = delete;
+
+private:
+    GRWLock& lock_;
+};
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
+
+#endif
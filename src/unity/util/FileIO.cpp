@@ -18,14 +18,22 @@
 
 #include <unity/util/FileIO.h>
 #include <unity/util/ResourcePtr.h>
+#include <unity/util/internal/ParallelFor.h>
 #include <unity/UnityExceptions.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <sstream>
+#include <thread>
 
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <functional>
 
 using namespace std;
@@ -44,49 +52,278 @@ namespace
 // down to system calls. At least then, when something goes wrong, we know what it was.
 //
 
-template<typename T>
-vector<T> read_file(string const& filename)
+typedef util::ResourcePtr<int, std::function<void(int)>> FileDescriptor;
+
+// Opens filename for reading. Pipes are accepted unless regular_only is set; other
+// file types, such as directories and devices, are rejected.
+void open_file(string const& filename, FileDescriptor& fd, struct stat& st, bool regular_only)
 {
-    util::ResourcePtr<int, std::function<void(int)>> fd(::open(filename.c_str(), O_RDONLY),
-                                                        [](int fd) { if (fd != -1) ::close(fd); });
+    fd.reset(::open(filename.c_str(), O_RDONLY));
     if (fd.get() == -1)
     {
         throw FileException("cannot open \"" + filename + "\": " + strerror(errno), errno);
     }
 
-    struct stat st;
     if (fstat(fd.get(), &st) == -1)
     {
         throw FileException("cannot fstat \"" + filename + "\": " + strerror(errno), errno); // LCOV_EXCL_LINE
     }
 
-    if (!S_ISREG(st.st_mode))
+    if (!S_ISREG(st.st_mode) && (regular_only || !S_ISFIFO(st.st_mode)))
     {
         throw FileException("\"" + filename + "\" is not a regular file", 0);
     }
+}
 
-    vector<T> buf(st.st_size);
+// Reads until buf is full or the end of the file is reached, and returns the number
+// of bytes read. read() may return fewer bytes than requested for pipes and some
+// special files, so a short read does not mean end of file until read() returns 0.
+size_t read_fully(int fd, string const& filename, char* buf, size_t size)
+{
+    size_t total = 0;
+    while (total < size)
+    {
+        ssize_t n = ::read(fd, buf + total, size - total);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;  // LCOV_EXCL_LINE
+            }
+            // LCOV_EXCL_START
+            ostringstream msg;
+            msg << "cannot read from \"" << filename << "\" at offset " << total << ": " << strerror(errno);
+            throw FileException(msg.str(), errno);
+            // LCOV_EXCL_STOP
+        }
+        total += n;
+    }
+    return total;
+}
 
-    if (st.st_size == 0)
+// Reads the whole file into a string or vector of bytes. The size reported by fstat() is only
+// a hint: files in /proc and /sys report a size of 0, and pipes have no size at all, so the
+// buffer grows geometrically until the end of the file. A regular file with a non-zero size
+// is read up to that size, so a file that is appended to while it is read is not read forever.
+template<typename C>
+C read_file(string const& filename)
+{
+    static_assert(sizeof(typename C::value_type) == 1, "read_file() reads bytes");
+
+    FileDescriptor fd([](int fd) { if (fd != -1) ::close(fd); });
+    struct stat st;
+    open_file(filename, fd, st, false);
+
+    bool const sized = S_ISREG(st.st_mode) && st.st_size > 0;
+    C buf;
+    buf.resize(sized ? st.st_size : 4096);
+    size_t size = 0;
+    for (;;)
+    {
+        size += read_fully(fd.get(), filename, reinterpret_cast<char*>(&buf[size]), buf.size() - size);
+        if (size < buf.size() || sized)
+        {
+            break;
+        }
+        buf.resize(buf.size() * 2);
+    }
+    buf.resize(size);
+    return buf;
+}
+
+string directory_of(string const& filename)
+{
+    auto slash = filename.rfind('/');
+    if (slash == string::npos)
     {
-        return buf;
+        return ".";
     }
+    return slash == 0 ? "/" : filename.substr(0, slash);
+}
 
-    if (read(fd.get(), &buf[0], st.st_size) != st.st_size)
+// Returns a name next to filename for a temporary file. Uniqueness is checked with O_EXCL
+// (or by linkat()), so the name only needs to be unlikely to be in use.
+string temp_name(string const& filename)
+{
+    static atomic<unsigned> counter(0);
+    return filename + ".tmp." + to_string(getpid()) + "." + to_string(counter++);
+}
+
+// Writes all chunks, continuing after partial writes. writev() accepts at most IOV_MAX buffers per call.
+void write_all(int fd, string const& filename, vector<FileChunk> const& chunks)
+{
+    vector<struct iovec> iov;
+    iov.reserve(chunks.size());
+    for (auto const& c : chunks)
     {
-        // LCOV_EXCL_START
-        ostringstream msg;
-        msg << "cannot read " << st.st_size << " byte";
-        if (st.st_size != 1)
+        if (c.size != 0)
         {
-            msg << "s";
+            iov.push_back(iovec{ const_cast<void*>(c.data), c.size });
         }
-        msg << " from \"" << filename << "\": " << strerror(errno);
-        throw FileException(msg.str(), errno);
-        // LCOV_EXCL_STOP
     }
 
-    return buf;
+    size_t i = 0;
+    while (i < iov.size())
+    {
+        ssize_t n = ::writev(fd, &iov[i], min(iov.size() - i, size_t(IOV_MAX)));
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;  // LCOV_EXCL_LINE
+            }
+            throw FileException("cannot write \"" + filename + "\": " + strerror(errno), errno);
+        }
+        // Skip the buffers that were written completely, and trim the one that was written partially.
+        size_t written = n;
+        while (i < iov.size() && written >= iov[i].iov_len)
+        {
+            written -= iov[i].iov_len;
+            ++i;
+        }
+        if (written != 0)
+        {
+            iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + written;
+            iov[i].iov_len -= written;
+        }
+    }
+}
+
+// Sets the mode of the temporary file, writes the contents, and syncs them if required.
+// If written is not null, it receives the status of the temporary file.
+void fill_temp_file(int fd,
+                    string const& filename,
+                    vector<FileChunk> const& chunks,
+                    SyncPolicy policy,
+                    struct stat const* old_st,
+                    struct stat* written)
+{
+    if (old_st && fchmod(fd, old_st->st_mode & 07777) == -1)
+    {
+        throw FileException("cannot set mode of \"" + filename + "\": " + strerror(errno), errno);  // LCOV_EXCL_LINE
+    }
+    write_all(fd, filename, chunks);
+    if (policy != SyncPolicy::None && fsync(fd) == -1)
+    {
+        throw FileException("cannot fsync \"" + filename + "\": " + strerror(errno), errno);  // LCOV_EXCL_LINE
+    }
+    if (written && fstat(fd, written) == -1)
+    {
+        throw FileException("cannot stat \"" + filename + "\": " + strerror(errno), errno);  // LCOV_EXCL_LINE
+    }
+}
+
+// Writes the contents to an unnamed file with O_TMPFILE and links it at a temporary name.
+// Returns false if the kernel, the file system, or the lack of /proc does not allow this.
+bool write_unnamed_temp(string const& filename,
+                        vector<FileChunk> const& chunks,
+                        SyncPolicy policy,
+                        struct stat const* old_st,
+                        struct stat* written,
+                        string& tmp)
+{
+#ifdef O_TMPFILE
+    FileDescriptor fd([](int fd) { if (fd != -1) ::close(fd); });
+    fd.reset(::open(directory_of(filename).c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666));
+    if (fd.get() == -1)
+    {
+        return false;
+    }
+    fill_temp_file(fd.get(), filename, chunks, policy, old_st, written);
+
+    // linkat() cannot replace an existing file, so the file gets a temporary name first.
+    string proc_path = "/proc/self/fd/" + to_string(fd.get());
+    for (;;)
+    {
+        tmp = temp_name(filename);
+        if (linkat(AT_FDCWD, proc_path.c_str(), AT_FDCWD, tmp.c_str(), AT_SYMLINK_FOLLOW) == 0)
+        {
+            return true;
+        }
+        if (errno != EEXIST)
+        {
+            tmp.clear();
+            return false;
+        }
+    }
+#else
+    (void)filename;
+    (void)chunks;
+    (void)policy;
+    (void)old_st;
+    (void)written;
+    (void)tmp;
+    return false;
+#endif
+}
+
+// Writes the contents to a new file with a temporary name.
+void write_named_temp(string const& filename,
+                      vector<FileChunk> const& chunks,
+                      SyncPolicy policy,
+                      struct stat const* old_st,
+                      struct stat* written,
+                      string& tmp)
+{
+    FileDescriptor fd([](int fd) { if (fd != -1) ::close(fd); });
+    do
+    {
+        tmp = temp_name(filename);
+        fd.reset(::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666));
+    }
+    while (fd.get() == -1 && errno == EEXIST);
+    if (fd.get() == -1)
+    {
+        throw FileException("cannot create temporary file for \"" + filename + "\": " + strerror(errno), errno);
+    }
+
+    try
+    {
+        fill_temp_file(fd.get(), filename, chunks, policy, old_st, written);
+        if (::close(fd.release()) == -1)
+        {
+            throw FileException("cannot close \"" + filename + "\": " + strerror(errno), errno);  // LCOV_EXCL_LINE
+        }
+    }
+    catch (...)
+    {
+        unlink(tmp.c_str());
+        throw;
+    }
+}
+
+void replace_file(string const& filename, vector<FileChunk> const& chunks, SyncPolicy policy, struct stat* written)
+{
+    struct stat st;
+    struct stat const* old_st = stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode) ? &st : nullptr;
+
+    string tmp;
+    if (!write_unnamed_temp(filename, chunks, policy, old_st, written, tmp))
+    {
+        write_named_temp(filename, chunks, policy, old_st, written, tmp);
+    }
+
+    if (rename(tmp.c_str(), filename.c_str()) == -1)
+    {
+        int err = errno;
+        unlink(tmp.c_str());
+        throw FileException("cannot rename \"" + tmp + "\" to \"" + filename + "\": " + strerror(err), err);
+    }
+
+    if (policy == SyncPolicy::FileAndDirectory)
+    {
+        string dir = directory_of(filename);
+        FileDescriptor fd([](int fd) { if (fd != -1) ::close(fd); });
+        fd.reset(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (fd.get() == -1 || fsync(fd.get()) == -1)
+        {
+            throw FileException("cannot fsync directory \"" + dir + "\": " + strerror(errno), errno);  // LCOV_EXCL_LINE
+        }
+    }
 }
 
 } // namespace
@@ -94,14 +331,139 @@ vector<T> read_file(string const& filename)
 string
 read_text_file(string const& filename)
 {
-    vector<char> buf(read_file<char>(filename));
-    return string(buf.begin(), buf.end());
+    return read_file<string>(filename);
 }
 
 vector<uint8_t>
 read_binary_file(string const& filename)
 {
-    return read_file<uint8_t>(filename);
+    return read_file<vector<uint8_t>>(filename);
+}
+
+vector<FileReadResult>
+read_files(vector<string> const& filenames, unsigned max_threads)
+{
+    // Each worker stores the outcome in the slot for its file.
+    vector<FileReadResult> results(filenames.size());
+    size_t num_threads = max_threads ? max_threads : max(8u, thread::hardware_concurrency());
+    internal::parallel_for(filenames.size(), num_threads, [&](size_t i)
+    {
+        try
+        {
+            results[i].contents = read_text_file(filenames[i]);
+        }
+        catch (std::exception const& e)
+        {
+            results[i].error = e.what();
+        }
+    });
+    return results;
+}
+
+void
+read_file_chunks(string const& filename, function<bool(char const*, size_t)> const& callback, size_t chunk_size)
+{
+    if (chunk_size == 0)
+    {
+        throw InvalidArgumentException("read_file_chunks(): chunk_size must be greater than zero");
+    }
+
+    FileDescriptor fd([](int fd) { if (fd != -1) ::close(fd); });
+    struct stat st;
+    open_file(filename, fd, st, false);
+
+    unique_ptr<char[]> buf(new char[chunk_size]);
+    for (;;)
+    {
+        size_t n = read_fully(fd.get(), filename, buf.get(), chunk_size);
+        if (n == 0 || !callback(buf.get(), n) || n < chunk_size)
+        {
+            break;
+        }
+    }
+}
+
+void
+write_text_file(string const& filename, string const& contents, SyncPolicy policy, struct stat* written)
+{
+    replace_file(filename, { FileChunk{ contents.data(), contents.size() } }, policy, written);
+}
+
+void
+write_binary_file(string const& filename, vector<uint8_t> const& contents, SyncPolicy policy, struct stat* written)
+{
+    replace_file(filename, { FileChunk{ contents.data(), contents.size() } }, policy, written);
+}
+
+void
+write_file_chunks(string const& filename, vector<FileChunk> const& chunks, SyncPolicy policy, struct stat* written)
+{
+    replace_file(filename, chunks, policy, written);
+}
+
+MappedFile::MappedFile() noexcept
+    : data_(nullptr)
+    , size_(0)
+{
+}
+
+MappedFile::MappedFile(char const* data, size_t size) noexcept
+    : data_(data)
+    , size_(size)
+{
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_)
+    , size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (data_)
+        {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if (data_)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+MappedFile
+map_file(string const& filename)
+{
+    FileDescriptor fd([](int fd) { if (fd != -1) ::close(fd); });
+    struct stat st;
+    open_file(filename, fd, st, true);
+
+    if (st.st_size == 0)
+    {
+        return MappedFile();  // mmap() rejects a length of zero.
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (addr == MAP_FAILED)
+    {
+        throw FileException("cannot mmap \"" + filename + "\": " + strerror(errno), errno); // LCOV_EXCL_LINE
+    }
+    return MappedFile(static_cast<char const*>(addr), st.st_size);
 }
 
 } // namespace util
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/IniBatch.h>
+#include <unity/util/IniParser.h>
+#include <unity/util/internal/IniBatchPrivate.h>
+
+#include <glib.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+using internal::IniBatchOp;
+
+namespace
+{
+
+template<typename T, typename GT>
+vector<GT> to_glib_list(vector<T> const& value)
+{
+    return vector<GT>(value.begin(), value.end());
+}
+
+} // namespace
+
+IniBatch::IniBatch(IniParser& parser)
+    : p(new internal::IniBatchPrivate{ &parser, {} })
+{
+}
+
+IniBatch::IniBatch(IniBatch&&) noexcept = default;
+IniBatch& IniBatch::operator=(IniBatch&&) noexcept = default;
+IniBatch::~IniBatch() noexcept = default;
+
+void IniBatch::remove_group(const string& group)
+{
+    p->ops.push_back(IniBatchOp{ group, string(), [](GKeyFile* k, char const* g, char const*)
+    {
+        g_key_file_remove_group(k, g, nullptr);
+    } });
+}
+
+void IniBatch::remove_key(const string& group, const string& key)
+{
+    p->ops.push_back(IniBatchOp{ group, key, [](GKeyFile* k, char const* g, char const* key)
+    {
+        g_key_file_remove_key(k, g, key, nullptr);
+    } });
+}
+
+void IniBatch::set_string(const string& group, const string& key, const string& value)
+{
+    p->ops.push_back(IniBatchOp{ group, key, [value](GKeyFile* k, char const* g, char const* key)
+    {
+        g_key_file_set_string(k, g, key, value.c_str());
+    } });
+}
+
+void IniBatch::set_locale_string(const string& group, const string& key, const string& value, const string& locale)
+{
+    set_string(group, key + "[" + locale + "]", value);
+}
+
+void IniBatch::set_boolean(const string& group, const string& key, bool value)
+{
+    p->ops.push_back(IniBatchOp{ group, key, [value](GKeyFile* k, char const* g, char const* key)
+    {
+        g_key_file_set_boolean(k, g, key, value);
+    } });
+}
+
+void IniBatch::set_int(const string& group, const string& key, int value)
+{
+    p->ops.push_back(IniBatchOp{ group, key, [value](GKeyFile* k, char const* g, char const* key)
+    {
+        g_key_file_set_integer(k, g, key, value);
+    } });
+}
+
+void IniBatch::set_double(const string& group, const string& key, double value)
+{
+    p->ops.push_back(IniBatchOp{ group, key, [value](GKeyFile* k, char const* g, char const* key)
+    {
+        g_key_file_set_double(k, g, key, value);
+    } });
+}
+
+void IniBatch::set_string_array(const string& group, const string& key, const vector<string>& value)
+{
+    p->ops.push_back(IniBatchOp{ group, key, [value](GKeyFile* k, char const* g, char const* key)
+    {
+        vector<gchar const*> strlist;
+        strlist.reserve(value.size() + 1);
+        for (auto const& s : value)
+        {
+            strlist.push_back(s.c_str());
+        }
+        strlist.push_back(nullptr);
+        g_key_file_set_string_list(k, g, key, strlist.data(), value.size());
+    } });
+}
+
+void IniBatch::set_locale_string_array(const string& group,
+                                       const string& key,
+                                       const vector<string>& value,
+                                       const string& locale)
+{
+    set_string_array(group, key + "[" + locale + "]", value);
+}
+
+void IniBatch::set_boolean_array(const string& group, const string& key, const vector<bool>& value)
+{
+    auto list = to_glib_list<bool, gboolean>(value);
+    p->ops.push_back(IniBatchOp{ group, key, [list](GKeyFile* k, char const* g, char const* key) mutable
+    {
+        g_key_file_set_boolean_list(k, g, key, list.data(), list.size());
+    } });
+}
+
+void IniBatch::set_int_array(const string& group, const string& key, const vector<int>& value)
+{
+    auto list = to_glib_list<int, gint>(value);
+    p->ops.push_back(IniBatchOp{ group, key, [list](GKeyFile* k, char const* g, char const* key) mutable
+    {
+        g_key_file_set_integer_list(k, g, key, list.data(), list.size());
+    } });
+}
+
+void IniBatch::set_double_array(const string& group, const string& key, const vector<double>& value)
+{
+    auto list = to_glib_list<double, gdouble>(value);
+    p->ops.push_back(IniBatchOp{ group, key, [list](GKeyFile* k, char const* g, char const* key) mutable
+    {
+        g_key_file_set_double_list(k, g, key, list.data(), list.size());
+    } });
+}
+
+size_t IniBatch::size() const noexcept
+{
+    return p->ops.size();
+}
+
+void IniBatch::clear() noexcept
+{
+    p->ops.clear();
+}
+
+void IniBatch::commit(bool sync)
+{
+    p->parser->apply(*p);
+    p->ops.clear();
+    if (sync)
+    {
+        p->parser->sync();
+    }
+}
+
+} // namespace util
+
+} // namespace unity
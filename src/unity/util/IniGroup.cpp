@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/IniGroup.h>
+#include <unity/util/internal/IniGroupPrivate.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+using internal::IniData;
+using internal::IniGroupPrivate;
+using internal::IniSpan;
+using internal::IniStatus;
+
+namespace
+{
+
+template<typename T, typename Convert>
+T get_value(IniGroupPrivate const& p, string const& key, Convert convert, char const* prefix)
+{
+    IniSpan raw;
+    T value = T();
+    internal::check_ini_status(p.data->get_value(p.name, key, raw), prefix, p.filename, p.name, key);
+    internal::check_ini_status(convert(raw, value), prefix, p.filename, p.name, key);
+    return value;
+}
+
+template<typename T, typename Convert>
+T get_locale_value(IniGroupPrivate const& p, string const& key, string const& locale, Convert convert, char const* prefix)
+{
+    IniSpan raw;
+    T value = T();
+    internal::check_ini_status(p.data->get_locale_value(p.name, key, locale, raw), prefix, p.filename, p.name, key);
+    internal::check_ini_status(convert(raw, value), prefix, p.filename, p.name, key);
+    return value;
+}
+
+template<typename T, typename Convert>
+bool try_get_value(IniGroupPrivate const& p, string const& key, Convert convert, T& value)
+{
+    IniSpan raw;
+    T v;
+    if (p.data->get_value(p.name, key, raw) != IniStatus::Ok || convert(raw, v) != IniStatus::Ok)
+    {
+        return false;
+    }
+    value = move(v);
+    return true;
+}
+
+template<typename T, typename Convert>
+bool try_get_locale_value(IniGroupPrivate const& p, string const& key, string const& locale, Convert convert, T& value)
+{
+    IniSpan raw;
+    T v;
+    if (p.data->get_locale_value(p.name, key, locale, raw) != IniStatus::Ok || convert(raw, v) != IniStatus::Ok)
+    {
+        return false;
+    }
+    value = move(v);
+    return true;
+}
+
+} // namespace
+
+IniGroup::IniGroup(IniGroupPrivate* d) noexcept
+    : p(d)
+{
+}
+
+IniGroup::IniGroup(IniGroup&&) noexcept = default;
+IniGroup& IniGroup::operator=(IniGroup&&) noexcept = default;
+IniGroup::~IniGroup() noexcept = default;
+
+string IniGroup::name() const
+{
+    return p->name;
+}
+
+vector<string> IniGroup::get_keys() const
+{
+    vector<string> keys;
+    p->data->keys(p->name, keys);
+    return keys;
+}
+
+bool IniGroup::has_key(string const& key) const noexcept
+{
+    bool found = false;
+    p->data->has_key(p->name, key, found);
+    return found;
+}
+
+string IniGroup::get_string(string const& key) const
+{
+    return get_value<string>(*p, key, IniData::to_string, "Could not get string value");
+}
+
+string IniGroup::get_locale_string(string const& key, string const& locale) const
+{
+    return get_locale_value<string>(*p, key, locale, IniData::to_string, "Could not get localized string value");
+}
+
+bool IniGroup::get_boolean(string const& key) const
+{
+    return get_value<bool>(*p, key, IniData::to_boolean, "Could not get boolean value");
+}
+
+int IniGroup::get_int(string const& key) const
+{
+    return get_value<int>(*p, key, IniData::to_int, "Could not get integer value");
+}
+
+double IniGroup::get_double(string const& key) const
+{
+    return get_value<double>(*p, key, IniData::to_double, "Could not get double value");
+}
+
+vector<string> IniGroup::get_string_array(string const& key) const
+{
+    return get_value<vector<string>>(*p, key, IniData::to_string_list, "Could not get string array");
+}
+
+vector<string> IniGroup::get_locale_string_array(string const& key, string const& locale) const
+{
+    return get_locale_value<vector<string>>(*p, key, locale, IniData::to_string_list,
+                                            "Could not get localized string array");
+}
+
+vector<bool> IniGroup::get_boolean_array(string const& key) const
+{
+    return get_value<vector<bool>>(*p, key, IniData::to_boolean_list, "Could not get boolean array");
+}
+
+vector<int> IniGroup::get_int_array(string const& key) const
+{
+    return get_value<vector<int>>(*p, key, IniData::to_int_list, "Could not get integer array");
+}
+
+vector<double> IniGroup::get_double_array(string const& key) const
+{
+    return get_value<vector<double>>(*p, key, IniData::to_double_list, "Could not get double array");
+}
+
+bool IniGroup::try_get_string(string const& key, string& value) const
+{
+    return try_get_value(*p, key, IniData::to_string, value);
+}
+
+bool IniGroup::try_get_locale_string(string const& key, string& value, string const& locale) const
+{
+    return try_get_locale_value(*p, key, locale, IniData::to_string, value);
+}
+
+bool IniGroup::try_get_boolean(string const& key, bool& value) const noexcept
+{
+    return try_get_value(*p, key, IniData::to_boolean, value);
+}
+
+bool IniGroup::try_get_int(string const& key, int& value) const noexcept
+{
+    return try_get_value(*p, key, IniData::to_int, value);
+}
+
+bool IniGroup::try_get_double(string const& key, double& value) const noexcept
+{
+    return try_get_value(*p, key, IniData::to_double, value);
+}
+
+bool IniGroup::try_get_string_array(string const& key, vector<string>& value) const
+{
+    return try_get_value(*p, key, IniData::to_string_list, value);
+}
+
+bool IniGroup::try_get_locale_string_array(string const& key, vector<string>& value, string const& locale) const
+{
+    return try_get_locale_value(*p, key, locale, IniData::to_string_list, value);
+}
+
+bool IniGroup::try_get_boolean_array(string const& key, vector<bool>& value) const
+{
+    return try_get_value(*p, key, IniData::to_boolean_list, value);
+}
+
+bool IniGroup::try_get_int_array(string const& key, vector<int>& value) const
+{
+    return try_get_value(*p, key, IniData::to_int_list, value);
+}
+
+bool IniGroup::try_get_double_array(string const& key, vector<double>& value) const
+{
+    return try_get_value(*p, key, IniData::to_double_list, value);
+}
+
+} // namespace util
+
+} // namespace unity
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/IniKey.h>
+#include <unity/util/internal/IniData.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+IniKey::IniKey(string group, string key)
+    : group_(move(group))
+    , key_(move(key))
+    , group_hash_(internal::ini_hash(group_.data(), group_.size()))
+    , key_hash_(internal::ini_hash(key_.data(), key_.size()))
+{
+}
+
+} // namespace util
+
+} // namespace unity
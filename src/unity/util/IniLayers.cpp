@@ -0,0 +1,655 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unity/util/IniLayers.h>
+
+#include <unity/UnityExceptions.h>
+#include <unity/util/internal/IniData.h>
+#include <unity/util/internal/RWLock.h>
+
+#include <glib.h>
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+struct IniLayersPrivate
+{
+    // The raw value of a key, and the layer it was taken from.
+    struct Value
+    {
+        size_t layer;
+        string raw;
+    };
+    typedef unordered_map<string, Value> Keys;
+
+    string name;  // For error messages.
+    vector<IniParser::SPtr> layers;
+    vector<unsigned> callback_ids;       // Change callbacks, one per layer.
+    vector<unsigned> edit_callback_ids;  // Edit callbacks, one per layer.
+
+    GRWLock lock;  // Protects merged.
+    unordered_map<string, Keys> merged;
+
+    IniLayersPrivate()
+    {
+        g_rw_lock_init(&lock);
+    }
+
+    ~IniLayersPrivate()
+    {
+        g_rw_lock_clear(&lock);
+    }
+
+    // Adds the keys of a layer that no earlier layer supplies. Called with lock held for writing.
+    void add_layer(size_t index)
+    {
+        IniParser const& layer = *layers[index];
+        string raw;
+        for (auto const& group : layer.get_groups())
+        {
+            Keys& keys = merged[group];
+            for (auto const& key : layer.get_keys(group))
+            {
+                if (keys.find(key) == keys.end() && layer.get_raw(group, key, raw))
+                {
+                    keys.emplace(key, Value{ index, move(raw) });
+                }
+            }
+        }
+    }
+
+    // Merges a key again after a change to the layer with index changed. A key that an
+    // earlier layer supplies is not affected. Called with lock held for writing.
+    void merge(string const& group, string const& key, size_t changed)
+    {
+        auto g = merged.find(group);
+        if (g != merged.end())
+        {
+            auto k = g->second.find(key);
+            if (k != g->second.end() && k->second.layer < changed)
+            {
+                return;
+            }
+        }
+
+        string raw;
+        for (size_t i = changed; i < layers.size(); ++i)
+        {
+            if (layers[i]->get_raw(group, key, raw))
+            {
+                Keys& keys = g != merged.end() ? g->second : merged[group];
+                keys[key] = Value{ i, move(raw) };
+                return;
+            }
+        }
+        if (g != merged.end())
+        {
+            g->second.erase(key);
+            if (g->second.empty())
+            {
+                merged.erase(g);
+            }
+        }
+    }
+
+    // Merges the keys of a group again after the layer with index changed removed it.
+    // Only the keys that layer supplied are affected. Called with lock held for writing.
+    void merge_group(string const& group, size_t changed)
+    {
+        auto g = merged.find(group);
+        if (g == merged.end())
+        {
+            return;
+        }
+        vector<string> keys;
+        for (auto const& k : g->second)
+        {
+            if (k.second.layer == changed)
+            {
+                keys.push_back(k.first);
+            }
+        }
+        for (auto const& key : keys)
+        {
+            merge(group, key, changed);
+        }
+    }
+
+    // Keeps the merged table of self up to date with the changes to its layers.
+    // A reload reports exactly which keys changed, and the set and remove methods
+    // report each key they change, so only those are merged again. The callbacks
+    // hold a weak reference, because a reload on a watcher thread can still be
+    // calling one after the destructor removed it.
+    static void follow_layers(shared_ptr<IniLayersPrivate> const& self)
+    {
+        weak_ptr<IniLayersPrivate> weak = self;
+        for (size_t i = 0; i < self->layers.size(); ++i)
+        {
+            IniParser& layer = *self->layers[i];
+            self->callback_ids.push_back(layer.add_change_callback([weak, i](IniParser::Changes const& changes)
+            {
+                auto d = weak.lock();
+                if (!d)
+                {
+                    return;
+                }
+                internal::WriterLock lock(d->lock);
+                for (auto const* keys : { &changes.added_keys, &changes.removed_keys, &changes.changed_keys })
+                {
+                    for (auto const& k : *keys)
+                    {
+                        d->merge(k.first, k.second, i);
+                    }
+                }
+            }));
+            self->edit_callback_ids.push_back(layer.add_edit_callback([weak, i](string const& group, string const& key)
+            {
+                auto d = weak.lock();
+                if (!d)
+                {
+                    return;
+                }
+                internal::WriterLock lock(d->lock);
+                if (key.empty())
+                {
+                    d->merge_group(group, i);
+                }
+                else
+                {
+                    d->merge(group, key, i);
+                }
+            }));
+        }
+    }
+
+    void unfollow_layers() noexcept
+    {
+        for (size_t i = 0; i < callback_ids.size(); ++i)
+        {
+            layers[i]->remove_change_callback(callback_ids[i]);
+        }
+        for (size_t i = 0; i < edit_callback_ids.size(); ++i)
+        {
+            layers[i]->remove_edit_callback(edit_callback_ids[i]);
+        }
+    }
+
+    // Returns the merged value of a key. Called with lock held for reading.
+    IniStatus find(string const& group, string const& key, IniSpan& raw) const noexcept
+    {
+        auto g = merged.find(group);
+        if (g == merged.end())
+        {
+            return IniStatus::GroupNotFound;
+        }
+        auto k = g->second.find(key);
+        if (k == g->second.end())
+        {
+            return IniStatus::KeyNotFound;
+        }
+        raw = IniSpan{ k->second.raw.data(), k->second.raw.size() };
+        return IniStatus::Ok;
+    }
+
+    // Returns the merged value of the best translation of a key. The first layer that has
+    // the key, translated or not, supplies it; within that layer, the first variant wins,
+    // and the untranslated key comes last. Called with lock held for reading.
+    IniStatus find_locale(string const& group,
+                          string const& key,
+                          vector<string> const& variants,
+                          IniSpan& raw) const
+    {
+        auto g = merged.find(group);
+        if (g == merged.end())
+        {
+            return IniStatus::GroupNotFound;
+        }
+        Value const* best = nullptr;
+        auto consider = [&](string const& name)
+        {
+            auto k = g->second.find(name);
+            if (k != g->second.end() && (!best || k->second.layer < best->layer))
+            {
+                best = &k->second;
+            }
+        };
+        string name;
+        for (auto const& v : variants)
+        {
+            name = key;
+            name += '[';
+            name += v;
+            name += ']';
+            consider(name);
+        }
+        consider(key);
+        if (!best)
+        {
+            return IniStatus::KeyNotFound;
+        }
+        raw = IniSpan{ best->raw.data(), best->raw.size() };
+        return IniStatus::Ok;
+    }
+};
+
+} // namespace internal
+
+using internal::IniData;
+using internal::IniLayersPrivate;
+using internal::IniSpan;
+using internal::IniStatus;
+
+namespace
+{
+
+template<typename T, typename Convert>
+T get_value(IniLayersPrivate& p, string const& group, string const& key, Convert convert, char const* prefix)
+{
+    internal::ReaderLock lock(p.lock);
+
+    IniSpan raw;
+    T value = T();
+    internal::check_ini_status(p.find(group, key, raw), prefix, p.name, group, key);
+    internal::check_ini_status(convert(raw, value), prefix, p.name, group, key);
+    return value;
+}
+
+template<typename T, typename Convert>
+bool try_get_value(IniLayersPrivate& p, string const& group, string const& key, Convert convert, T& value)
+{
+    internal::ReaderLock lock(p.lock);
+
+    IniSpan raw;
+    T v;
+    if (p.find(group, key, raw) != IniStatus::Ok || convert(raw, v) != IniStatus::Ok)
+    {
+        return false;
+    }
+    value = move(v);
+    return true;
+}
+
+template<typename T, typename Convert>
+T get_locale_value(IniLayersPrivate& p,
+                   string const& group,
+                   string const& key,
+                   string const& locale,
+                   Convert convert,
+                   char const* prefix)
+{
+    vector<string> variants = internal::locale_variants(locale);
+    internal::ReaderLock lock(p.lock);
+
+    IniSpan raw;
+    T value = T();
+    internal::check_ini_status(p.find_locale(group, key, variants, raw), prefix, p.name, group, key);
+    internal::check_ini_status(convert(raw, value), prefix, p.name, group, key);
+    return value;
+}
+
+template<typename T, typename Convert>
+bool try_get_locale_value(IniLayersPrivate& p,
+                          string const& group,
+                          string const& key,
+                          string const& locale,
+                          Convert convert,
+                          T& value)
+{
+    vector<string> variants = internal::locale_variants(locale);
+    internal::ReaderLock lock(p.lock);
+
+    IniSpan raw;
+    T v;
+    if (p.find_locale(group, key, variants, raw) != IniStatus::Ok || convert(raw, v) != IniStatus::Ok)
+    {
+        return false;
+    }
+    value = move(v);
+    return true;
+}
+
+} // namespace
+
+IniLayers::IniLayers(vector<IniParser::SPtr> layers)
+    : p(make_shared<IniLayersPrivate>())
+{
+    for (auto const& layer : layers)
+    {
+        if (!layer)
+        {
+            throw InvalidArgumentException("IniLayers(): layer cannot be null");
+        }
+    }
+    p->name = "<layers>";
+    p->layers = move(layers);
+
+    {
+        internal::WriterLock lock(p->lock);
+        for (size_t i = 0; i < p->layers.size(); ++i)
+        {
+            p->add_layer(i);
+        }
+    }
+
+    IniLayersPrivate::follow_layers(p);
+}
+
+IniLayers::UPtr IniLayers::from_xdg(const std::string& name, IniParser::Engine engine)
+{
+    vector<string> dirs{ g_get_user_config_dir() };
+    for (auto dir = g_get_system_config_dirs(); *dir; ++dir)
+    {
+        dirs.push_back(*dir);
+    }
+
+    vector<IniParser::SPtr> layers;
+    for (auto const& dir : dirs)
+    {
+        string path = dir + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0)
+        {
+            layers.push_back(make_shared<IniParser>(path.c_str(), engine));
+        }
+    }
+
+    UPtr result(new IniLayers(move(layers)));
+    result->p->name = name;
+    return result;
+}
+
+IniLayers::~IniLayers() noexcept
+{
+    p->unfollow_layers();
+}
+
+size_t IniLayers::size() const noexcept
+{
+    return p->layers.size();
+}
+
+IniParser::SPtr IniLayers::layer(size_t index) const
+{
+    if (index >= p->layers.size())
+    {
+        throw InvalidArgumentException("IniLayers::layer(): invalid index " + to_string(index) + " (layers: "
+                                       + to_string(p->layers.size()) + ")");
+    }
+    return p->layers[index];
+}
+
+int IniLayers::layer_of(const std::string& group, const std::string& key) const noexcept
+{
+    internal::ReaderLock lock(p->lock);
+
+    auto g = p->merged.find(group);
+    if (g == p->merged.end())
+    {
+        return -1;
+    }
+    auto k = g->second.find(key);
+    return k == g->second.end() ? -1 : static_cast<int>(k->second.layer);
+}
+
+vector<string> IniLayers::get_groups() const
+{
+    internal::ReaderLock lock(p->lock);
+
+    vector<string> groups;
+    for (auto const& g : p->merged)
+    {
+        groups.push_back(g.first);
+    }
+    sort(groups.begin(), groups.end());
+    return groups;
+}
+
+vector<string> IniLayers::get_keys(const std::string& group) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    auto g = p->merged.find(group);
+    if (g == p->merged.end())
+    {
+        internal::check_ini_status(IniStatus::GroupNotFound, "Could not get keys", p->name, group, string());
+    }
+    vector<string> keys;
+    for (auto const& k : g->second)
+    {
+        keys.push_back(k.first);
+    }
+    sort(keys.begin(), keys.end());
+    return keys;
+}
+
+bool IniLayers::has_group(const std::string& group) const noexcept
+{
+    internal::ReaderLock lock(p->lock);
+    return p->merged.find(group) != p->merged.end();
+}
+
+bool IniLayers::has_key(const std::string& group, const std::string& key) const noexcept
+{
+    return layer_of(group, key) != -1;
+}
+
+string IniLayers::get_string(const std::string& group, const std::string& key) const
+{
+    return get_value<string>(*p, group, key, IniData::to_string, "Could not get string value");
+}
+
+string IniLayers::get_locale_string(const std::string& group, const std::string& key, const std::string& locale) const
+{
+    return get_locale_value<string>(*p, group, key, locale, IniData::to_string, "Could not get localized string value");
+}
+
+bool IniLayers::get_boolean(const std::string& group, const std::string& key) const
+{
+    return get_value<bool>(*p, group, key, IniData::to_boolean, "Could not get boolean value");
+}
+
+int IniLayers::get_int(const std::string& group, const std::string& key) const
+{
+    return get_value<int>(*p, group, key, IniData::to_int, "Could not get integer value");
+}
+
+double IniLayers::get_double(const std::string& group, const std::string& key) const
+{
+    return get_value<double>(*p, group, key, IniData::to_double, "Could not get double value");
+}
+
+vector<string> IniLayers::get_string_array(const std::string& group, const std::string& key) const
+{
+    return get_value<vector<string>>(*p, group, key, IniData::to_string_list, "Could not get string array");
+}
+
+vector<string> IniLayers::get_locale_string_array(const std::string& group,
+                                                  const std::string& key,
+                                                  const std::string& locale) const
+{
+    return get_locale_value<vector<string>>(*p, group, key, locale, IniData::to_string_list,
+                                            "Could not get localized string array");
+}
+
+vector<bool> IniLayers::get_boolean_array(const std::string& group, const std::string& key) const
+{
+    return get_value<vector<bool>>(*p, group, key, IniData::to_boolean_list, "Could not get boolean array");
+}
+
+vector<int> IniLayers::get_int_array(const std::string& group, const std::string& key) const
+{
+    return get_value<vector<int>>(*p, group, key, IniData::to_int_list, "Could not get integer array");
+}
+
+vector<double> IniLayers::get_double_array(const std::string& group, const std::string& key) const
+{
+    return get_value<vector<double>>(*p, group, key, IniData::to_double_list, "Could not get double array");
+}
+
+bool IniLayers::try_get_string(const std::string& group, const std::string& key, std::string& value) const
+{
+    return try_get_value(*p, group, key, IniData::to_string, value);
+}
+
+bool IniLayers::try_get_locale_string(const std::string& group,
+                                      const std::string& key,
+                                      std::string& value,
+                                      const std::string& locale) const
+{
+    return try_get_locale_value(*p, group, key, locale, IniData::to_string, value);
+}
+
+bool IniLayers::try_get_boolean(const std::string& group, const std::string& key, bool& value) const noexcept
+{
+    return try_get_value(*p, group, key, IniData::to_boolean, value);
+}
+
+bool IniLayers::try_get_int(const std::string& group, const std::string& key, int& value) const noexcept
+{
+    return try_get_value(*p, group, key, IniData::to_int, value);
+}
+
+bool IniLayers::try_get_double(const std::string& group, const std::string& key, double& value) const noexcept
+{
+    return try_get_value(*p, group, key, IniData::to_double, value);
+}
+
+bool IniLayers::try_get_string_array(const std::string& group,
+                                     const std::string& key,
+                                     std::vector<std::string>& value) const
+{
+    return try_get_value(*p, group, key, IniData::to_string_list, value);
+}
+
+bool IniLayers::try_get_locale_string_array(const std::string& group,
+                                            const std::string& key,
+                                            std::vector<std::string>& value,
+                                            const std::string& locale) const
+{
+    return try_get_locale_value(*p, group, key, locale, IniData::to_string_list, value);
+}
+
+bool IniLayers::try_get_boolean_array(const std::string& group, const std::string& key, std::vector<bool>& value) const
+{
+    return try_get_value(*p, group, key, IniData::to_boolean_list, value);
+}
+
+bool IniLayers::try_get_int_array(const std::string& group, const std::string& key, std::vector<int>& value) const
+{
+    return try_get_value(*p, group, key, IniData::to_int_list, value);
+}
+
+bool IniLayers::try_get_double_array(const std::string& group, const std::string& key, std::vector<double>& value) const
+{
+    return try_get_value(*p, group, key, IniData::to_double_list, value);
+}
+
+string IniLayers::get_string_or(const std::string& group, const std::string& key, const std::string& default_value) const
+{
+    string value;
+    return try_get_string(group, key, value) ? value : default_value;
+}
+
+string IniLayers::get_locale_string_or(const std::string& group,
+                                      const std::string& key,
+                                      const std::string& default_value,
+                                      const std::string& locale) const
+{
+    string value;
+    return try_get_locale_string(group, key, value, locale) ? value : default_value;
+}
+
+bool IniLayers::get_boolean_or(const std::string& group, const std::string& key, bool default_value) const noexcept
+{
+    bool value = default_value;
+    try_get_boolean(group, key, value);
+    return value;
+}
+
+int IniLayers::get_int_or(const std::string& group, const std::string& key, int default_value) const noexcept
+{
+    int value = default_value;
+    try_get_int(group, key, value);
+    return value;
+}
+
+double IniLayers::get_double_or(const std::string& group, const std::string& key, double default_value) const noexcept
+{
+    double value = default_value;
+    try_get_double(group, key, value);
+    return value;
+}
+
+void IniLayers::update(size_t index)
+{
+    auto layer = this->layer(index);
+
+    // The keys the layer has now, and the keys it supplied before.
+    set<pair<string, string>> keys;
+    for (auto const& group : layer->get_groups())
+    {
+        for (auto const& key : layer->get_keys(group))
+        {
+            keys.emplace(group, key);
+        }
+    }
+
+    internal::WriterLock lock(p->lock);
+    for (auto const& g : p->merged)
+    {
+        for (auto const& k : g.second)
+        {
+            if (k.second.layer == index)
+            {
+                keys.emplace(g.first, k.first);
+            }
+        }
+    }
+    for (auto const& k : keys)
+    {
+        p->merge(k.first, k.second, index);
+    }
+}
+
+bool IniLayers::reload()
+{
+    bool reloaded = false;
+    for (auto const& layer : p->layers)
+    {
+        reloaded = layer->reload() || reloaded;
+    }
+    return reloaded;
+}
+
+} // namespace util
+
+} // namespace unity
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/IniLocale.h>
+#include <unity/util/internal/IniData.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+IniLocale::IniLocale(string locale)
+    : name_(move(locale))
+    , variants_(internal::locale_variants(name_))
+{
+}
+
+} // namespace util
+
+} // namespace unity
@@ -17,12 +17,38 @@
  */
 
 #include <unity/UnityExceptions.h>
+#include <unity/util/FileIO.h>
 #include <unity/util/IniParser.h>
-
-#include <mutex>
+#include <unity/util/ResourcePtr.h>
+#include <unity/util/internal/IniBatchPrivate.h>
+#include <unity/util/internal/IniData.h>
+#include <unity/util/internal/IniGroupPrivate.h>
+#include <unity/util/internal/IniPatch.h>
+#include <unity/util/internal/ParallelFor.h>
+#include <unity/util/internal/RWLock.h>
 
 #include <glib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace std;
 
 namespace unity
@@ -36,16 +62,80 @@ namespace internal
 
 struct IniParserPrivate
 {
-    GKeyFile *k;
+    GKeyFile *k = nullptr;
+    IniData::UPtr native;  // Set while the native engine serves lookups.
     string filename;
+    bool has_file = true;  // False if the data did not come from a named file.
     bool dirty = false;
+
+    // GKeyFile does not modify its state on lookups, so any number of readers can
+    // proceed in parallel; anything that changes the key file or the dirty flag
+    // takes the lock exclusively.
+    GRWLock lock;
+
+    // Keys and groups changed since the last sync, so sync() can rewrite just their lines.
+    // A group is in changed_groups if it was removed (and possibly added again).
+    map<string, set<string>> changed_keys;
+    set<string> changed_groups;
+
+    // Serializes writes to the file, so an older snapshot of the data can never
+    // overwrite a newer one. Always taken before lock.
+    mutex write_mutex;
+
+    // Identity of the file as it was loaded or last written, protected by write_mutex.
+    struct stat file_stat;
+    bool has_file_stat = false;
+
+    // State of the background writer used by sync_async(), protected by async_mutex.
+    mutex async_mutex;
+    condition_variable async_cond;
+    thread writer;
+    bool write_pending = false;     // A write is scheduled for write_deadline.
+    bool write_now = false;         // flush() or the destructor want the pending write without delay.
+    bool writing = false;           // The writer thread is writing the file.
+    bool stopping = false;
+    chrono::steady_clock::time_point write_deadline;
+    exception_ptr async_error;      // Error of the last failed background write, reported by flush().
+
+    // Change callbacks, edit callbacks and the inotify watcher, protected by watch_mutex.
+    mutex watch_mutex;
+    typedef function<void(const string&, const string&)> EditCallback;  // Same as IniParser::EditCallback.
+    map<unsigned, IniParser::ChangeCallback> callbacks;
+    map<unsigned, EditCallback> edit_callbacks;
+    unsigned next_callback_id = 1;
+    thread watcher;
+    int stop_pipe[2] = { -1, -1 };  // Written to by the destructor to stop the watcher.
+
+    // Immutable copy of the contents for snapshot(). Once snapshots is set (under lock),
+    // every change publishes a new one with atomic_store() before it releases the lock.
+    // Readers only call atomic_load(), so they never wait for the lock.
+    bool snapshots = false;
+    IniParser::SCPtr snapshot;
 };
 
-static std::mutex parser_mutex;
+// Gives the implementation access to the names and hashes stored in an IniKey.
+
+struct IniKeyAccess
+{
+    static IniName group(const IniKey& k) noexcept
+    {
+        return IniName{ k.group_.data(), k.group_.size(), k.group_hash_ };
+    }
+
+    static IniName key(const IniKey& k) noexcept
+    {
+        return IniName{ k.key_.data(), k.key_.size(), k.key_hash_ };
+    }
+};
 
 }
 
+using internal::IniData;
+using internal::IniKeyAccess;
+using internal::IniName;
 using internal::IniParserPrivate;
+using internal::IniSpan;
+using internal::IniStatus;
 
 /*
  * This is not a private member function, because it takes
@@ -68,432 +158,2684 @@ static void inspect_error(GError* e, const char* prefix, const string& filename,
     }
 }
 
-IniParser::IniParser(const char* filename)
+/*
+ * Equivalent of inspect_error() for lookups served by the native engine.
+ */
+
+static void inspect_status(IniStatus s, const char* prefix, const string& filename,
+                           const string& group, const string& key)
+{
+    internal::check_ini_status(s, prefix, filename, group, key);
+}
+
+/*
+ * The native engine is read-only. The first modification hands its text
+ * to a GKeyFile, which then serves all further requests.
+ */
+
+static void make_writable(IniParserPrivate* p)
 {
+    if (!p->native)
+    {
+        return;
+    }
+
     GKeyFile* kf = g_key_file_new();
-    GError* e = nullptr;
     if (!kf)
     {
         throw ResourceException("Could not create keyfile parser."); // LCOV_EXCL_LINE
     }
-    if (!g_key_file_load_from_file(kf, filename, G_KEY_FILE_KEEP_TRANSLATIONS, &e))
+    string rebuilt;
+    IniSpan text = p->native->text();
+    if (p->native->compacted())
+    {
+        rebuilt = p->native->to_text();
+        text = IniSpan{ rebuilt.data(), rebuilt.size() };
+    }
+    GError* e = nullptr;
+    if (!g_key_file_load_from_data(kf, text.data, text.size, G_KEY_FILE_KEEP_TRANSLATIONS, &e))
     {
-        string message = "Could not load ini file ";
-        message += filename;
-        message += ": ";
-        message += e->message;
-        int errnum = e->code;
-        g_error_free(e);
         g_key_file_free(kf);
-        throw FileException(message, errnum);
+        inspect_error(e, "Could not make ini file writable", p->filename, string());
     }
 
-    p = new IniParserPrivate();
     p->k = kf;
-    p->filename = filename;
+    p->native.reset();
 }
 
-IniParser::~IniParser() noexcept
+static void throw_load_error(GError* e, GKeyFile* kf, const string& name)
 {
-    g_key_file_free(p->k);
-    delete p;
+    string message = "Could not load ini file ";
+    message += name;
+    message += ": ";
+    message += e->message;
+    int errnum = e->code;
+    g_error_free(e);
+    g_key_file_free(kf);
+    throw FileException(message, errnum);
 }
 
-bool IniParser::has_group(const std::string& group) const noexcept
+static GKeyFile* new_key_file()
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    gboolean rval;
-    rval = g_key_file_has_group(p->k, group.c_str());
-    return rval;
+    GKeyFile* kf = g_key_file_new();
+    if (!kf)
+    {
+        throw ResourceException("Could not create keyfile parser."); // LCOV_EXCL_LINE
+    }
+    return kf;
 }
 
-bool IniParser::has_key(const std::string& group, const std::string& key) const
+static GKeyFile* load_key_file(const char* filename)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    gboolean rval;
+    GKeyFile* kf = new_key_file();
     GError* e = nullptr;
-    rval = g_key_file_has_key(p->k, group.c_str(), key.c_str(), &e);
-    inspect_error(e, "Error checking for key existence", p->filename, group);
-    return rval;
+    if (!g_key_file_load_from_file(kf, filename, G_KEY_FILE_KEEP_TRANSLATIONS, &e))
+    {
+        throw_load_error(e, kf, filename);
+    }
+    return kf;
 }
 
-std::string IniParser::get_string(const std::string& group, const std::string& key) const
+static GKeyFile* load_key_file(const char* data, size_t size, const string& name)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    gchar* value;
+    GKeyFile* kf = new_key_file();
     GError* e = nullptr;
-    string result;
-    value = g_key_file_get_string(p->k, group.c_str(), key.c_str(), &e);
-    inspect_error(e, "Could not get string value", p->filename, group);
-    result = value;
-    g_free(value);
-    return result;
+    if (!g_key_file_load_from_data(kf, data, size, G_KEY_FILE_KEEP_TRANSLATIONS, &e))
+    {
+        throw_load_error(e, kf, name);
+    }
+    return kf;
 }
 
-std::string IniParser::get_locale_string(const std::string& group, const std::string& key, const std::string& locale) const
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    gchar* value;
-    GError* e = nullptr;
-    string result;
-    value = g_key_file_get_locale_string(p->k, group.c_str(), key.c_str(), locale.empty() ? nullptr : locale.c_str(), &e);
-    inspect_error(e, "Could not get localized string value", p->filename, group);
-    result = value;
-    g_free(value);
-    return result;
-}
+/*
+ * Helpers for the non-throwing lookups. A missing group or key must not
+ * allocate, so the GKeyFile variants check for the key without a GError
+ * before asking for the value.
+ */
 
-bool IniParser::get_boolean(const std::string& group, const std::string& key) const
+static bool has_key_quietly(GKeyFile* k, const string& group, const string& key) noexcept
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    bool rval;
-    GError* e = nullptr;
-    rval = g_key_file_get_boolean(p->k, group.c_str(), key.c_str(), &e);
-    inspect_error(e, "Could not get boolean value", p->filename, group);
-    return rval;
+    return g_key_file_has_key(k, group.c_str(), key.c_str(), nullptr);
 }
 
-int IniParser::get_int(const std::string& group, const std::string& key) const
+/*
+ * Builds the names of the translations of a key, "key[lang]", in a buffer on
+ * the stack, so that probing for a translation does not allocate unless the
+ * name is unusually long.
+ */
+
+class TranslationName final
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+public:
+    explicit TranslationName(const string& key)
+        : key_(key)
+    {
+    }
 
-    int rval;
-    GError* e = nullptr;
-    rval = g_key_file_get_integer(p->k, group.c_str(), key.c_str(), &e);
-    inspect_error(e, "Could not get integer value", p->filename, group);
-    return rval;
-}
+    TranslationName(TranslationName const&) = delete;
+    TranslationName& operator=(TranslationName const&) = delete;
 
-double IniParser::get_double(const std::string& group, const std::string& key) const
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    // The returned name is valid until the next call.
+    const char* of(const char* lang, size_t lang_size)
+    {
+        size_t const size = key_.size() + lang_size + 2;
+        char* name = buf_;
+        if (size >= sizeof(buf_))
+        {
+            long_.resize(size + 1);
+            name = &long_[0];
+        }
+        memcpy(name, key_.data(), key_.size());
+        name[key_.size()] = '[';
+        memcpy(name + key_.size() + 1, lang, lang_size);
+        name[size - 1] = ']';
+        name[size] = '\0';
+        return name;
+    }
 
-    double rval;
-    GError* e = nullptr;
-    rval = g_key_file_get_double(p->k, group.c_str(), key.c_str(), &e);
-    inspect_error(e, "Could not get double value", p->filename, group);
-    return rval;
-}
+private:
+    const string& key_;
+    char buf_[256];
+    string long_;
+};
 
-std::vector<std::string> IniParser::get_string_array(const std::string& group, const std::string& key) const
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+/*
+ * Returns true if the untranslated key, or a translation of it that
+ * g_key_file_get_locale_string() would find, exists. This lets the try_get
+ * methods return false for a missing key without allocating the GError that
+ * the GKeyFile lookup would report. The variants of an explicit locale are
+ * kept for the next call on the same thread, as the native engine does.
+ */
 
-    vector<string> result;
-    GError* e = nullptr;
-    gchar** strlist;
-    gsize count;
-    strlist = g_key_file_get_string_list(p->k, group.c_str(), key.c_str(), &count, &e);
-    inspect_error(e, "Could not get string array", p->filename, group);
-    for (gsize i = 0; i < count; i++)
+static bool has_locale_key_quietly(GKeyFile* k, const string& group, const string& key, const string& locale)
+{
+    if (has_key_quietly(k, group, key))
     {
-        result.push_back(strlist[i]);
+        return true;
+    }
+    if (!g_key_file_has_group(k, group.c_str()))
+    {
+        return false;
     }
-    g_strfreev(strlist);
-    return result;
-}
 
-std::vector<std::string> IniParser::get_locale_string_array(const std::string& group,
-                                                            const std::string& key,
-                                                            const std::string& locale) const
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    TranslationName name(key);
+    auto has_translation = [&](const char* lang, size_t lang_size)
+    {
+        return bool(g_key_file_has_key(k, group.c_str(), name.of(lang, lang_size), nullptr));
+    };
 
-    vector<string> result;
-    GError* e = nullptr;
-    gchar** strlist;
-    gsize count;
-    strlist = g_key_file_get_locale_string_list(p->k, group.c_str(), key.c_str(),
-                                                locale.empty() ? nullptr : locale.c_str(), &count, &e);
-    inspect_error(e, "Could not get localized string array", p->filename, group);
-    for (gsize i = 0; i < count; i++)
+    if (locale.empty())
     {
-        result.push_back(strlist[i]);
+        for (gchar const* const* l = g_get_language_names(); *l; ++l)
+        {
+            if (has_translation(*l, strlen(*l)))
+            {
+                return true;
+            }
+        }
+        return false;
     }
-    g_strfreev(strlist);
-    return result;
-}
-
-vector<bool> IniParser::get_boolean_array(const std::string& group, const std::string& key) const
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
 
-    vector<bool> result;
-    GError* e = nullptr;
-    gboolean* bools;
-    gsize count;
-    bools = g_key_file_get_boolean_list(p->k, group.c_str(), key.c_str(), &count, &e);
-    inspect_error(e, "Could not get boolean array", p->filename, group);
-    for (gsize i = 0; i < count; i++)
+    static thread_local string last_locale;
+    static thread_local vector<string> last_variants;
+    if (locale != last_locale || last_variants.empty())
     {
-        result.push_back(bools[i]);
+        last_variants = internal::locale_variants(locale);
+        last_locale = locale;
     }
-    g_free(bools);
-    return result;
+    for (auto const& v : last_variants)
+    {
+        if (has_translation(v.data(), v.size()))
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
-vector<int> IniParser::get_int_array(const std::string& group, const std::string& key) const
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+/*
+ * Returns the name of the first translation of key that exists for one of the
+ * variants of locale, or key itself if there is none. Only the name that is
+ * found is copied to the heap.
+ */
 
-    vector<int> result;
-    GError* e = nullptr;
-    gint* ints;
-    gsize count;
-    ints = g_key_file_get_integer_list(p->k, group.c_str(), key.c_str(), &count, &e);
-    inspect_error(e, "Could not get integer array", p->filename, group);
-    for (gsize i = 0; i < count; i++)
+static string translated_key(GKeyFile* k, const string& group, const string& key, const IniLocale& locale)
+{
+    TranslationName name(key);
+    for (auto const& v : locale.variants())
     {
-        result.push_back(ints[i]);
+        const char* candidate = name.of(v.data(), v.size());
+        if (g_key_file_has_key(k, group.c_str(), candidate, nullptr))
+        {
+            return candidate;
+        }
     }
-    g_free(ints);
-    return result;
+    return key;
 }
 
-vector<double> IniParser::get_double_array(const std::string& group, const std::string& key) const
+static bool clear_error(GError* e) noexcept
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    vector<double> result;
-    GError* e = nullptr;
-    gdouble* doubles;
-    gsize count;
-    doubles = g_key_file_get_double_list(p->k, group.c_str(), key.c_str(), &count, &e);
-    inspect_error(e, "Could not get double array", p->filename, group);
-    for (gsize i = 0; i < count; i++)
+    if (e)
     {
-        result.push_back(doubles[i]);
+        g_error_free(e);
+        return true;
     }
-    g_free(doubles);
-    return result;
+    return false;
 }
 
-string IniParser::get_start_group() const
+template<typename T, typename Convert>
+static bool try_native(IniSpan raw, Convert convert, T& value)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    gchar* sg = g_key_file_get_start_group(p->k);
-    string result(sg);
-    g_free(sg);
-    return result;
+    T v;
+    if (convert(raw, v) != IniStatus::Ok)
+    {
+        return false;
+    }
+    value = move(v);
+    return true;
 }
 
-vector<string> IniParser::get_groups() const
+template<typename T, typename GT>
+static bool take_glib_list(GT* list, gsize count, GError* e, vector<T>& value)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    vector<string> result;
-    gsize count;
-    gchar** groups = g_key_file_get_groups(p->k, &count);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    vector<T> result;
+    result.reserve(count);
     for (gsize i = 0; i < count; i++)
     {
-        result.push_back(groups[i]);
+        result.push_back(list[i]);
     }
-    g_strfreev(groups);
-    return result;
+    g_free(list);
+    value = move(result);
+    return true;
 }
 
-vector<string> IniParser::get_keys(const std::string& group) const
+static bool take_glib_strv(gchar** strlist, gsize count, GError* e, vector<string>& value)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
+    if (clear_error(e))
+    {
+        return false;
+    }
     vector<string> result;
-    GError* e = nullptr;
-    gchar** strlist;
-    gsize count = 0;
-    IniParserPrivate f;
-    strlist = g_key_file_get_keys(p->k, group.c_str(), &count, &e);
-    inspect_error(e, "Could not get list of keys", p->filename, group);
+    result.reserve(count);
     for (gsize i = 0; i < count; i++)
     {
         result.push_back(strlist[i]);
     }
     g_strfreev(strlist);
-    return result;
+    value = move(result);
+    return true;
 }
 
-bool IniParser::remove_group(const std::string& group)
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+/*
+ * Appends a key/value line for a group snapshot if the key, or the key that
+ * it translates, is one of the requested keys.
+ */
 
-    gboolean rval;
-    GError* e = nullptr;
-    rval = g_key_file_remove_group(p->k, group.c_str(), &e);
-    inspect_error(e, "Error removing group", p->filename, group);
-    return rval;
+static void add_snapshot_line(string& text, const char* key, size_t key_size,
+                              const char* value, size_t value_size, const vector<string>* wanted)
+{
+    if (wanted)
+    {
+        const char* bracket = static_cast<const char*>(memchr(key, '[', key_size));
+        size_t base_size = bracket ? bracket - key : key_size;
+        auto matches = [key, base_size](const string& w)
+        {
+            return w.size() == base_size && w.compare(0, base_size, key, base_size) == 0;
+        };
+        if (find_if(wanted->begin(), wanted->end(), matches) == wanted->end())
+        {
+            return;
+        }
+    }
+    text.append(key, key_size);
+    text += '=';
+    text.append(value, value_size);
+    text += '\n';
 }
 
-bool IniParser::remove_key(const std::string& group, const std::string& key)
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+// Set by IniParser::share_names().
+static atomic<bool> names_shared(false);
 
-    gboolean rval;
-    GError* e = nullptr;
-    rval = g_key_file_remove_key(p->k, group.c_str(), key.c_str(), &e);
-    inspect_error(e, "Error removing key", p->filename, group);
-    return rval;
+static IniData::UPtr shared_names(IniData::UPtr data)
+{
+    if (names_shared.load(memory_order_relaxed))
+    {
+        data->compact();
+    }
+    return data;
 }
 
-void IniParser::set_string(const std::string& group, const std::string& key, const std::string& value)
+static IniParserPrivate* new_private(GKeyFile* kf, IniData::UPtr native, const string& filename, bool has_file)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    g_key_file_set_string(p->k, group.c_str(), key.c_str(), value.c_str());
-    p->dirty = true;
+    IniParserPrivate* p = new IniParserPrivate();
+    p->k = kf;
+    p->native = move(native);
+    p->filename = filename;
+    p->has_file = has_file;
+    g_rw_lock_init(&p->lock);
+    return p;
 }
 
-void IniParser::set_locale_string(const std::string& group, const std::string& key,
-                                  const std::string& value, const std::string& locale)
+static void mark_changed(IniParserPrivate* p, const string& group, const string& key)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    g_key_file_set_locale_string(p->k, group.c_str(), key.c_str(), locale.c_str(), value.c_str());
+    p->changed_keys[group].insert(key);
     p->dirty = true;
 }
 
-void IniParser::set_boolean(const std::string& group, const std::string& key, bool value)
+static void mark_changed(IniParserPrivate* p, const string& group)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
-
-    g_key_file_set_boolean(p->k, group.c_str(), key.c_str(), value);
+    p->changed_groups.insert(group);
     p->dirty = true;
 }
 
-void IniParser::set_int(const std::string& group, const std::string& key, int value)
-{
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+// Tells the edit callbacks about a key changed by a set or remove method, or a
+// removed group if key is empty. Called after the lock is released, so that the
+// callbacks can read the parser.
 
-    g_key_file_set_integer(p->k, group.c_str(), key.c_str(), value);
-    p->dirty = true;
+static void notify_edit(IniParserPrivate* p, const string& group, const string& key)
+{
+    vector<IniParserPrivate::EditCallback> callbacks;
+    {
+        lock_guard<mutex> lock(p->watch_mutex);
+        for (auto const& c : p->edit_callbacks)
+        {
+            callbacks.push_back(c.second);
+        }
+    }
+    for (auto const& callback : callbacks)
+    {
+        callback(group, key);
+    }
+}
+
+static bool same_file_version(const struct stat& a, const struct stat& b) noexcept
+{
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size
+           && a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+// Reads the file into text if it is still the version that was loaded or last written.
+// Otherwise, returns false, and the caller writes the whole key file instead.
+
+static bool read_unchanged_file(IniParserPrivate* p, string& text)
+{
+    if (!p->has_file_stat)
+    {
+        return false;
+    }
+    int fd = open(p->filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    bool unchanged = fstat(fd, &st) == 0 && same_file_version(st, p->file_stat);
+    if (unchanged)
+    {
+        try
+        {
+            text = internal::read_fd(fd, p->filename);
+        }
+        catch (const FileException&)
+        {
+            unchanged = false;
+        }
+    }
+    close(fd);
+    return unchanged;
+}
+
+// Collects the current values of everything that changed since the last sync.
+
+static void make_patch(IniParserPrivate* p, internal::IniPatch& patch)
+{
+    for (auto const& group : p->changed_groups)
+    {
+        patch.remove_group(group);
+        gsize count = 0;
+        gchar** keys = g_key_file_get_keys(p->k, group.c_str(), &count, nullptr);
+        for (gsize i = 0; i < count; i++)
+        {
+            gchar* value = g_key_file_get_value(p->k, group.c_str(), keys[i], nullptr);
+            if (value)
+            {
+                patch.set_value(group, keys[i], value);
+                g_free(value);
+            }
+        }
+        g_strfreev(keys);
+    }
+    for (auto const& changed : p->changed_keys)
+    {
+        const string& group = changed.first;
+        if (p->changed_groups.count(group))
+        {
+            continue;
+        }
+        for (auto const& key : changed.second)
+        {
+            gchar* value = g_key_file_get_value(p->k, group.c_str(), key.c_str(), nullptr);
+            if (value)
+            {
+                patch.set_value(group, key, value);
+                g_free(value);
+            }
+            else
+            {
+                patch.remove_key(group, key);
+            }
+        }
+    }
+}
+
+/*
+ * Writes the key file if it has unsaved changes. If the file on disk is still the
+ * version that was loaded or last written, only the lines of the changed keys and
+ * groups are replaced, and comments and layout are kept; otherwise, the whole key
+ * file is written out. The data is collected under the writer lock, but the file
+ * is read and written after the lock is released, so readers and writers are not
+ * held up by disk I/O. write_text_file() writes to a temporary file and renames it,
+ * so the file is replaced atomically.
+ */
+
+static void write_file(IniParserPrivate* p)
+{
+    lock_guard<mutex> serialize(p->write_mutex);
+
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (!p->dirty)
+        {
+            return;
+        }
+        if (!p->has_file)
+        {
+            throw LogicException("Cannot sync ini data that was not loaded from a file: " + p->filename);
+        }
+    }
+
+    string base;
+    bool patch_base = read_unchanged_file(p, base);
+
+    string text;
+    internal::IniPatch patch;
+    map<string, set<string>> changed_keys;
+    set<string> changed_groups;
+    {
+        internal::WriterLock lock(p->lock);
+
+        if (patch_base)
+        {
+            make_patch(p, patch);
+        }
+        else
+        {
+            gsize length;
+            gchar* data = g_key_file_to_data(p->k, &length, nullptr);
+            text.assign(data, length);
+            g_free(data);
+        }
+        changed_keys.swap(p->changed_keys);
+        changed_groups.swap(p->changed_groups);
+        p->dirty = false;
+    }
+
+    if (patch_base)
+    {
+        text = patch.apply(base);
+    }
+
+    struct stat written;
+    try
+    {
+        write_text_file(p->filename, text, SyncPolicy::File, &written);
+    }
+    catch (const FileException& e)
+    {
+        {
+            // The changes are still unsaved.
+            internal::WriterLock lock(p->lock);
+            for (auto const& changed : changed_keys)
+            {
+                p->changed_keys[changed.first].insert(changed.second.begin(), changed.second.end());
+            }
+            p->changed_groups.insert(changed_groups.begin(), changed_groups.end());
+            p->dirty = true;
+        }
+        throw FileException("Could not write ini file " + p->filename + ": " + e.reason(), e.error());
+    }
+
+    // The status of the file we wrote, not of whatever is at p->filename by now.
+    p->file_stat = written;
+    p->has_file_stat = true;
+}
+
+// Raw values of all keys, by group and key. Used to find out what a reload changed.
+typedef map<string, map<string, string>> IniContents;
+
+static IniContents contents_of(const IniData& data)
+{
+    IniContents contents;
+    vector<pair<IniSpan, IniSpan>> entries;
+    for (auto const& group : data.groups())
+    {
+        auto& keys = contents[group];
+        entries.clear();
+        data.entries(group, entries);
+        for (auto const& e : entries)
+        {
+            keys[e.first.str()] = e.second.str();  // Later duplicates win, as for lookups.
+        }
+    }
+    return contents;
+}
+
+static IniContents contents_of(GKeyFile* kf)
+{
+    IniContents contents;
+    gchar** groups = g_key_file_get_groups(kf, nullptr);
+    for (gchar** g = groups; *g; ++g)
+    {
+        auto& keys = contents[*g];
+        gchar** key_list = g_key_file_get_keys(kf, *g, nullptr, nullptr);
+        for (gchar** k = key_list; k && *k; ++k)
+        {
+            gchar* value = g_key_file_get_value(kf, *g, *k, nullptr);
+            if (value)
+            {
+                keys[*k] = value;
+                g_free(value);
+            }
+        }
+        g_strfreev(key_list);
+    }
+    g_strfreev(groups);
+    return contents;
+}
+
+static IniParser::Changes compare_contents(const IniContents& before, const IniContents& after)
+{
+    IniParser::Changes changes;
+    auto b = before.begin();
+    auto a = after.begin();
+    while (b != before.end() || a != after.end())
+    {
+        if (a == after.end() || (b != before.end() && b->first < a->first))
+        {
+            changes.removed_groups.push_back(b->first);
+            for (auto const& k : b->second)
+            {
+                changes.removed_keys.emplace_back(b->first, k.first);
+            }
+            ++b;
+        }
+        else if (b == before.end() || a->first < b->first)
+        {
+            changes.added_groups.push_back(a->first);
+            for (auto const& k : a->second)
+            {
+                changes.added_keys.emplace_back(a->first, k.first);
+            }
+            ++a;
+        }
+        else
+        {
+            const string& group = a->first;
+            auto bk = b->second.begin();
+            auto ak = a->second.begin();
+            while (bk != b->second.end() || ak != a->second.end())
+            {
+                if (ak == a->second.end() || (bk != b->second.end() && bk->first < ak->first))
+                {
+                    changes.removed_keys.emplace_back(group, bk->first);
+                    ++bk;
+                }
+                else if (bk == b->second.end() || ak->first < bk->first)
+                {
+                    changes.added_keys.emplace_back(group, ak->first);
+                    ++ak;
+                }
+                else
+                {
+                    if (ak->second != bk->second)
+                    {
+                        changes.changed_keys.emplace_back(group, ak->first);
+                    }
+                    ++ak;
+                    ++bk;
+                }
+            }
+            ++a;
+            ++b;
+        }
+    }
+    return changes;
+}
+
+// Waits for inotify events for the file and reloads it, until the stop pipe becomes readable.
+
+static void run_watcher(IniParser* parser, int inotify_fd, int stop_fd, string name)
+{
+    alignas(struct inotify_event) char buf[4096];
+    pollfd fds[2] = { { inotify_fd, POLLIN, 0 }, { stop_fd, POLLIN, 0 } };
+    for (;;)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;  // LCOV_EXCL_LINE
+        }
+        if (fds[1].revents)
+        {
+            break;
+        }
+
+        // Drain all queued events, so a burst of events causes one reload.
+        bool changed = false;
+        ssize_t len;
+        while ((len = read(inotify_fd, buf, sizeof(buf))) > 0)
+        {
+            for (char* ptr = buf; ptr < buf + len;)
+            {
+                auto event = reinterpret_cast<struct inotify_event*>(ptr);
+                if (event->len && name == event->name)
+                {
+                    changed = true;
+                }
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed)
+        {
+            try
+            {
+                parser->reload();
+            }
+            catch (const std::exception&)
+            {
+                // The file may be in the middle of being rewritten; we try again on the next change.
+            }
+        }
+    }
+    close(inotify_fd);
+}
+
+static void run_writer(IniParserPrivate* p)
+{
+    unique_lock<mutex> lock(p->async_mutex);
+    for (;;)
+    {
+        p->async_cond.wait(lock, [p] { return p->write_pending || p->stopping; });
+        if (!p->write_pending)
+        {
+            return;
+        }
+
+        // Let further changes accumulate until the deadline, unless someone is waiting.
+        p->async_cond.wait_until(lock, p->write_deadline, [p] { return p->write_now || p->stopping; });
+        p->write_pending = false;
+        p->write_now = false;
+        p->writing = true;
+
+        lock.unlock();
+        exception_ptr error;
+        try
+        {
+            write_file(p);
+        }
+        catch (...)
+        {
+            error = current_exception();
+        }
+        lock.lock();
+
+        p->writing = false;
+        if (error)
+        {
+            p->async_error = error;
+        }
+        p->async_cond.notify_all();
+    }
+}
+
+IniParser::IniParser(const char* filename)
+    : IniParser(filename, Engine::GKeyFile)
+{
+}
+
+IniParser::IniParser(const char* filename, Engine engine)
+{
+    // Taken before loading, so a change to the file while we load it is noticed by sync().
+    struct stat st;
+    bool has_stat = stat(filename, &st) == 0;
+
+    IniData::UPtr native;
+    GKeyFile* kf = nullptr;
+    if (engine != Engine::GKeyFile)
+    {
+        native = shared_names(IniData::open(filename, engine == Engine::Lazy));
+    }
+    else
+    {
+        kf = load_key_file(filename);
+    }
+    p = new_private(kf, move(native), filename, true);
+    p->file_stat = st;
+    p->has_file_stat = has_stat;
+}
+
+// Returns the name of the cache file for filename in cache_dir. The name is a hash of
+// the path, so different files (almost certainly) get different cache files.
+
+static string cache_file_for(const string& filename, const string& cache_dir)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : filename)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.inicache", static_cast<unsigned long long>(h));
+    return cache_dir + "/" + name;
+}
+
+IniParser::IniParser(const char* filename, const std::string& cache_dir)
+{
+    struct stat st;
+    bool has_stat = stat(filename, &st) == 0;
+
+    IniData::UPtr native = IniData::open_cached(filename, cache_file_for(filename, cache_dir));
+    p = new_private(nullptr, move(native), filename, true);
+    p->file_stat = st;
+    p->has_file_stat = has_stat;
+}
+
+IniParser::IniParser(internal::IniParserPrivate* d) noexcept
+    : p(d)
+{
+}
+
+IniParser::UPtr IniParser::from_data(std::string data, Engine engine)
+{
+    static const string name = "<data>";
+
+    IniData::UPtr native;
+    GKeyFile* kf = nullptr;
+    if (engine != Engine::GKeyFile)
+    {
+        native = shared_names(IniData::from_string(move(data), name, engine == Engine::Lazy));
+    }
+    else
+    {
+        kf = load_key_file(data.data(), data.size(), name);
+    }
+    return UPtr(new IniParser(new_private(kf, move(native), name, false)));
+}
+
+IniParser::UPtr IniParser::from_data(const void* data, std::size_t size, Engine engine)
+{
+    if (engine != Engine::GKeyFile)
+    {
+        return from_data(string(static_cast<const char*>(data), size), engine);
+    }
+    // GKeyFile copies the data anyway, so we pass the buffer straight through.
+    static const string name = "<data>";
+    GKeyFile* kf = load_key_file(static_cast<const char*>(data), size, name);
+    return UPtr(new IniParser(new_private(kf, nullptr, name, false)));
+}
+
+IniParser::UPtr IniParser::from_fd(int fd, Engine engine)
+{
+    string name = "<fd " + to_string(fd) + ">";
+
+    IniData::UPtr native;
+    GKeyFile* kf = nullptr;
+    if (engine != Engine::GKeyFile)
+    {
+        native = shared_names(IniData::from_fd(fd, name, engine == Engine::Lazy));
+    }
+    else
+    {
+        string text = internal::read_fd(fd, name);
+        kf = load_key_file(text.data(), text.size(), name);
+    }
+    return UPtr(new IniParser(new_private(kf, move(native), name, false)));
+}
+
+// Adds the files in dir whose names end with suffix. Subdirectories are skipped.
+
+static void list_directory(const string& dir, const string& suffix, vector<string>& files)
+{
+    DIR* dirp = opendir(dir.c_str());
+    if (!dirp)
+    {
+        int err = errno;
+        throw FileException("Could not open directory " + dir + ": " + strerror(err), err);
+    }
+    ResourcePtr<DIR*, std::function<void(DIR*)>> dir_ptr(dirp, [](DIR* d) { closedir(d); });
+
+    struct dirent* entry;
+    while ((entry = readdir(dir_ptr.get())) != nullptr)
+    {
+        string name = entry->d_name;
+        if (name.size() < suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            continue;
+        }
+        string path = dir + "/" + name;
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+        {
+            struct stat st;
+            is_dir = stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (!is_dir)
+        {
+            files.push_back(move(path));
+        }
+    }
+}
+
+IniParser::LoadResult IniParser::load_all(const std::vector<std::string>& paths,
+                                          const std::string& suffix,
+                                          Engine engine,
+                                          unsigned max_threads)
+{
+    LoadResult result;
+
+    vector<string> files;
+    for (auto const& path : paths)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+        {
+            result.errors[path] = string("Could not load ini file ") + path + ": " + strerror(errno);
+        }
+        else if (S_ISDIR(st.st_mode))
+        {
+            try
+            {
+                list_directory(path, suffix, files);
+            }
+            catch (const FileException& e)
+            {
+                result.errors[path] = e.what();
+            }
+        }
+        else
+        {
+            files.push_back(path);
+        }
+    }
+    sort(files.begin(), files.end());
+    files.erase(unique(files.begin(), files.end()), files.end());
+
+    // Each worker stores the outcome in the slot for its file.
+    vector<UPtr> parsers(files.size());
+    vector<string> errors(files.size());
+    size_t num_threads = max_threads ? max_threads : max(1u, thread::hardware_concurrency());
+    internal::parallel_for(files.size(), num_threads, [&](size_t i)
+    {
+        try
+        {
+            parsers[i].reset(new IniParser(files[i].c_str(), engine));
+        }
+        catch (const std::exception& e)
+        {
+            errors[i] = e.what();
+        }
+    });
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (parsers[i])
+        {
+            result.parsers[files[i]] = move(parsers[i]);
+        }
+        else
+        {
+            result.errors[files[i]] = move(errors[i]);
+        }
+    }
+    return result;
+}
+
+void IniParser::share_names(bool enable) noexcept
+{
+    names_shared = enable;
+}
+
+IniParser::SharedNameStats IniParser::shared_name_stats() noexcept
+{
+    SharedNameStats stats;
+    internal::interned_name_stats(stats.names, stats.bytes);
+    return stats;
+}
+
+IniParser::~IniParser() noexcept
+{
+    if (p->watcher.joinable())
+    {
+        char c = 0;
+        while (write(p->stop_pipe[1], &c, 1) < 0 && errno == EINTR)
+        {
+        }
+        p->watcher.join();
+        close(p->stop_pipe[0]);
+        close(p->stop_pipe[1]);
+    }
+
+    // Pending background writes are completed, but errors can no longer be reported.
+    {
+        lock_guard<mutex> lock(p->async_mutex);
+        p->stopping = true;
+        p->async_cond.notify_all();
+    }
+    if (p->writer.joinable())
+    {
+        p->writer.join();
+    }
+
+    g_rw_lock_clear(&p->lock);
+    if (p->k)
+    {
+        g_key_file_free(p->k);
+    }
+    delete p;
+}
+
+bool IniParser::has_group(const std::string& group) const noexcept
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        return p->native->has_group(group);
+    }
+
+    gboolean rval;
+    rval = g_key_file_has_group(p->k, group.c_str());
+    return rval;
+}
+
+bool IniParser::has_key(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        bool found = false;
+        inspect_status(p->native->has_key(group, key, found), "Error checking for key existence",
+                       p->filename, group, key);
+        return found;
+    }
+
+    gboolean rval;
+    GError* e = nullptr;
+    rval = g_key_file_has_key(p->k, group.c_str(), key.c_str(), &e);
+    inspect_error(e, "Error checking for key existence", p->filename, group);
+    return rval;
+}
+
+std::string IniParser::get_string(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        string result;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get string value", p->filename, group, key);
+        inspect_status(IniData::to_string(raw, result), "Could not get string value", p->filename, group, key);
+        return result;
+    }
+
+    gchar* value;
+    GError* e = nullptr;
+    string result;
+    value = g_key_file_get_string(p->k, group.c_str(), key.c_str(), &e);
+    inspect_error(e, "Could not get string value", p->filename, group);
+    result = value;
+    g_free(value);
+    return result;
+}
+
+std::string IniParser::get_locale_string(const std::string& group, const std::string& key, const std::string& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        string result;
+        inspect_status(p->native->get_locale_value(group, key, locale, raw),
+                       "Could not get localized string value", p->filename, group, key);
+        inspect_status(IniData::to_string(raw, result), "Could not get localized string value", p->filename, group, key);
+        return result;
+    }
+
+    gchar* value;
+    GError* e = nullptr;
+    string result;
+    value = g_key_file_get_locale_string(p->k, group.c_str(), key.c_str(), locale.empty() ? nullptr : locale.c_str(), &e);
+    inspect_error(e, "Could not get localized string value", p->filename, group);
+    result = value;
+    g_free(value);
+    return result;
+}
+
+bool IniParser::get_boolean(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        bool result = false;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get boolean value", p->filename, group, key);
+        inspect_status(IniData::to_boolean(raw, result), "Could not get boolean value", p->filename, group, key);
+        return result;
+    }
+
+    bool rval;
+    GError* e = nullptr;
+    rval = g_key_file_get_boolean(p->k, group.c_str(), key.c_str(), &e);
+    inspect_error(e, "Could not get boolean value", p->filename, group);
+    return rval;
+}
+
+int IniParser::get_int(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        int result = 0;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get integer value", p->filename, group, key);
+        inspect_status(IniData::to_int(raw, result), "Could not get integer value", p->filename, group, key);
+        return result;
+    }
+
+    int rval;
+    GError* e = nullptr;
+    rval = g_key_file_get_integer(p->k, group.c_str(), key.c_str(), &e);
+    inspect_error(e, "Could not get integer value", p->filename, group);
+    return rval;
+}
+
+double IniParser::get_double(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        double result = 0;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get double value", p->filename, group, key);
+        inspect_status(IniData::to_double(raw, result), "Could not get double value", p->filename, group, key);
+        return result;
+    }
+
+    double rval;
+    GError* e = nullptr;
+    rval = g_key_file_get_double(p->k, group.c_str(), key.c_str(), &e);
+    inspect_error(e, "Could not get double value", p->filename, group);
+    return rval;
+}
+
+std::vector<std::string> IniParser::get_string_array(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        vector<string> result;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get string array", p->filename, group, key);
+        inspect_status(IniData::to_string_list(raw, result), "Could not get string array", p->filename, group, key);
+        return result;
+    }
+
+    vector<string> result;
+    GError* e = nullptr;
+    gchar** strlist;
+    gsize count;
+    strlist = g_key_file_get_string_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    inspect_error(e, "Could not get string array", p->filename, group);
+    for (gsize i = 0; i < count; i++)
+    {
+        result.push_back(strlist[i]);
+    }
+    g_strfreev(strlist);
+    return result;
+}
+
+std::vector<std::string> IniParser::get_locale_string_array(const std::string& group,
+                                                            const std::string& key,
+                                                            const std::string& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        vector<string> result;
+        inspect_status(p->native->get_locale_value(group, key, locale, raw),
+                       "Could not get localized string array", p->filename, group, key);
+        inspect_status(IniData::to_string_list(raw, result),
+                       "Could not get localized string array", p->filename, group, key);
+        return result;
+    }
+
+    vector<string> result;
+    GError* e = nullptr;
+    gchar** strlist;
+    gsize count;
+    strlist = g_key_file_get_locale_string_list(p->k, group.c_str(), key.c_str(),
+                                                locale.empty() ? nullptr : locale.c_str(), &count, &e);
+    inspect_error(e, "Could not get localized string array", p->filename, group);
+    for (gsize i = 0; i < count; i++)
+    {
+        result.push_back(strlist[i]);
+    }
+    g_strfreev(strlist);
+    return result;
+}
+
+vector<bool> IniParser::get_boolean_array(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get boolean array", p->filename, group, key);
+        vector<bool> result;
+        inspect_status(IniData::to_boolean_list(raw, result), "Could not get boolean array", p->filename, group, key);
+        return result;
+    }
+
+    vector<bool> result;
+    GError* e = nullptr;
+    gboolean* bools;
+    gsize count;
+    bools = g_key_file_get_boolean_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    inspect_error(e, "Could not get boolean array", p->filename, group);
+    result.assign(bools, bools + count);
+    g_free(bools);
+    return result;
+}
+
+vector<int> IniParser::get_int_array(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get integer array", p->filename, group, key);
+        vector<int> result;
+        inspect_status(IniData::to_int_list(raw, result), "Could not get integer array", p->filename, group, key);
+        return result;
+    }
+
+    vector<int> result;
+    GError* e = nullptr;
+    gint* ints;
+    gsize count;
+    ints = g_key_file_get_integer_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    inspect_error(e, "Could not get integer array", p->filename, group);
+    result.assign(ints, ints + count);
+    g_free(ints);
+    return result;
+}
+
+vector<double> IniParser::get_double_array(const std::string& group, const std::string& key) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        inspect_status(p->native->get_value(group, key, raw), "Could not get double array", p->filename, group, key);
+        vector<double> result;
+        inspect_status(IniData::to_double_list(raw, result), "Could not get double array", p->filename, group, key);
+        return result;
+    }
+
+    vector<double> result;
+    GError* e = nullptr;
+    gdouble* doubles;
+    gsize count;
+    doubles = g_key_file_get_double_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    inspect_error(e, "Could not get double array", p->filename, group);
+    result.assign(doubles, doubles + count);
+    g_free(doubles);
+    return result;
+}
+
+string IniParser::get_start_group() const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        return p->native->start_group();
+    }
+
+    gchar* sg = g_key_file_get_start_group(p->k);
+    string result(sg);
+    g_free(sg);
+    return result;
+}
+
+vector<string> IniParser::get_groups() const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        return p->native->groups();
+    }
+
+    vector<string> result;
+    gsize count;
+    gchar** groups = g_key_file_get_groups(p->k, &count);
+    for (gsize i = 0; i < count; i++)
+    {
+        result.push_back(groups[i]);
+    }
+    g_strfreev(groups);
+    return result;
+}
+
+vector<string> IniParser::get_keys(const std::string& group) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        vector<string> result;
+        inspect_status(p->native->keys(group, result), "Could not get list of keys", p->filename, group, string());
+        return result;
+    }
+
+    vector<string> result;
+    GError* e = nullptr;
+    gchar** strlist;
+    gsize count = 0;
+    strlist = g_key_file_get_keys(p->k, group.c_str(), &count, &e);
+    inspect_error(e, "Could not get list of keys", p->filename, group);
+    for (gsize i = 0; i < count; i++)
+    {
+        result.push_back(strlist[i]);
+    }
+    g_strfreev(strlist);
+    return result;
+}
+
+void IniParser::for_each_group(const NameCallback& callback) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        p->native->for_each_group(callback);
+        return;
+    }
+
+    unique_ptr<gchar*, decltype(&g_strfreev)> groups(g_key_file_get_groups(p->k, nullptr), &g_strfreev);
+    for (gchar** g = groups.get(); *g; ++g)
+    {
+        if (!callback(*g, strlen(*g)))
+        {
+            return;
+        }
+    }
+}
+
+void IniParser::for_each_key(const std::string& group, const NameCallback& callback) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        inspect_status(p->native->for_each_key(group, callback),
+                       "Could not get list of keys", p->filename, group, string());
+        return;
+    }
+
+    GError* e = nullptr;
+    unique_ptr<gchar*, decltype(&g_strfreev)> keys(g_key_file_get_keys(p->k, group.c_str(), nullptr, &e),
+                                                   &g_strfreev);
+    inspect_error(e, "Could not get list of keys", p->filename, group);
+    for (gchar** k = keys.get(); *k; ++k)
+    {
+        if (!callback(*k, strlen(*k)))
+        {
+            return;
+        }
+    }
+}
+
+bool IniParser::try_get_string(const std::string& group, const std::string& key, std::string& value) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_string, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gchar* v = g_key_file_get_string(p->k, group.c_str(), key.c_str(), &e);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    value = v;
+    g_free(v);
+    return true;
+}
+
+bool IniParser::try_get_locale_string(const std::string& group,
+                                      const std::string& key,
+                                      std::string& value,
+                                      const std::string& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_locale_value(group, key, locale, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_string, value);
+    }
+
+    if (!has_locale_key_quietly(p->k, group, key, locale))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gchar* v = g_key_file_get_locale_string(p->k, group.c_str(), key.c_str(),
+                                            locale.empty() ? nullptr : locale.c_str(), &e);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    value = v;
+    g_free(v);
+    return true;
+}
+
+bool IniParser::try_get_boolean(const std::string& group, const std::string& key, bool& value) const noexcept
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_boolean, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    bool v = g_key_file_get_boolean(p->k, group.c_str(), key.c_str(), &e);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    value = v;
+    return true;
+}
+
+bool IniParser::try_get_int(const std::string& group, const std::string& key, int& value) const noexcept
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_int, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    int v = g_key_file_get_integer(p->k, group.c_str(), key.c_str(), &e);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    value = v;
+    return true;
+}
+
+bool IniParser::try_get_double(const std::string& group, const std::string& key, double& value) const noexcept
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_double, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    double v = g_key_file_get_double(p->k, group.c_str(), key.c_str(), &e);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    value = v;
+    return true;
+}
+
+bool IniParser::try_get_string_array(const std::string& group,
+                                     const std::string& key,
+                                     std::vector<std::string>& value) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_string_list, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gsize count = 0;
+    gchar** strlist = g_key_file_get_string_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    return take_glib_strv(strlist, count, e, value);
+}
+
+bool IniParser::try_get_locale_string_array(const std::string& group,
+                                            const std::string& key,
+                                            std::vector<std::string>& value,
+                                            const std::string& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_locale_value(group, key, locale, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_string_list, value);
+    }
+
+    if (!has_locale_key_quietly(p->k, group, key, locale))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gsize count = 0;
+    gchar** strlist = g_key_file_get_locale_string_list(p->k, group.c_str(), key.c_str(),
+                                                        locale.empty() ? nullptr : locale.c_str(), &count, &e);
+    return take_glib_strv(strlist, count, e, value);
+}
+
+bool IniParser::try_get_boolean_array(const std::string& group, const std::string& key, std::vector<bool>& value) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_boolean_list, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gsize count = 0;
+    gboolean* bools = g_key_file_get_boolean_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    return take_glib_list(bools, count, e, value);
+}
+
+bool IniParser::try_get_int_array(const std::string& group, const std::string& key, std::vector<int>& value) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_int_list, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gsize count = 0;
+    gint* ints = g_key_file_get_integer_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    return take_glib_list(ints, count, e, value);
+}
+
+bool IniParser::try_get_double_array(const std::string& group,
+                                     const std::string& key,
+                                     std::vector<double>& value) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_value(group, key, raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_double_list, value);
+    }
+
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gsize count = 0;
+    gdouble* doubles = g_key_file_get_double_list(p->k, group.c_str(), key.c_str(), &count, &e);
+    return take_glib_list(doubles, count, e, value);
+}
+
+std::string IniParser::get_string_or(const std::string& group,
+                                     const std::string& key,
+                                     const std::string& default_value) const
+{
+    string value;
+    return try_get_string(group, key, value) ? value : default_value;
+}
+
+std::string IniParser::get_locale_string_or(const std::string& group,
+                                            const std::string& key,
+                                            const std::string& default_value,
+                                            const std::string& locale) const
+{
+    string value;
+    return try_get_locale_string(group, key, value, locale) ? value : default_value;
+}
+
+bool IniParser::get_boolean_or(const std::string& group, const std::string& key, bool default_value) const noexcept
+{
+    bool value = default_value;
+    try_get_boolean(group, key, value);
+    return value;
+}
+
+int IniParser::get_int_or(const std::string& group, const std::string& key, int default_value) const noexcept
+{
+    int value = default_value;
+    try_get_int(group, key, value);
+    return value;
+}
+
+double IniParser::get_double_or(const std::string& group, const std::string& key, double default_value) const noexcept
+{
+    double value = default_value;
+    try_get_double(group, key, value);
+    return value;
+}
+
+vector<string> IniParser::get_string_array_or(const std::string& group,
+                                              const std::string& key,
+                                              const std::vector<std::string>& default_value) const
+{
+    vector<string> value;
+    return try_get_string_array(group, key, value) ? value : default_value;
+}
+
+vector<string> IniParser::get_locale_string_array_or(const std::string& group,
+                                                     const std::string& key,
+                                                     const std::vector<std::string>& default_value,
+                                                     const std::string& locale) const
+{
+    vector<string> value;
+    return try_get_locale_string_array(group, key, value, locale) ? value : default_value;
+}
+
+/*
+ * Parses a list into a caller-provided buffer. The GKeyFile engine fetches the raw
+ * value and parses it in the same way as the native engine does, instead of going
+ * through an intermediate GLib array.
+ */
+
+template<typename T, typename Convert>
+static IniStatus get_list(IniParserPrivate* p, const string& group, const string& key,
+                          Convert convert, T* buf, size_t buf_size, size_t& count)
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        IniStatus s = p->native->get_value(group, key, raw);
+        return s == IniStatus::Ok ? convert(raw, buf, buf_size, count) : s;
+    }
+
+    if (!g_key_file_has_group(p->k, group.c_str()))
+    {
+        return IniStatus::GroupNotFound;
+    }
+    if (!has_key_quietly(p->k, group, key))
+    {
+        return IniStatus::KeyNotFound;
+    }
+    unique_ptr<gchar, decltype(&g_free)> raw(g_key_file_get_value(p->k, group.c_str(), key.c_str(), nullptr), &g_free);
+    return convert(IniSpan{ raw.get(), strlen(raw.get()) }, buf, buf_size, count);
+}
+
+size_t IniParser::get_boolean_array(const std::string& group, const std::string& key,
+                                    bool* buf, size_t buf_size) const
+{
+    size_t count = 0;
+    inspect_status(get_list(p, group, key, IniData::to_boolean_buffer, buf, buf_size, count),
+                   "Could not get boolean array", p->filename, group, key);
+    return count;
+}
+
+size_t IniParser::get_int_array(const std::string& group, const std::string& key,
+                                int* buf, size_t buf_size) const
+{
+    size_t count = 0;
+    inspect_status(get_list(p, group, key, IniData::to_int_buffer, buf, buf_size, count),
+                   "Could not get integer array", p->filename, group, key);
+    return count;
+}
+
+size_t IniParser::get_double_array(const std::string& group, const std::string& key,
+                                   double* buf, size_t buf_size) const
+{
+    size_t count = 0;
+    inspect_status(get_list(p, group, key, IniData::to_double_buffer, buf, buf_size, count),
+                   "Could not get double array", p->filename, group, key);
+    return count;
+}
+
+bool IniParser::try_get_boolean_array(const std::string& group, const std::string& key,
+                                      bool* buf, size_t buf_size, size_t& count) const
+{
+    return get_list(p, group, key, IniData::to_boolean_buffer, buf, buf_size, count) == IniStatus::Ok;
+}
+
+bool IniParser::try_get_int_array(const std::string& group, const std::string& key,
+                                  int* buf, size_t buf_size, size_t& count) const
+{
+    return get_list(p, group, key, IniData::to_int_buffer, buf, buf_size, count) == IniStatus::Ok;
+}
+
+bool IniParser::try_get_double_array(const std::string& group, const std::string& key,
+                                     double* buf, size_t buf_size, size_t& count) const
+{
+    return get_list(p, group, key, IniData::to_double_buffer, buf, buf_size, count) == IniStatus::Ok;
+}
+
+vector<bool> IniParser::get_boolean_array_or(const std::string& group,
+                                             const std::string& key,
+                                             const std::vector<bool>& default_value) const
+{
+    vector<bool> value;
+    return try_get_boolean_array(group, key, value) ? value : default_value;
+}
+
+vector<int> IniParser::get_int_array_or(const std::string& group,
+                                        const std::string& key,
+                                        const std::vector<int>& default_value) const
+{
+    vector<int> value;
+    return try_get_int_array(group, key, value) ? value : default_value;
+}
+
+vector<double> IniParser::get_double_array_or(const std::string& group,
+                                              const std::string& key,
+                                              const std::vector<double>& default_value) const
+{
+    vector<double> value;
+    return try_get_double_array(group, key, value) ? value : default_value;
+}
+
+// The native engine looks up pre-resolved keys directly. For GKeyFile, the IniKey overloads
+// release the lock and forward to the string overloads, which lock again and handle a parser
+// that switched engines in the meantime.
+
+bool IniParser::has_key(const IniKey& key) const
+{
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (p->native)
+        {
+            bool found = false;
+            inspect_status(p->native->has_key(IniKeyAccess::group(key), IniKeyAccess::key(key), found),
+                           "Error checking for key existence", p->filename, key.group(), key.key());
+            return found;
+        }
+    }
+    return has_key(key.group(), key.key());
+}
+
+template<typename T, typename Convert>
+static bool get_native(IniParserPrivate* p, const IniKey& key, Convert convert, const char* prefix, T& value)
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (!p->native)
+    {
+        return false;
+    }
+    IniSpan raw;
+    inspect_status(p->native->get_value(IniKeyAccess::group(key), IniKeyAccess::key(key), raw),
+                   prefix, p->filename, key.group(), key.key());
+    inspect_status(convert(raw, value), prefix, p->filename, key.group(), key.key());
+    return true;
+}
+
+template<typename T, typename Convert>
+static int try_get_native(IniParserPrivate* p, const IniKey& key, Convert convert, T& value)
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (!p->native)
+    {
+        return -1;
+    }
+    IniSpan raw;
+    return p->native->get_value(IniKeyAccess::group(key), IniKeyAccess::key(key), raw) == IniStatus::Ok
+           && try_native(raw, convert, value);
+}
+
+std::string IniParser::get_string(const IniKey& key) const
+{
+    string result;
+    if (get_native(p, key, IniData::to_string, "Could not get string value", result))
+    {
+        return result;
+    }
+    return get_string(key.group(), key.key());
+}
+
+std::string IniParser::get_locale_string(const IniKey& key, const std::string& locale) const
+{
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (p->native)
+        {
+            IniSpan raw;
+            string result;
+            inspect_status(p->native->get_locale_value(IniKeyAccess::group(key), IniKeyAccess::key(key), locale, raw),
+                           "Could not get localized string value", p->filename, key.group(), key.key());
+            inspect_status(IniData::to_string(raw, result), "Could not get localized string value",
+                           p->filename, key.group(), key.key());
+            return result;
+        }
+    }
+    return get_locale_string(key.group(), key.key(), locale);
+}
+
+bool IniParser::get_boolean(const IniKey& key) const
+{
+    bool result = false;
+    if (get_native(p, key, IniData::to_boolean, "Could not get boolean value", result))
+    {
+        return result;
+    }
+    return get_boolean(key.group(), key.key());
+}
+
+int IniParser::get_int(const IniKey& key) const
+{
+    int result = 0;
+    if (get_native(p, key, IniData::to_int, "Could not get integer value", result))
+    {
+        return result;
+    }
+    return get_int(key.group(), key.key());
+}
+
+double IniParser::get_double(const IniKey& key) const
+{
+    double result = 0;
+    if (get_native(p, key, IniData::to_double, "Could not get double value", result))
+    {
+        return result;
+    }
+    return get_double(key.group(), key.key());
+}
+
+bool IniParser::try_get_string(const IniKey& key, std::string& value) const
+{
+    int found = try_get_native(p, key, IniData::to_string, value);
+    return found < 0 ? try_get_string(key.group(), key.key(), value) : found;
+}
+
+bool IniParser::try_get_locale_string(const IniKey& key, std::string& value, const std::string& locale) const
+{
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (p->native)
+        {
+            IniSpan raw;
+            return p->native->get_locale_value(IniKeyAccess::group(key), IniKeyAccess::key(key), locale, raw)
+                   == IniStatus::Ok
+                   && try_native(raw, IniData::to_string, value);
+        }
+    }
+    return try_get_locale_string(key.group(), key.key(), value, locale);
+}
+
+bool IniParser::try_get_boolean(const IniKey& key, bool& value) const noexcept
+{
+    int found = try_get_native(p, key, IniData::to_boolean, value);
+    return found < 0 ? try_get_boolean(key.group(), key.key(), value) : found;
+}
+
+bool IniParser::try_get_int(const IniKey& key, int& value) const noexcept
+{
+    int found = try_get_native(p, key, IniData::to_int, value);
+    return found < 0 ? try_get_int(key.group(), key.key(), value) : found;
+}
+
+bool IniParser::try_get_double(const IniKey& key, double& value) const noexcept
+{
+    int found = try_get_native(p, key, IniData::to_double, value);
+    return found < 0 ? try_get_double(key.group(), key.key(), value) : found;
+}
+
+std::string IniParser::get_locale_string(const std::string& group,
+                                         const std::string& key,
+                                         const IniLocale& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        string result;
+        inspect_status(p->native->get_locale_value(group, key, locale.variants(), raw),
+                       "Could not get localized string value", p->filename, group, key);
+        inspect_status(IniData::to_string(raw, result), "Could not get localized string value", p->filename, group, key);
+        return result;
+    }
+
+    GError* e = nullptr;
+    gchar* value = g_key_file_get_string(p->k, group.c_str(), translated_key(p->k, group, key, locale).c_str(), &e);
+    inspect_error(e, "Could not get localized string value", p->filename, group);
+    string result = value;
+    g_free(value);
+    return result;
+}
+
+vector<string> IniParser::get_locale_string_array(const std::string& group,
+                                                  const std::string& key,
+                                                  const IniLocale& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        vector<string> result;
+        inspect_status(p->native->get_locale_value(group, key, locale.variants(), raw),
+                       "Could not get localized string array", p->filename, group, key);
+        inspect_status(IniData::to_string_list(raw, result),
+                       "Could not get localized string array", p->filename, group, key);
+        return result;
+    }
+
+    GError* e = nullptr;
+    gsize count = 0;
+    gchar** strlist = g_key_file_get_string_list(p->k, group.c_str(),
+                                                 translated_key(p->k, group, key, locale).c_str(), &count, &e);
+    inspect_error(e, "Could not get localized string array", p->filename, group);
+    vector<string> result;
+    for (gsize i = 0; i < count; i++)
+    {
+        result.push_back(strlist[i]);
+    }
+    g_strfreev(strlist);
+    return result;
+}
+
+bool IniParser::try_get_locale_string(const std::string& group,
+                                      const std::string& key,
+                                      std::string& value,
+                                      const IniLocale& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_locale_value(group, key, locale.variants(), raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_string, value);
+    }
+
+    string name = translated_key(p->k, group, key, locale);
+    if (!has_key_quietly(p->k, group, name))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gchar* v = g_key_file_get_string(p->k, group.c_str(), name.c_str(), &e);
+    if (clear_error(e))
+    {
+        return false;
+    }
+    value = v;
+    g_free(v);
+    return true;
+}
+
+bool IniParser::try_get_locale_string_array(const std::string& group,
+                                            const std::string& key,
+                                            std::vector<std::string>& value,
+                                            const IniLocale& locale) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        return p->native->get_locale_value(group, key, locale.variants(), raw) == IniStatus::Ok
+               && try_native(raw, IniData::to_string_list, value);
+    }
+
+    string name = translated_key(p->k, group, key, locale);
+    if (!has_key_quietly(p->k, group, name))
+    {
+        return false;
+    }
+    GError* e = nullptr;
+    gsize count = 0;
+    gchar** strlist = g_key_file_get_string_list(p->k, group.c_str(), name.c_str(), &count, &e);
+    return take_glib_strv(strlist, count, e, value);
+}
+
+std::string IniParser::get_locale_string(const IniKey& key, const IniLocale& locale) const
+{
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (p->native)
+        {
+            IniSpan raw;
+            string result;
+            inspect_status(p->native->get_locale_value(IniKeyAccess::group(key), IniKeyAccess::key(key),
+                                                       locale.variants(), raw),
+                           "Could not get localized string value", p->filename, key.group(), key.key());
+            inspect_status(IniData::to_string(raw, result), "Could not get localized string value",
+                           p->filename, key.group(), key.key());
+            return result;
+        }
+    }
+    return get_locale_string(key.group(), key.key(), locale);
+}
+
+bool IniParser::try_get_locale_string(const IniKey& key, std::string& value, const IniLocale& locale) const
+{
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (p->native)
+        {
+            IniSpan raw;
+            return p->native->get_locale_value(IniKeyAccess::group(key), IniKeyAccess::key(key),
+                                               locale.variants(), raw) == IniStatus::Ok
+                   && try_native(raw, IniData::to_string, value);
+        }
+    }
+    return try_get_locale_string(key.group(), key.key(), value, locale);
+}
+
+/*
+ * The snapshot is built as the text of a single-group ini file from the raw
+ * values, and indexed by a private IniData. Only the copy is done under the lock.
+ */
+
+static unique_ptr<internal::IniGroupPrivate> make_group(IniParserPrivate* p, const string& group,
+                                                        const vector<string>* keys)
+{
+    string text;
+    text += '[';
+    text += group;
+    text += "]\n";
+
+    {
+        internal::ReaderLock lock(p->lock);
+
+        if (p->native)
+        {
+            vector<pair<IniSpan, IniSpan>> entries;
+            inspect_status(p->native->entries(group, entries), "Could not get group", p->filename, group, string());
+            for (auto const& e : entries)
+            {
+                add_snapshot_line(text, e.first.data, e.first.size, e.second.data, e.second.size, keys);
+            }
+        }
+        else
+        {
+            GError* e = nullptr;
+            gsize count = 0;
+            gchar** strlist = g_key_file_get_keys(p->k, group.c_str(), &count, &e);
+            inspect_error(e, "Could not get group", p->filename, group);
+            for (gsize i = 0; i < count; i++)
+            {
+                gchar* value = g_key_file_get_value(p->k, group.c_str(), strlist[i], nullptr);
+                if (value)
+                {
+                    add_snapshot_line(text, strlist[i], strlen(strlist[i]), value, strlen(value), keys);
+                    g_free(value);
+                }
+            }
+            g_strfreev(strlist);
+        }
+    }
+
+    unique_ptr<internal::IniGroupPrivate> d(new internal::IniGroupPrivate);
+    d->filename = p->filename;
+    d->name = group;
+    d->data = IniData::from_string(move(text), p->filename);
+    return d;
+}
+
+IniGroup IniParser::get_group(const std::string& group) const
+{
+    return IniGroup(make_group(p, group, nullptr).release());
+}
+
+IniGroup IniParser::get_group(const std::string& group, const std::vector<std::string>& keys) const
+{
+    return IniGroup(make_group(p, group, &keys).release());
+}
+
+bool IniParser::remove_group(const std::string& group)
+{
+    gboolean rval;
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        GError* e = nullptr;
+        rval = g_key_file_remove_group(p->k, group.c_str(), &e);
+        inspect_error(e, "Error removing group", p->filename, group);
+        mark_changed(p, group);
+        publish_snapshot();
+    }
+    notify_edit(p, group, string());
+    return rval;
+}
+
+bool IniParser::remove_key(const std::string& group, const std::string& key)
+{
+    gboolean rval;
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        GError* e = nullptr;
+        rval = g_key_file_remove_key(p->k, group.c_str(), key.c_str(), &e);
+        inspect_error(e, "Error removing key", p->filename, group);
+        mark_changed(p, group, key);
+        publish_snapshot();
+    }
+    notify_edit(p, group, key);
+    return rval;
+}
+
+void IniParser::set_string(const std::string& group, const std::string& key, const std::string& value)
+{
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        g_key_file_set_string(p->k, group.c_str(), key.c_str(), value.c_str());
+        mark_changed(p, group, key);
+        publish_snapshot();
+    }
+    notify_edit(p, group, key);
+}
+
+void IniParser::set_locale_string(const std::string& group, const std::string& key,
+                                  const std::string& value, const std::string& locale)
+{
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        g_key_file_set_locale_string(p->k, group.c_str(), key.c_str(), locale.c_str(), value.c_str());
+        mark_changed(p, group, key + "[" + locale + "]");
+        publish_snapshot();
+    }
+    notify_edit(p, group, key + "[" + locale + "]");
+}
+
+void IniParser::set_boolean(const std::string& group, const std::string& key, bool value)
+{
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        g_key_file_set_boolean(p->k, group.c_str(), key.c_str(), value);
+        mark_changed(p, group, key);
+        publish_snapshot();
+    }
+    notify_edit(p, group, key);
+}
+
+void IniParser::set_int(const std::string& group, const std::string& key, int value)
+{
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        g_key_file_set_integer(p->k, group.c_str(), key.c_str(), value);
+        mark_changed(p, group, key);
+        publish_snapshot();
+    }
+    notify_edit(p, group, key);
 }
 
 void IniParser::set_double(const std::string& group, const std::string& key, double value)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
 
-    g_key_file_set_double(p->k, group.c_str(), key.c_str(), value);
-    p->dirty = true;
+        g_key_file_set_double(p->k, group.c_str(), key.c_str(), value);
+        mark_changed(p, group, key);
+        publish_snapshot();
+    }
+    notify_edit(p, group, key);
 }
 
 void IniParser::set_string_array(const std::string& group, const std::string& key,
                                  const std::vector<std::string>& value)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
 
-    int count = value.size();
-    gchar** strlist = g_new(gchar*, count+1);
+        int count = value.size();
+        gchar** strlist = g_new(gchar*, count+1);
 
-    for (int i = 0; i < count; ++i)
-    {
-        strlist[i] = g_strdup(value[i].c_str());
-    }
-    strlist[count] = nullptr;
+        for (int i = 0; i < count; ++i)
+        {
+            strlist[i] = g_strdup(value[i].c_str());
+        }
+        strlist[count] = nullptr;
 
-    g_key_file_set_string_list(p->k, group.c_str(), key.c_str(), strlist, count);
-    p->dirty = true;
+        g_key_file_set_string_list(p->k, group.c_str(), key.c_str(), strlist, count);
+        mark_changed(p, group, key);
+        publish_snapshot();
 
-    g_strfreev(strlist);
+        g_strfreev(strlist);
+    }
+    notify_edit(p, group, key);
 }
 
 void IniParser::set_locale_string_array(const std::string& group, const std::string& key,
                                         const std::vector<std::string>& value, const std::string& locale)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
 
-    int count = value.size();
-    gchar** strlist = g_new(gchar*, count+1);
+        int count = value.size();
+        gchar** strlist = g_new(gchar*, count+1);
 
-    for (int i = 0; i < count; ++i)
-    {
-        strlist[i] = g_strdup(value[i].c_str());
-    }
-    strlist[count] = nullptr;
+        for (int i = 0; i < count; ++i)
+        {
+            strlist[i] = g_strdup(value[i].c_str());
+        }
+        strlist[count] = nullptr;
 
-    g_key_file_set_locale_string_list(p->k, group.c_str(), key.c_str(), locale.c_str(), strlist, count);
-    p->dirty = true;
+        g_key_file_set_locale_string_list(p->k, group.c_str(), key.c_str(), locale.c_str(), strlist, count);
+        mark_changed(p, group, key + "[" + locale + "]");
+        publish_snapshot();
 
-    g_strfreev(strlist);
+        g_strfreev(strlist);
+    }
+    notify_edit(p, group, key + "[" + locale + "]");
 }
 
 void IniParser::set_boolean_array(const std::string& group, const std::string& key, const std::vector<bool>& value)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        int count = value.size();
+        gboolean* boollist = g_new(gboolean, count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            boollist[i] = value[i];
+        }
 
-    int count = value.size();
-    gboolean* boollist = g_new(gboolean, count);
+        g_key_file_set_boolean_list(p->k, group.c_str(), key.c_str(), boollist, count);
+        mark_changed(p, group, key);
+        publish_snapshot();
 
-    for (int i = 0; i < count; ++i)
+        g_free(boollist);
+    }
+    notify_edit(p, group, key);
+}
+
+void IniParser::set_int_array(const std::string& group, const std::string& key, const std::vector<int>& value)
+{
     {
-        boollist[i] = value[i];
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
+
+        int count = value.size();
+        gint* intlist = g_new(gint, count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            intlist[i] = value[i];
+        }
+
+        g_key_file_set_integer_list(p->k, group.c_str(), key.c_str(), intlist, count);
+        mark_changed(p, group, key);
+        publish_snapshot();
+
+        g_free(intlist);
     }
+    notify_edit(p, group, key);
+}
 
-    g_key_file_set_boolean_list(p->k, group.c_str(), key.c_str(), boollist, count);
-    p->dirty = true;
+void IniParser::set_double_array(const std::string& group, const std::string& key, const std::vector<double>& value)
+{
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
 
-    g_free(boollist);
+        int count = value.size();
+        gdouble* doublelist = g_new(gdouble, count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            doublelist[i] = value[i];
+        }
+
+        g_key_file_set_double_list(p->k, group.c_str(), key.c_str(), doublelist, count);
+        mark_changed(p, group, key);
+        publish_snapshot();
+
+        g_free(doublelist);
+    }
+    notify_edit(p, group, key);
 }
 
-void IniParser::set_int_array(const std::string& group, const std::string& key, const std::vector<int>& value)
+void IniParser::visit(const char* filename, IniVisitor& visitor, size_t chunk_size)
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    int fd_raw = ::open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd_raw == -1)
+    {
+        int err = errno;
+        throw FileException(string("Could not load ini file ") + filename + ": " + strerror(err), err);
+    }
+    ResourcePtr<int, decltype(&::close)> fd(fd_raw, ::close);
+
+    // The strings are reused from line to line, so a scan does not allocate once they
+    // have grown to the longest group name, key, and value.
+    string group, key, value;
+    internal::scan_lines(fd.get(), filename, chunk_size, [&](internal::IniLine const& line)
+    {
+        switch (line.kind)
+        {
+            case internal::IniLine::Kind::Group:
+                group.assign(line.name.data, line.name.size);
+                return visitor.group(group);
+            case internal::IniLine::Kind::Key:
+                key.assign(line.name.data, line.name.size);
+                value.assign(line.value.data, line.value.size);
+                return visitor.key_value(group, key, value);
+            case internal::IniLine::Kind::Comment:
+                value.assign(line.value.data, line.value.size);
+                return visitor.comment(value);
+            default:
+                return true;
+        }
+    });
+}
 
-    int count = value.size();
-    gint* intlist = g_new(gint, count);
+IniBatch IniParser::batch()
+{
+    return IniBatch(*this);
+}
 
-    for (int i = 0; i < count; ++i)
+void IniParser::apply(internal::IniBatchPrivate& batch)
+{
+    if (batch.ops.empty())
     {
-        intlist[i] = value[i];
+        return;
     }
 
-    g_key_file_set_integer_list(p->k, group.c_str(), key.c_str(), intlist, count);
-    p->dirty = true;
+    {
+        internal::WriterLock lock(p->lock);
+        make_writable(p);
 
-    g_free(intlist);
+        for (auto const& op : batch.ops)
+        {
+            op.apply(p->k, op.group.c_str(), op.key.c_str());
+            if (op.key.empty())
+            {
+                mark_changed(p, op.group);
+            }
+            else
+            {
+                mark_changed(p, op.group, op.key);
+            }
+        }
+        publish_snapshot();
+    }
+    for (auto const& op : batch.ops)
+    {
+        notify_edit(p, op.group, op.key);
+    }
 }
 
-void IniParser::set_double_array(const std::string& group, const std::string& key, const std::vector<double>& value)
+IniParser::SCPtr IniParser::snapshot() const
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    SCPtr s = atomic_load(&p->snapshot);
+    if (s)
+    {
+        return s;
+    }
+
+    // First call: publish the current contents and keep publishing from now on.
+    internal::WriterLock lock(p->lock);
+    if (!p->snapshots)
+    {
+        p->snapshots = true;
+        try
+        {
+            publish_snapshot();
+        }
+        catch (...)
+        {
+            p->snapshots = false;
+            throw;
+        }
+    }
+    return atomic_load(&p->snapshot);
+}
 
-    int count = value.size();
-    gdouble* doublelist = g_new(gdouble, count);
+// Called with the writer lock held, so snapshots are published in the order of the changes.
+void IniParser::publish_snapshot() const
+{
+    if (!p->snapshots)
+    {
+        return;
+    }
 
-    for (int i = 0; i < count; ++i)
+    string text;
+    if (p->native)
+    {
+        text = p->native->to_text();
+    }
+    else
     {
-        doublelist[i] = value[i];
+        gsize length;
+        gchar* data = g_key_file_to_data(p->k, &length, nullptr);
+        text.assign(data, length);
+        g_free(data);
     }
+    IniData::UPtr native = IniData::from_string(move(text), p->filename);
+    SCPtr s(new IniParser(new_private(nullptr, move(native), p->filename, false)));
+    atomic_store(&p->snapshot, s);
+}
 
-    g_key_file_set_double_list(p->k, group.c_str(), key.c_str(), doublelist, count);
-    p->dirty = true;
+// Returns the raw (still escaped) value of a key, for IniLayers.
+bool IniParser::get_raw(const std::string& group, const std::string& key, std::string& value) const
+{
+    internal::ReaderLock lock(p->lock);
+
+    if (p->native)
+    {
+        IniSpan raw;
+        if (p->native->get_value(group, key, raw) != IniStatus::Ok)
+        {
+            return false;
+        }
+        value.assign(raw.data, raw.size);
+        return true;
+    }
 
-    g_free(doublelist);
+    gchar* raw = g_key_file_get_value(p->k, group.c_str(), key.c_str(), nullptr);
+    if (!raw)
+    {
+        return false;
+    }
+    value = raw;
+    g_free(raw);
+    return true;
 }
 
 void IniParser::sync()
 {
-    lock_guard<std::mutex> lock(internal::parser_mutex);
+    write_file(p);
+}
 
-    if (p->dirty)
+void IniParser::sync_async(chrono::milliseconds delay)
+{
     {
-        GError* e = nullptr;
-        if (!g_key_file_save_to_file(p->k, p->filename.c_str(), &e))
+        internal::ReaderLock lock(p->lock);
+
+        if (p->dirty && !p->has_file)
         {
-            string message = "Could not write ini file ";
-            message += p->filename;
-            message += ": ";
-            message += e->message;
-            int errnum = e->code;
-            g_error_free(e);
-            throw FileException(message, errnum);
+            throw LogicException("Cannot sync ini data that was not loaded from a file: " + p->filename);
         }
+    }
 
-        p->dirty = false;
+    lock_guard<mutex> lock(p->async_mutex);
+    if (!p->writer.joinable())
+    {
+        p->writer = thread(run_writer, p);
+    }
+    if (!p->write_pending)
+    {
+        // Later calls before the write starts are folded into this one.
+        p->write_pending = true;
+        p->write_deadline = chrono::steady_clock::now() + delay;
+        p->async_cond.notify_all();
+    }
+}
+
+void IniParser::flush()
+{
+    unique_lock<mutex> lock(p->async_mutex);
+    if (p->write_pending)
+    {
+        p->write_now = true;
+        p->async_cond.notify_all();
     }
+    p->async_cond.wait(lock, [this] { return !p->write_pending && !p->writing; });
+    if (p->async_error)
+    {
+        exception_ptr error = p->async_error;
+        p->async_error = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+bool IniParser::reload()
+{
+    unique_lock<mutex> serialize(p->write_mutex);
+
+    if (!p->has_file)
+    {
+        throw LogicException("Cannot reload ini data that was not loaded from a file: " + p->filename);
+    }
+
+    struct stat st;
+    bool has_stat = stat(p->filename.c_str(), &st) == 0;
+    if (has_stat && p->has_file_stat && same_file_version(st, p->file_stat))
+    {
+        return false;
+    }
+
+    bool native;
+    bool lazy;
+    {
+        internal::ReaderLock lock(p->lock);
+        native = p->native != nullptr;
+        lazy = native && p->native->lazy();
+    }
+    IniData::UPtr new_native;
+    GKeyFile* new_kf = nullptr;
+    if (native)
+    {
+        new_native = shared_names(IniData::open(p->filename, lazy));
+    }
+    else
+    {
+        new_kf = load_key_file(p->filename.c_str());
+    }
+    IniContents after = native ? contents_of(*new_native) : contents_of(new_kf);
+
+    IniContents before;
+    {
+        internal::WriterLock lock(p->lock);
+
+        if (p->dirty)
+        {
+            // Unsaved changes are kept: they are patched into the new contents the same
+            // way sync() patches them into the file, and stay marked for the next sync().
+            try
+            {
+                internal::IniPatch patch;
+                make_patch(p, patch);
+                string text;
+                if (new_native)
+                {
+                    IniSpan span = new_native->text();
+                    text = new_native->compacted() ? new_native->to_text() : string(span.data, span.size);
+                }
+                else
+                {
+                    gsize length;
+                    gchar* data = g_key_file_to_data(new_kf, &length, nullptr);
+                    text.assign(data, length);
+                    g_free(data);
+                }
+                text = patch.apply(text);
+                GKeyFile* merged = load_key_file(text.data(), text.size(), p->filename);
+                if (new_kf)
+                {
+                    g_key_file_free(new_kf);
+                }
+                new_kf = merged;
+                new_native.reset();
+            }
+            catch (...)
+            {
+                if (new_kf)
+                {
+                    g_key_file_free(new_kf);
+                }
+                throw;
+            }
+            after = contents_of(new_kf);
+        }
+
+        before = p->native ? contents_of(*p->native) : contents_of(p->k);
+        if (p->k)
+        {
+            g_key_file_free(p->k);
+        }
+        p->k = new_kf;
+        p->native = move(new_native);
+        publish_snapshot();
+    }
+    p->file_stat = st;
+    p->has_file_stat = has_stat;
+    serialize.unlock();
+
+    Changes changes = compare_contents(before, after);
+    if (!changes.empty())
+    {
+        vector<ChangeCallback> callbacks;
+        {
+            lock_guard<mutex> lock(p->watch_mutex);
+            for (auto const& c : p->callbacks)
+            {
+                callbacks.push_back(c.second);
+            }
+        }
+        for (auto const& callback : callbacks)
+        {
+            callback(changes);
+        }
+    }
+    return true;
+}
+
+void IniParser::watch()
+{
+    lock_guard<mutex> lock(p->watch_mutex);
+
+    if (!p->has_file)
+    {
+        throw LogicException("Cannot watch ini data that was not loaded from a file: " + p->filename);
+    }
+    if (p->watcher.joinable())
+    {
+        return;
+    }
+
+    string dir = ".";
+    string name = p->filename;
+    auto slash = p->filename.rfind('/');
+    if (slash != string::npos)
+    {
+        dir = slash == 0 ? "/" : p->filename.substr(0, slash);
+        name = p->filename.substr(slash + 1);
+    }
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        throw SyscallException("IniParser::watch(): cannot initialize inotify", errno);  // LCOV_EXCL_LINE
+    }
+    // IN_CLOSE_WRITE catches files that are rewritten in place, IN_MOVED_TO files that are replaced.
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        int err = errno;
+        close(fd);
+        throw SyscallException("IniParser::watch(): cannot watch " + dir, err);
+    }
+    if (pipe2(p->stop_pipe, O_CLOEXEC) < 0)
+    {
+        int err = errno;                                                         // LCOV_EXCL_LINE
+        close(fd);                                                               // LCOV_EXCL_LINE
+        throw SyscallException("IniParser::watch(): cannot create pipe", err);  // LCOV_EXCL_LINE
+    }
+    p->watcher = thread(run_watcher, this, fd, p->stop_pipe[0], name);
+}
+
+unsigned IniParser::add_change_callback(ChangeCallback callback)
+{
+    lock_guard<mutex> lock(p->watch_mutex);
+    unsigned id = p->next_callback_id++;
+    p->callbacks[id] = move(callback);
+    return id;
+}
+
+void IniParser::remove_change_callback(unsigned id)
+{
+    lock_guard<mutex> lock(p->watch_mutex);
+    p->callbacks.erase(id);
+}
+
+unsigned IniParser::add_edit_callback(EditCallback callback)
+{
+    lock_guard<mutex> lock(p->watch_mutex);
+    unsigned id = p->next_callback_id++;
+    p->edit_callbacks[id] = move(callback);
+    return id;
+}
+
+void IniParser::remove_edit_callback(unsigned id)
+{
+    lock_guard<mutex> lock(p->watch_mutex);
+    p->edit_callbacks.erase(id);
 }
 
 } // namespace util
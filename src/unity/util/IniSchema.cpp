@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unity/util/IniSchema.h>
+#include <unity/UnityExceptions.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+void throw_missing_schema_key(const char* group, const char* key)
+{
+    string message("IniSchema::get(): key is missing or does not have the declared type (group: ");
+    message += group;
+    message += ", key: ";
+    message += key;
+    message += ")";
+    throw LogicException(message);
+}
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
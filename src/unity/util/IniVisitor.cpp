@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/IniVisitor.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+IniVisitor::~IniVisitor() = default;
+
+bool IniVisitor::group(const string&)
+{
+    return true;
+}
+
+bool IniVisitor::key_value(const string&, const string&, const string&)
+{
+    return true;
+}
+
+bool IniVisitor::comment(const string&)
+{
+    return true;
+}
+
+} // namespace util
+
+} // namespace unity
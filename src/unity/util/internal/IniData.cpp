@@ -0,0 +1,1638 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/internal/IniData.h>
+#include <unity/util/ResourcePtr.h>
+#include <unity/UnityExceptions.h>
+
+#include <glib.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+namespace
+{
+
+// Continues an FNV-1a hash, so the hash of a translated key can be computed from the
+// hash of the key without building the "key[locale]" string.
+uint32_t ini_hash_more(uint32_t h, char const* s, size_t len) noexcept
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Names interned by IniData::compact(). Names are never removed, and the strings
+// are stored in the nodes of the set, so a pointer to a name stays valid for the
+// lifetime of the process. The table is never destroyed, because data that is
+// destroyed during exit can still refer to it.
+struct NameTable
+{
+    mutex m;
+    unordered_set<string> names;
+    size_t bytes = 0;
+};
+
+NameTable& name_table()
+{
+    static NameTable* table = new NameTable;
+    return *table;
+}
+
+} // namespace
+
+// The hash is only used to speed up comparisons; the bytes are always compared as well.
+uint32_t ini_hash(char const* s, size_t len) noexcept
+{
+    return ini_hash_more(2166136261u, s, len);
+}
+
+void interned_name_stats(size_t& count, size_t& bytes) noexcept
+{
+    NameTable& table = name_table();
+    lock_guard<mutex> lock(table.m);
+    count = table.names.size();
+    bytes = table.bytes;
+}
+
+vector<string> locale_variants(string const& locale)
+{
+    vector<string> result;
+    if (locale.empty())
+    {
+        for (gchar const* const* l = g_get_language_names(); *l; ++l)
+        {
+            result.push_back(*l);
+        }
+        return result;
+    }
+    gchar** variants = g_get_locale_variants(locale.c_str());
+    for (gchar** v = variants; *v; ++v)
+    {
+        result.push_back(*v);
+    }
+    g_strfreev(variants);
+    return result;
+}
+
+namespace
+{
+
+IniName name_of(string const& s) noexcept
+{
+    return IniName{ s.data(), s.size(), ini_hash(s.data(), s.size()) };
+}
+
+bool is_space(char c) noexcept
+{
+    return g_ascii_isspace(c);
+}
+
+bool is_valid_group_name(char const* begin, char const* end) noexcept
+{
+    if (begin == end)
+    {
+        return false;
+    }
+    for (char const* p = begin; p != end; ++p)
+    {
+        if (*p == '[' || *p == ']' || g_ascii_iscntrl(*p))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A key is any text without '=', '[' or ']', optionally followed by a
+// [locale] suffix made up of alphanumerics and "-_.@".
+bool is_valid_key_name(char const* begin, char const* end) noexcept
+{
+    char const* p = begin;
+    while (p != end && *p != '=' && *p != '[' && *p != ']')
+    {
+        ++p;
+    }
+    if (p == begin)
+    {
+        return false;
+    }
+    if (p == end)
+    {
+        return true;
+    }
+    if (*p != '[')
+    {
+        return false;
+    }
+    ++p;
+    char const* locale = p;
+    while (p != end && (g_ascii_isalnum(*p) || *p == '-' || *p == '_' || *p == '.' || *p == '@'))
+    {
+        ++p;
+    }
+    return p != locale && p + 1 == end && *p == ']';
+}
+
+[[noreturn]] void throw_parse_error(string const& filename, string const& reason, int errnum)
+{
+    throw FileException("Could not load ini file " + filename + ": " + reason, errnum);
+}
+
+// Copies a raw numeric value into a NUL-terminated buffer for strtol() and friends.
+// Returns false if the value does not fit, in which case it cannot be a valid number.
+bool copy_number(IniSpan raw, char* buf, size_t buf_size) noexcept
+{
+    if (raw.size >= buf_size)
+    {
+        return false;
+    }
+    memcpy(buf, raw.data, raw.size);
+    buf[raw.size] = '\0';
+    return true;
+}
+
+// Returns the character that the escape sequence "\c" stands for, or '\0' if the
+// sequence is invalid. "\;" is valid only inside a list.
+char escaped_char(char c, bool in_list) noexcept
+{
+    switch (c)
+    {
+        case 's':
+            return ' ';
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '\\':
+            return '\\';
+        case ';':
+            return in_list ? ';' : '\0';
+        default:
+            return '\0';
+    }
+}
+
+// Unescapes a raw value, or a single element of a list, as GKeyFile does.
+IniStatus unescape(IniSpan raw, bool in_list, string& value)
+{
+    value.clear();
+    value.reserve(raw.size);
+    char const* end = raw.data + raw.size;
+    for (char const* p = raw.data; p != end; ++p)
+    {
+        if (*p != '\\')
+        {
+            value += *p;
+            continue;
+        }
+        char c;
+        if (++p == end || (c = escaped_char(*p, in_list)) == '\0')
+        {
+            return IniStatus::InvalidValue;  // Invalid escape, or escape character at end of line.
+        }
+        value += c;
+    }
+    return IniStatus::Ok;
+}
+
+// Splits a raw list in a single pass and calls item() with each element. Elements
+// without escape sequences are passed as is; the others are unescaped into a scratch
+// string first. A trailing separator does not start another (empty) element.
+template<typename Item>
+IniStatus for_each_item(IniSpan raw, Item item)
+{
+    if (!g_utf8_validate(raw.data, raw.size, nullptr))
+    {
+        return IniStatus::InvalidValue;
+    }
+
+    string scratch;
+    char const* const end = raw.data + raw.size;
+    char const* start = raw.data;
+    bool escaped = false;
+    for (char const* p = raw.data;; ++p)
+    {
+        if (p != end && *p == '\\')
+        {
+            if (++p == end || escaped_char(*p, true) == '\0')
+            {
+                return IniStatus::InvalidValue;
+            }
+            escaped = true;
+            continue;
+        }
+        if (p != end && *p != ';')
+        {
+            continue;
+        }
+        if (p == end && p == start)
+        {
+            return IniStatus::Ok;
+        }
+        IniSpan element{ start, size_t(p - start) };
+        if (escaped)
+        {
+            unescape(element, true, scratch);
+            element = IniSpan{ scratch.data(), scratch.size() };
+        }
+        IniStatus s = item(element);
+        if (s != IniStatus::Ok || p == end)
+        {
+            return s;
+        }
+        start = p + 1;
+        escaped = false;
+    }
+}
+
+// Returns an upper bound for the number of elements in a raw list.
+size_t max_items(IniSpan raw) noexcept
+{
+    return count(raw.data, raw.data + raw.size, ';') + 1;
+}
+
+// Splits a raw list and converts each element.
+template<typename T, typename Convert>
+IniStatus convert_list(IniSpan raw, Convert convert, vector<T>& value)
+{
+    vector<T> result;
+    result.reserve(max_items(raw));
+    IniStatus s = for_each_item(raw, [&](IniSpan element)
+    {
+        T v;
+        IniStatus s = convert(element, v);
+        if (s == IniStatus::Ok)
+        {
+            result.push_back(v);
+        }
+        return s;
+    });
+    if (s == IniStatus::Ok)
+    {
+        value = move(result);
+    }
+    return s;
+}
+
+// Converts the elements of a raw list into buf. All elements are converted, so that an
+// invalid element is reported even if it does not fit, but only the first buf_size are stored.
+template<typename T, typename Convert>
+IniStatus convert_list(IniSpan raw, Convert convert, T* buf, size_t buf_size, size_t& count)
+{
+    size_t n = 0;
+    IniStatus s = for_each_item(raw, [&](IniSpan element)
+    {
+        T v;
+        IniStatus s = convert(element, v);
+        if (s == IniStatus::Ok && n < buf_size)
+        {
+            buf[n] = v;
+        }
+        ++n;
+        return s;
+    });
+    if (s == IniStatus::Ok)
+    {
+        count = n;
+    }
+    return s;
+}
+
+} // namespace
+
+string read_fd(int fd, string const& name)
+{
+    string text;
+    char buf[16 * 1024];
+    for (;;)
+    {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n == 0)
+        {
+            break;
+        }
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw FileException("cannot read from " + name + ": " + strerror(errno), errno);
+        }
+        text.append(buf, n);
+    }
+    return text;
+}
+
+IniLine parse_line(char const* begin, char const* end, string const& name, bool in_group)
+{
+    if (end > begin && end[-1] == '\r')
+    {
+        --end;
+    }
+
+    char const* p = begin;
+    while (p != end && is_space(*p))
+    {
+        ++p;
+    }
+
+    if (p == end)
+    {
+        return IniLine{ IniLine::Kind::Blank, IniSpan{ p, 0 }, IniSpan{ p, 0 } };
+    }
+    if (*p == '#')
+    {
+        return IniLine{ IniLine::Kind::Comment, IniSpan{ p, 0 }, IniSpan{ p + 1, size_t(end - p - 1) } };
+    }
+    if (*p == '[')
+    {
+        char const* close = static_cast<char const*>(memchr(p, ']', end - p));
+        char const* rest = close ? close + 1 : end;
+        while (rest != end && is_space(*rest))
+        {
+            ++rest;
+        }
+        if (!close || rest != end || !is_valid_group_name(p + 1, close))
+        {
+            throw_parse_error(name, "Invalid group name: " + string(p, end), G_KEY_FILE_ERROR_PARSE);
+        }
+        return IniLine{ IniLine::Kind::Group, IniSpan{ p + 1, size_t(close - p - 1) }, IniSpan{ end, 0 } };
+    }
+
+    char const* eq = static_cast<char const*>(memchr(p, '=', end - p));
+    if (!eq)
+    {
+        throw_parse_error(name,
+                          "Key file contains line “" + string(p, end) +
+                          "” which is not a key-value pair, group, or comment",
+                          G_KEY_FILE_ERROR_PARSE);
+    }
+    if (!in_group)
+    {
+        throw_parse_error(name, "Key file does not start with a group", G_KEY_FILE_ERROR_GROUP_NOT_FOUND);
+    }
+
+    char const* key_end = eq;
+    while (key_end != p && is_space(key_end[-1]))
+    {
+        --key_end;
+    }
+    if (!is_valid_key_name(p, key_end))
+    {
+        throw_parse_error(name, "Invalid key name: " + string(p, key_end), G_KEY_FILE_ERROR_PARSE);
+    }
+
+    char const* value = eq + 1;
+    while (value != end && is_space(*value))
+    {
+        ++value;
+    }
+    return IniLine{ IniLine::Kind::Key, IniSpan{ p, size_t(key_end - p) }, IniSpan{ value, size_t(end - value) } };
+}
+
+// A line that spans chunks is assembled in carry; all other lines are parsed in
+// place in the chunk buffer.
+
+void scan_lines(int fd, string const& name, size_t chunk_size, function<bool(IniLine const&)> const& handler)
+{
+    vector<char> chunk(max(chunk_size, size_t(1)));
+    string carry;
+    bool in_group = false;
+    auto handle = [&](char const* begin, char const* end)
+    {
+        IniLine line = parse_line(begin, end, name, in_group);
+        in_group = in_group || line.kind == IniLine::Kind::Group;
+        return handler(line);
+    };
+
+    for (;;)
+    {
+        ssize_t n = ::read(fd, chunk.data(), chunk.size());
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw FileException("cannot read from " + name + ": " + strerror(errno), errno);
+        }
+        if (n == 0)
+        {
+            break;
+        }
+
+        char const* p = chunk.data();
+        char const* const end = p + n;
+        while (p != end)
+        {
+            char const* nl = static_cast<char const*>(memchr(p, '\n', end - p));
+            if (!nl)
+            {
+                carry.append(p, end);
+                break;
+            }
+            bool go_on;
+            if (carry.empty())
+            {
+                go_on = handle(p, nl);
+            }
+            else
+            {
+                carry.append(p, nl);
+                go_on = handle(carry.data(), carry.data() + carry.size());
+                carry.clear();
+            }
+            if (!go_on)
+            {
+                return;
+            }
+            p = nl + 1;
+        }
+    }
+    if (!carry.empty())
+    {
+        handle(carry.data(), carry.data() + carry.size());
+    }
+}
+
+string ini_status_message(IniStatus status, string const& group, string const& key)
+{
+    switch (status)
+    {
+        case IniStatus::GroupNotFound:
+            return "Key file does not have group “" + group + "”";
+        case IniStatus::KeyNotFound:
+            return "Key file does not have key “" + key + "” in group “" + group + "”";
+        case IniStatus::InvalidValue:
+            return "Key file contains key “" + key + "” which has a value that cannot be interpreted.";
+        case IniStatus::InvalidGroup:
+            return "Key file contains an invalid line in group “" + group + "”";
+        case IniStatus::ParseFailed:
+            return "Key file group “" + group + "” could not be parsed";
+        default:
+            return string();  // LCOV_EXCL_LINE
+    }
+}
+
+void check_ini_status(IniStatus status,
+                      char const* prefix,
+                      string const& filename,
+                      string const& group,
+                      string const& key)
+{
+    if (status != IniStatus::Ok)
+    {
+        string message(prefix);
+        message += " (";
+        message += filename;
+        message += ", group: ";
+        message += group;
+        message += "): ";
+        message += ini_status_message(status, group, key);
+        throw LogicException(message);
+    }
+}
+
+IniData::IniData()
+    : data_(""), size_(0), map_(nullptr), map_size_(0)
+{
+}
+
+IniData::~IniData()
+{
+    if (map_)
+    {
+        munmap(map_, map_size_);
+    }
+}
+
+IniData::UPtr IniData::open(string const& filename, bool lazy)
+{
+    util::ResourcePtr<int, function<void(int)>> fd(::open(filename.c_str(), O_RDONLY | O_CLOEXEC),
+                                                   [](int fd) { if (fd != -1) ::close(fd); });
+    if (fd.get() == -1)
+    {
+        throw_parse_error(filename, strerror(errno), errno);
+    }
+    return from_fd(fd.get(), filename, lazy);
+}
+
+IniData::UPtr IniData::from_fd(int fd, string const& name, bool lazy)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        throw_parse_error(name, strerror(errno), errno);
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        return from_string(read_fd(fd, name), name, lazy);
+    }
+    if (static_cast<uint64_t>(st.st_size) > numeric_limits<uint32_t>::max())
+    {
+        throw_parse_error(name, "file too large", EFBIG);
+    }
+
+    UPtr d(new IniData);
+    d->lazy_ = lazy;
+    if (st.st_size > 0)
+    {
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            throw_parse_error(name, strerror(errno), errno); // LCOV_EXCL_LINE
+        }
+        d->map_ = map;
+        d->map_size_ = st.st_size;
+        d->data_ = static_cast<char const*>(map);
+        d->size_ = st.st_size;
+    }
+    d->parse(name);
+    return d;
+}
+
+IniData::UPtr IniData::from_string(string text, string const& name, bool lazy)
+{
+    if (text.size() > numeric_limits<uint32_t>::max())
+    {
+        throw_parse_error(name, "data too large", EFBIG);
+    }
+
+    UPtr d(new IniData);
+    d->lazy_ = lazy;
+    d->owned_ = move(text);
+    d->data_ = d->owned_.data();
+    d->size_ = d->owned_.size();
+    d->parse(name);
+    return d;
+}
+
+/*
+ * Layout of a cache file: a CacheHeader, followed by the group, group index, entry,
+ * and sorted tables, followed by the text of the ini file. The tables are the in-memory
+ * representation, so a cache file is only valid for a build with the same struct
+ * layout and byte order, which the header records. The checksum covers everything
+ * after the header, in the order it is stored.
+ */
+
+namespace
+{
+
+char const cache_magic[8] = { 'U', 'N', 'I', 'N', 'I', 'C', 'C', '2' };
+uint32_t const cache_byte_order = 0x01020304;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t group_size;
+    uint32_t entry_size;
+    uint32_t num_groups;
+    uint32_t num_entries;
+    uint32_t text_size;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t checksum;
+};
+
+// Works on eight bytes at a time, so checking a cache costs much less than parsing the text.
+uint64_t checksum_of(char const* data, size_t len, uint64_t h = 14695981039346656037ull) noexcept
+{
+    uint64_t word;
+    for (; len >= sizeof(word); data += sizeof(word), len -= sizeof(word))
+    {
+        memcpy(&word, data, sizeof(word));
+        h = (h ^ word) * 1099511628211ull;
+        h ^= h >> 29;
+    }
+    for (; len > 0; ++data, --len)
+    {
+        h = (h ^ static_cast<unsigned char>(*data)) * 1099511628211ull;
+    }
+    return h;
+}
+
+bool write_all(int fd, void const* buf, size_t len) noexcept
+{
+    char const* p = static_cast<char const*>(buf);
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+} // namespace
+
+IniData::UPtr IniData::open_cached(string const& filename, string const& cache_file)
+{
+    util::ResourcePtr<int, function<void(int)>> fd(::open(filename.c_str(), O_RDONLY | O_CLOEXEC),
+                                                   [](int fd) { if (fd != -1) ::close(fd); });
+    if (fd.get() == -1)
+    {
+        throw_parse_error(filename, strerror(errno), errno);
+    }
+    struct stat st;
+    if (fstat(fd.get(), &st) == -1)
+    {
+        throw_parse_error(filename, strerror(errno), errno);  // LCOV_EXCL_LINE
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        return from_fd(fd.get(), filename);
+    }
+
+    CacheKey key;
+    key.dev = st.st_dev;
+    key.ino = st.st_ino;
+    key.size = st.st_size;
+    key.mtime_sec = st.st_mtim.tv_sec;
+    key.mtime_nsec = st.st_mtim.tv_nsec;
+
+    UPtr d = map_cache(cache_file, key);
+    if (!d)
+    {
+        d = from_fd(fd.get(), filename);
+        d->write_cache(cache_file, key);
+    }
+    return d;
+}
+
+IniData::UPtr IniData::map_cache(string const& cache_file, CacheKey const& key)
+{
+    int fd = ::open(cache_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(CacheHeader))
+    {
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    UPtr d(new IniData);
+    d->map_ = map;
+    d->map_size_ = st.st_size;
+
+    CacheHeader const* h = static_cast<CacheHeader const*>(map);
+    if (memcmp(h->magic, cache_magic, sizeof(cache_magic)) != 0
+        || h->byte_order != cache_byte_order
+        || h->group_size != sizeof(Group)
+        || h->entry_size != sizeof(Entry)
+        || h->dev != key.dev || h->ino != key.ino || h->size != key.size
+        || h->mtime_sec != key.mtime_sec || h->mtime_nsec != key.mtime_nsec)
+    {
+        return nullptr;  // Stale, or written by an incompatible build.
+    }
+
+    uint64_t expected = sizeof(CacheHeader)
+                        + uint64_t(h->num_groups) * (sizeof(Group) + sizeof(uint32_t))
+                        + uint64_t(h->num_entries) * (sizeof(Entry) + sizeof(uint32_t))
+                        + h->text_size;
+    char const* base = static_cast<char const*>(map);
+    if (expected != d->map_size_)
+    {
+        return nullptr;  // Truncated.
+    }
+
+    char const* p = base + sizeof(CacheHeader);
+    d->groups_.data = reinterpret_cast<Group const*>(p);
+    d->groups_.count = h->num_groups;
+    p += h->num_groups * sizeof(Group);
+    d->group_index_.data = reinterpret_cast<uint32_t const*>(p);
+    d->group_index_.count = h->num_groups;
+    p += h->num_groups * sizeof(uint32_t);
+    d->entries_.data = reinterpret_cast<Entry const*>(p);
+    d->entries_.count = h->num_entries;
+    p += h->num_entries * sizeof(Entry);
+    d->sorted_.data = reinterpret_cast<uint32_t const*>(p);
+    d->sorted_.count = h->num_entries;
+    p += h->num_entries * sizeof(uint32_t);
+    d->data_ = p;
+    d->size_ = h->text_size;
+
+    if (h->checksum != d->checksum())
+    {
+        return nullptr;  // Corrupt.
+    }
+    if (!d->valid_index())
+    {
+        return nullptr;  // LCOV_EXCL_LINE
+    }
+    return d;
+}
+
+// The checksum of a cache file covers the tables and the text.
+
+uint64_t IniData::checksum() const noexcept
+{
+    uint64_t sum = checksum_of(reinterpret_cast<char const*>(groups_.begin()), groups_.size() * sizeof(Group));
+    sum = checksum_of(reinterpret_cast<char const*>(group_index_.begin()), group_index_.size() * sizeof(uint32_t), sum);
+    sum = checksum_of(reinterpret_cast<char const*>(entries_.begin()), entries_.size() * sizeof(Entry), sum);
+    sum = checksum_of(reinterpret_cast<char const*>(sorted_.begin()), sorted_.size() * sizeof(uint32_t), sum);
+    return checksum_of(data_, size_, sum);
+}
+
+// Checks that every offset in the tables is in range, so that even a cache file that
+// has a valid checksum but was built from inconsistent data cannot cause a bad access.
+
+bool IniData::valid_index() const noexcept
+{
+    for (auto const& g : groups_)
+    {
+        if (uint64_t(g.name_offset) + g.name_size > size_
+            || uint64_t(g.first_entry) + g.num_entries > entries_.size())
+        {
+            return false;
+        }
+    }
+    for (auto i : group_index_)
+    {
+        if (i >= groups_.size())
+        {
+            return false;
+        }
+    }
+    for (auto const& e : entries_)
+    {
+        if (uint64_t(e.key_offset) + e.key_size > size_ || uint64_t(e.value_offset) + e.value_size > size_)
+        {
+            return false;
+        }
+    }
+    for (auto i : sorted_)
+    {
+        if (i >= entries_.size())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes the cache to a temporary file and renames it into place, so a reader
+// never maps a partially written cache.
+
+void IniData::write_cache(string const& cache_file, CacheKey const& key) const
+{
+    CacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, cache_magic, sizeof(cache_magic));
+    h.byte_order = cache_byte_order;
+    h.group_size = sizeof(Group);
+    h.entry_size = sizeof(Entry);
+    h.num_groups = groups_.size();
+    h.num_entries = entries_.size();
+    h.text_size = size_;
+    h.dev = key.dev;
+    h.ino = key.ino;
+    h.size = key.size;
+    h.mtime_sec = key.mtime_sec;
+    h.mtime_nsec = key.mtime_nsec;
+
+    h.checksum = checksum();
+
+    size_t const groups_size = groups_.size() * sizeof(Group);
+    size_t const group_index_size = group_index_.size() * sizeof(uint32_t);
+    size_t const entries_size = entries_.size() * sizeof(Entry);
+    size_t const sorted_size = sorted_.size() * sizeof(uint32_t);
+
+    string tmp = cache_file + ".XXXXXX";
+    int fd = mkostemp(&tmp[0], O_CLOEXEC);
+    if (fd == -1 && errno == ENOENT)
+    {
+        // Create the cache directory on first use.
+        auto slash = cache_file.rfind('/');
+        if (slash != string::npos && slash != 0 && mkdir(cache_file.substr(0, slash).c_str(), 0700) == 0)
+        {
+            tmp = cache_file + ".XXXXXX";
+            fd = mkostemp(&tmp[0], O_CLOEXEC);
+        }
+    }
+    if (fd == -1)
+    {
+        return;
+    }
+    bool ok = write_all(fd, &h, sizeof(h))
+              && write_all(fd, groups_.begin(), groups_size)
+              && write_all(fd, group_index_.begin(), group_index_size)
+              && write_all(fd, entries_.begin(), entries_size)
+              && write_all(fd, sorted_.begin(), sorted_size)
+              && write_all(fd, data_, size_);
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), cache_file.c_str()) != 0)
+    {
+        unlink(tmp.c_str());
+    }
+}
+
+IniData::Entry IniData::entry_of(IniLine const& line) const noexcept
+{
+    Entry e;
+    e.key_offset = line.name.data - data_;
+    e.key_size = line.name.size;
+    e.value_offset = line.value.data - data_;
+    e.value_size = line.value.size;
+    e.hash = ini_hash(line.name.data, line.name.size);
+    return e;
+}
+
+void IniData::parse(string const& name)
+{
+    if (lazy_)
+    {
+        index_groups(name);
+        return;
+    }
+
+    // First pass: record every key with the index of its group. Keys of a group
+    // that appears more than once are merged, as GKeyFile does.
+    struct Pending
+    {
+        uint32_t group;
+        Entry entry;
+    };
+    vector<Pending> pending;
+    unordered_multimap<uint32_t, uint32_t> seen;
+    int current = -1;
+
+    char const* const text_end = data_ + size_;
+    char const* line = data_;
+    while (line < text_end)
+    {
+        char const* nl = static_cast<char const*>(memchr(line, '\n', text_end - line));
+        char const* next = nl ? nl + 1 : text_end;
+        IniLine l = parse_line(line, nl ? nl : text_end, name, current >= 0);
+
+        if (l.kind == IniLine::Kind::Group)
+        {
+            IniName group_name{ l.name.data, l.name.size, ini_hash(l.name.data, l.name.size) };
+            bool added;
+            current = add_group(group_name, l.name.data - data_, seen, added);
+        }
+        else if (l.kind == IniLine::Kind::Key)
+        {
+            pending.push_back(Pending{ uint32_t(current), entry_of(l) });
+            ++group_store_[current].num_entries;
+        }
+
+        line = next;
+    }
+
+    // Second pass: lay out the entries of each group contiguously, in file order.
+    uint32_t first = 0;
+    for (auto& g : group_store_)
+    {
+        g.first_entry = first;
+        first += g.num_entries;
+    }
+    entry_store_.resize(pending.size());
+    vector<uint32_t> fill(group_store_.size(), 0);
+    for (auto const& pe : pending)
+    {
+        entry_store_[group_store_[pe.group].first_entry + fill[pe.group]++] = pe.entry;
+    }
+
+    // Build the per-group lookup permutation. The sort is stable, so for duplicate
+    // keys the last one in the file also comes last in its run of equal hashes.
+    sorted_store_.resize(entry_store_.size());
+    for (uint32_t i = 0; i < sorted_store_.size(); ++i)
+    {
+        sorted_store_[i] = i;
+    }
+    for (auto const& g : group_store_)
+    {
+        stable_sort(sorted_store_.begin() + g.first_entry,
+                    sorted_store_.begin() + g.first_entry + g.num_entries,
+                    [this](uint32_t a, uint32_t b) { return entry_store_[a].hash < entry_store_[b].hash; });
+    }
+
+    groups_.assign(group_store_);
+    entries_.assign(entry_store_);
+    sorted_.assign(sorted_store_);
+    build_group_index();
+}
+
+// Lazy mode: only group headers are parsed. Everything before the first header
+// is still checked, because a key there makes the whole file invalid.
+
+void IniData::index_groups(string const& name)
+{
+    LazyGroup* current = nullptr;
+    unordered_multimap<uint32_t, uint32_t> seen;
+
+    char const* const text_end = data_ + size_;
+    char const* line = data_;
+    while (line < text_end)
+    {
+        char const* nl = static_cast<char const*>(memchr(line, '\n', text_end - line));
+        char const* end = nl ? nl : text_end;
+        char const* next = nl ? nl + 1 : text_end;
+
+        char const* p = line;
+        while (p != end && is_space(*p))
+        {
+            ++p;
+        }
+        if (!current || (p != end && *p == '['))
+        {
+            IniLine l = parse_line(line, end, name, current != nullptr);
+            if (l.kind == IniLine::Kind::Group)
+            {
+                if (current)
+                {
+                    current->bodies.back().second = line - data_;
+                }
+                IniName group_name{ l.name.data, l.name.size, ini_hash(l.name.data, l.name.size) };
+                bool added;
+                uint32_t index = add_group(group_name, l.name.data - data_, seen, added);
+                if (added)
+                {
+                    lazy_groups_.emplace_back(new LazyGroup);
+                }
+                current = lazy_groups_[index].get();
+                current->bodies.emplace_back(next - data_, size_);
+            }
+        }
+
+        line = next;
+    }
+    build_group_index();
+}
+
+// Parses the body of a group in lazy mode. Called once per group, by the first lookup.
+
+void IniData::parse_group(LazyGroup& group) const
+{
+    static string const no_name;
+    group.entries.clear();  // Left over from an attempt that ran out of memory.
+    group.sorted.clear();
+    try
+    {
+        for (auto const& body : group.bodies)
+        {
+            char const* const body_end = data_ + body.second;
+            char const* line = data_ + body.first;
+            while (line < body_end)
+            {
+                char const* nl = static_cast<char const*>(memchr(line, '\n', body_end - line));
+                IniLine l = parse_line(line, nl ? nl : body_end, no_name, true);
+                if (l.kind == IniLine::Kind::Key)
+                {
+                    group.entries.push_back(entry_of(l));
+                }
+                line = nl ? nl + 1 : body_end;
+            }
+        }
+    }
+    catch (FileException const&)
+    {
+        group.status = IniStatus::InvalidGroup;
+        group.entries.clear();
+    }
+
+    group.sorted.resize(group.entries.size());
+    for (uint32_t i = 0; i < group.sorted.size(); ++i)
+    {
+        group.sorted[i] = i;
+    }
+    stable_sort(group.sorted.begin(), group.sorted.end(), [&group](uint32_t a, uint32_t b)
+    {
+        return group.entries[a].hash < group.entries[b].hash;
+    });
+}
+
+// Finds a group while the text is parsed, or adds it if this is its first header.
+// The group index is only built once all groups are known, so parsing looks up
+// groups in seen, which maps hashes to indexes into group_store_.
+
+uint32_t IniData::add_group(IniName const& group_name,
+                            uint32_t offset,
+                            unordered_multimap<uint32_t, uint32_t>& seen,
+                            bool& added)
+{
+    auto range = seen.equal_range(group_name.hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        Group const& g = group_store_[it->second];
+        if (name(g.name_offset, g.name_size).equals(group_name.data, group_name.size))
+        {
+            added = false;
+            return it->second;
+        }
+    }
+
+    Group ng;
+    ng.name_offset = offset;
+    ng.name_size = group_name.size;
+    ng.hash = group_name.hash;
+    ng.first_entry = 0;
+    ng.num_entries = 0;
+    group_store_.push_back(ng);
+    groups_.assign(group_store_);
+    uint32_t index = group_store_.size() - 1;
+    seen.emplace(group_name.hash, index);
+    added = true;
+    return index;
+}
+
+void IniData::build_group_index()
+{
+    group_index_store_.resize(group_store_.size());
+    for (uint32_t i = 0; i < group_index_store_.size(); ++i)
+    {
+        group_index_store_[i] = i;
+    }
+    sort(group_index_store_.begin(), group_index_store_.end(), [this](uint32_t a, uint32_t b)
+    {
+        return group_store_[a].hash < group_store_[b].hash;
+    });
+    group_index_.assign(group_index_store_);
+}
+
+IniData::Group const* IniData::find_group(IniName const& name) const noexcept
+{
+    auto begin = group_index_.begin();
+    auto end = group_index_.end();
+    auto it = lower_bound(begin, end, name.hash, [this](uint32_t i, uint32_t h) { return groups_[i].hash < h; });
+    for (; it != end && groups_[*it].hash == name.hash; ++it)
+    {
+        Group const& g = groups_[*it];
+        if (this->name(g.name_offset, g.name_size).equals(name.data, name.size))
+        {
+            return &g;
+        }
+    }
+    return nullptr;
+}
+
+IniStatus IniData::find_group(IniName const& name, GroupView& view) const noexcept
+{
+    Group const* g = find_group(name);
+    if (!g)
+    {
+        return IniStatus::GroupNotFound;
+    }
+    if (!lazy_)
+    {
+        view = GroupView{ entries_.begin() + g->first_entry, g->num_entries,
+                          sorted_.begin() + g->first_entry, entries_.begin() };
+        return IniStatus::Ok;
+    }
+
+    LazyGroup& lg = *lazy_groups_[g - groups_.begin()];
+    try
+    {
+        call_once(lg.parsed, [this, &lg] { parse_group(lg); });
+    }
+    catch (...)
+    {
+        return IniStatus::ParseFailed;  // bad_alloc or system_error; parsed stays unset.
+    }
+    if (lg.status != IniStatus::Ok)
+    {
+        return lg.status;
+    }
+    view = GroupView{ lg.entries.data(), uint32_t(lg.entries.size()), lg.sorted.data(), lg.entries.data() };
+    return IniStatus::Ok;
+}
+
+template<typename Equals>
+IniData::Entry const* IniData::find_entry(GroupView const& group, uint32_t hash, Equals equals) const noexcept
+{
+    auto begin = group.sorted;
+    auto end = begin + group.size;
+    auto it = lower_bound(begin, end, hash, [&group](uint32_t i, uint32_t h) { return group.base[i].hash < h; });
+
+    // If a key appears more than once, the last occurrence wins.
+    Entry const* found = nullptr;
+    for (; it != end && group.base[*it].hash == hash; ++it)
+    {
+        Entry const& e = group.base[*it];
+        if (equals(e))
+        {
+            found = &e;
+        }
+    }
+    return found;
+}
+
+IniData::Entry const* IniData::find_entry(GroupView const& group, IniName const& key) const noexcept
+{
+    return find_entry(group, key.hash, [this, &key](Entry const& e)
+    {
+        return name(e.key_offset, e.key_size).equals(key.data, key.size);
+    });
+}
+
+// Finds "key[lang]" without building the name.
+
+IniData::Entry const* IniData::find_translation(GroupView const& group,
+                                                IniName const& key,
+                                                char const* lang,
+                                                size_t lang_size) const noexcept
+{
+    uint32_t h = ini_hash_more(key.hash, "[", 1);
+    h = ini_hash_more(h, lang, lang_size);
+    h = ini_hash_more(h, "]", 1);
+    return find_entry(group, h, [this, &key, lang, lang_size](Entry const& e)
+    {
+        char const* k = name(e.key_offset, e.key_size).data;
+        return e.key_size == key.size + lang_size + 2
+               && memcmp(k, key.data, key.size) == 0
+               && k[key.size] == '['
+               && memcmp(k + key.size + 1, lang, lang_size) == 0
+               && k[e.key_size - 1] == ']';
+    });
+}
+
+bool IniData::has_group(string const& group) const noexcept
+{
+    return find_group(name_of(group)) != nullptr;
+}
+
+IniStatus IniData::has_key(string const& group, string const& key, bool& found) const noexcept
+{
+    return has_key(name_of(group), name_of(key), found);
+}
+
+IniStatus IniData::has_key(IniName const& group, IniName const& key, bool& found) const noexcept
+{
+    GroupView g;
+    IniStatus status = find_group(group, g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+    found = find_entry(g, key) != nullptr;
+    return IniStatus::Ok;
+}
+
+IniStatus IniData::get_value(string const& group, string const& key, IniSpan& value) const noexcept
+{
+    return get_value(name_of(group), name_of(key), value);
+}
+
+IniStatus IniData::get_value(IniName const& group, IniName const& key, IniSpan& value) const noexcept
+{
+    GroupView g;
+    IniStatus status = find_group(group, g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+    Entry const* e = find_entry(g, key);
+    if (!e)
+    {
+        return IniStatus::KeyNotFound;
+    }
+    value = span(e->value_offset, e->value_size);
+    return IniStatus::Ok;
+}
+
+IniStatus IniData::get_locale_value(string const& group,
+                                    string const& key,
+                                    string const& locale,
+                                    IniSpan& value) const
+{
+    return get_locale_value(name_of(group), name_of(key), locale, value);
+}
+
+IniStatus IniData::get_locale_value(IniName const& group,
+                                    IniName const& key,
+                                    string const& locale,
+                                    IniSpan& value) const
+{
+    if (!locale.empty())
+    {
+        // Callers usually ask for the same locale many times in a row, so the variants
+        // of the last locale are kept for the next lookup on the same thread.
+        static thread_local string last_locale;
+        static thread_local vector<string> last_variants;
+        if (locale != last_locale || last_variants.empty())
+        {
+            last_variants = locale_variants(locale);
+            last_locale = locale;
+        }
+        return get_locale_value(group, key, last_variants, value);
+    }
+
+    GroupView g;
+    IniStatus status = find_group(group, g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+
+    // GLib caches the language names, so this does not allocate.
+    Entry const* e = nullptr;
+    for (gchar const* const* l = g_get_language_names(); !e && *l; ++l)
+    {
+        e = find_translation(g, key, *l, strlen(*l));
+    }
+    if (!e)
+    {
+        e = find_entry(g, key);
+    }
+    if (!e)
+    {
+        return IniStatus::KeyNotFound;
+    }
+    value = span(e->value_offset, e->value_size);
+    return IniStatus::Ok;
+}
+
+IniStatus IniData::get_locale_value(string const& group,
+                                    string const& key,
+                                    vector<string> const& variants,
+                                    IniSpan& value) const noexcept
+{
+    return get_locale_value(name_of(group), name_of(key), variants, value);
+}
+
+IniStatus IniData::get_locale_value(IniName const& group,
+                                    IniName const& key,
+                                    vector<string> const& variants,
+                                    IniSpan& value) const noexcept
+{
+    GroupView g;
+    IniStatus status = find_group(group, g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+
+    Entry const* e = nullptr;
+    for (auto const& v : variants)
+    {
+        if ((e = find_translation(g, key, v.data(), v.size())))
+        {
+            break;
+        }
+    }
+    if (!e)
+    {
+        e = find_entry(g, key);
+    }
+    if (!e)
+    {
+        return IniStatus::KeyNotFound;
+    }
+    value = span(e->value_offset, e->value_size);
+    return IniStatus::Ok;
+}
+
+string IniData::start_group() const
+{
+    return groups_.empty() ? string() : name(groups_[0].name_offset, groups_[0].name_size).str();
+}
+
+vector<string> IniData::groups() const
+{
+    vector<string> result;
+    result.reserve(groups_.size());
+    for (auto const& g : groups_)
+    {
+        result.push_back(name(g.name_offset, g.name_size).str());
+    }
+    return result;
+}
+
+IniStatus IniData::keys(string const& group, vector<string>& keys) const
+{
+    GroupView g;
+    IniStatus status = find_group(name_of(group), g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+    keys.reserve(keys.size() + g.size);
+    for (uint32_t i = 0; i < g.size; ++i)
+    {
+        keys.push_back(name(g.entries[i].key_offset, g.entries[i].key_size).str());
+    }
+    return IniStatus::Ok;
+}
+
+void IniData::for_each_group(function<bool(char const*, size_t)> const& f) const
+{
+    for (auto const& g : groups_)
+    {
+        IniSpan n = name(g.name_offset, g.name_size);
+        if (!f(n.data, n.size))
+        {
+            return;
+        }
+    }
+}
+
+IniStatus IniData::for_each_key(string const& group, function<bool(char const*, size_t)> const& f) const
+{
+    GroupView g;
+    IniStatus status = find_group(name_of(group), g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+    for (uint32_t i = 0; i < g.size; ++i)
+    {
+        IniSpan n = name(g.entries[i].key_offset, g.entries[i].key_size);
+        if (!f(n.data, n.size))
+        {
+            break;
+        }
+    }
+    return IniStatus::Ok;
+}
+
+IniStatus IniData::entries(string const& group, vector<pair<IniSpan, IniSpan>>& entries) const
+{
+    GroupView g;
+    IniStatus status = find_group(name_of(group), g);
+    if (status != IniStatus::Ok)
+    {
+        return status;
+    }
+    entries.reserve(entries.size() + g.size);
+    for (uint32_t i = 0; i < g.size; ++i)
+    {
+        Entry const& e = g.entries[i];
+        entries.emplace_back(name(e.key_offset, e.key_size), span(e.value_offset, e.value_size));
+    }
+    return IniStatus::Ok;
+}
+
+void IniData::compact()
+{
+    if (lazy_ || compacted_)
+    {
+        return;
+    }
+
+    size_t values_size = 0;
+    for (auto const& e : entries_)
+    {
+        values_size += e.value_size;
+    }
+    string values;
+    values.reserve(values_size);
+
+    vector<char const*> names;
+    names.reserve(group_store_.size() + entry_store_.size());
+    {
+        NameTable& table = name_table();
+        lock_guard<mutex> lock(table.m);
+        auto intern = [this, &table, &names](uint32_t& offset, uint32_t size)
+        {
+            auto r = table.names.emplace(data_ + offset, size);
+            if (r.second)
+            {
+                table.bytes += size;
+            }
+            offset = names.size();
+            names.push_back(r.first->data());
+        };
+        for (auto& g : group_store_)
+        {
+            intern(g.name_offset, g.name_size);
+        }
+        for (auto& e : entry_store_)
+        {
+            intern(e.key_offset, e.key_size);
+        }
+    }
+    for (auto& e : entry_store_)
+    {
+        uint32_t offset = values.size();
+        values.append(data_ + e.value_offset, e.value_size);
+        e.value_offset = offset;
+    }
+
+    if (map_)
+    {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        map_size_ = 0;
+    }
+    owned_ = move(values);
+    data_ = owned_.data();
+    size_ = owned_.size();
+    names_ = move(names);
+    compacted_ = true;
+}
+
+string IniData::to_text() const
+{
+    if (!compacted_)
+    {
+        return string(data_, size_);
+    }
+
+    string text;
+    for (auto const& g : groups_)
+    {
+        text += '[';
+        text.append(names_[g.name_offset], g.name_size);
+        text += "]\n";
+        for (uint32_t i = g.first_entry; i < g.first_entry + g.num_entries; ++i)
+        {
+            Entry const& e = entries_[i];
+            text.append(names_[e.key_offset], e.key_size);
+            text += '=';
+            text.append(data_ + e.value_offset, e.value_size);
+            text += '\n';
+        }
+    }
+    return text;
+}
+
+IniStatus IniData::to_string(IniSpan raw, string& value)
+{
+    if (!g_utf8_validate(raw.data, raw.size, nullptr))
+    {
+        return IniStatus::InvalidValue;
+    }
+    string result;
+    IniStatus s = unescape(raw, false, result);
+    if (s == IniStatus::Ok)
+    {
+        value = move(result);
+    }
+    return s;
+}
+
+IniStatus IniData::to_string_list(IniSpan raw, vector<string>& value)
+{
+    vector<string> result;
+    result.reserve(max_items(raw));
+    IniStatus s = for_each_item(raw, [&result](IniSpan element)
+    {
+        result.push_back(element.str());
+        return IniStatus::Ok;
+    });
+    if (s == IniStatus::Ok)
+    {
+        value = move(result);
+    }
+    return s;
+}
+
+IniStatus IniData::to_boolean(IniSpan raw, bool& value) noexcept
+{
+    // Trailing white space is ignored.
+    size_t len = raw.size;
+    while (len > 0 && is_space(raw.data[len - 1]))
+    {
+        --len;
+    }
+    IniSpan trimmed{ raw.data, len };
+    if (trimmed.equals("true", 4) || trimmed.equals("1", 1))
+    {
+        value = true;
+        return IniStatus::Ok;
+    }
+    if (trimmed.equals("false", 5) || trimmed.equals("0", 1))
+    {
+        value = false;
+        return IniStatus::Ok;
+    }
+    return IniStatus::InvalidValue;
+}
+
+IniStatus IniData::to_int(IniSpan raw, int& value) noexcept
+{
+    char buf[64];
+    if (raw.size == 0 || !copy_number(raw, buf, sizeof(buf)))
+    {
+        return IniStatus::InvalidValue;
+    }
+    char* end;
+    errno = 0;
+    long l = strtol(buf, &end, 10);
+    if (end == buf || (*end != '\0' && !is_space(*end)))
+    {
+        return IniStatus::InvalidValue;
+    }
+    if (errno == ERANGE || l < INT_MIN || l > INT_MAX)
+    {
+        return IniStatus::InvalidValue;
+    }
+    value = l;
+    return IniStatus::Ok;
+}
+
+IniStatus IniData::to_double(IniSpan raw, double& value) noexcept
+{
+    char buf[128];
+    if (raw.size == 0 || !copy_number(raw, buf, sizeof(buf)))
+    {
+        return IniStatus::InvalidValue;
+    }
+    char* end;
+    double d = g_ascii_strtod(buf, &end);
+    if (end == buf || *end != '\0')
+    {
+        return IniStatus::InvalidValue;
+    }
+    value = d;
+    return IniStatus::Ok;
+}
+
+IniStatus IniData::to_boolean_list(IniSpan raw, vector<bool>& value)
+{
+    return convert_list(raw, to_boolean, value);
+}
+
+IniStatus IniData::to_int_list(IniSpan raw, vector<int>& value)
+{
+    return convert_list(raw, to_int, value);
+}
+
+IniStatus IniData::to_double_list(IniSpan raw, vector<double>& value)
+{
+    return convert_list(raw, to_double, value);
+}
+
+IniStatus IniData::to_boolean_buffer(IniSpan raw, bool* buf, size_t buf_size, size_t& count)
+{
+    return convert_list(raw, to_boolean, buf, buf_size, count);
+}
+
+IniStatus IniData::to_int_buffer(IniSpan raw, int* buf, size_t buf_size, size_t& count)
+{
+    return convert_list(raw, to_int, buf, buf_size, count);
+}
+
+IniStatus IniData::to_double_buffer(IniSpan raw, double* buf, size_t buf_size, size_t& count)
+{
+    return convert_list(raw, to_double, buf, buf_size, count);
+}
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/internal/IniPatch.h>
+
+#include <glib.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+namespace
+{
+
+// Location of one occurrence of a group: from the start of its header line to
+// the end of its last key line (or of the header, if it has no keys).
+struct GroupPos
+{
+    size_t header;
+    size_t content_end;
+};
+
+// Location of one key line, and of the value within it.
+struct KeyPos
+{
+    size_t start;
+    size_t next;
+    size_t value_begin;
+    size_t value_end;
+};
+
+// Replaces [begin, end) of the original text. Insertions have begin == end.
+struct Edit
+{
+    size_t begin;
+    size_t end;
+    string text;
+};
+
+void add_line(string& s, string const& key, string const& value)
+{
+    s += key;
+    s += '=';
+    s += value;
+    s += '\n';
+}
+
+} // namespace
+
+IniPatch::GroupChanges& IniPatch::changes_for(string const& group)
+{
+    auto it = groups_.find(group);
+    if (it == groups_.end())
+    {
+        order_.push_back(group);
+        it = groups_.emplace(group, GroupChanges()).first;
+    }
+    return it->second;
+}
+
+void IniPatch::set_value(string const& group, string const& key, string const& value)
+{
+    GroupChanges& gc = changes_for(group);
+    gc.removed_keys.erase(key);
+    for (auto& v : gc.values)
+    {
+        if (v.first == key)
+        {
+            v.second = value;
+            return;
+        }
+    }
+    gc.values.emplace_back(key, value);
+}
+
+void IniPatch::remove_key(string const& group, string const& key)
+{
+    GroupChanges& gc = changes_for(group);
+    gc.values.erase(remove_if(gc.values.begin(), gc.values.end(),
+                              [&key](pair<string, string> const& v) { return v.first == key; }),
+                    gc.values.end());
+    gc.removed_keys.insert(key);
+}
+
+void IniPatch::remove_group(string const& group)
+{
+    GroupChanges& gc = changes_for(group);
+    gc.removed = true;
+    gc.values.clear();
+    gc.removed_keys.clear();
+}
+
+bool IniPatch::empty() const noexcept
+{
+    return groups_.empty();
+}
+
+string IniPatch::apply(string const& text) const
+{
+    // Locate the groups and keys that change. Everything else is only skipped over.
+    map<string, vector<GroupPos>> group_pos;
+    map<string, map<string, vector<KeyPos>>> key_pos;
+    for (auto const& g : groups_)
+    {
+        auto& keys = key_pos[g.first];
+        for (auto const& v : g.second.values)
+        {
+            keys[v.first];
+        }
+        for (auto const& k : g.second.removed_keys)
+        {
+            keys[k];
+        }
+    }
+
+    vector<GroupPos>* current_group = nullptr;
+    map<string, vector<KeyPos>>* current_keys = nullptr;
+    char const* const data = text.data();
+    size_t line = 0;
+    while (line < text.size())
+    {
+        char const* nl = static_cast<char const*>(memchr(data + line, '\n', text.size() - line));
+        size_t next = nl ? nl - data + 1 : text.size();
+        size_t end = nl ? nl - data : text.size();
+        if (end > line && data[end - 1] == '\r')
+        {
+            --end;
+        }
+
+        size_t p = line;
+        while (p != end && g_ascii_isspace(data[p]))
+        {
+            ++p;
+        }
+
+        if (p == end || data[p] == '#')
+        {
+            // Blank line or comment.
+        }
+        else if (data[p] == '[')
+        {
+            char const* close = static_cast<char const*>(memchr(data + p, ']', end - p));
+            string name(data + p + 1, close ? close - data - p - 1 : end - p - 1);
+            auto it = groups_.find(name);
+            if (it != groups_.end())
+            {
+                current_group = &group_pos[name];
+                current_group->push_back(GroupPos{ line, next });
+                current_keys = &key_pos[name];
+            }
+            else
+            {
+                current_group = nullptr;
+                current_keys = nullptr;
+            }
+        }
+        else if (current_group)
+        {
+            current_group->back().content_end = next;
+
+            char const* eq = static_cast<char const*>(memchr(data + p, '=', end - p));
+            if (eq)
+            {
+                size_t key_end = eq - data;
+                while (key_end != p && g_ascii_isspace(data[key_end - 1]))
+                {
+                    --key_end;
+                }
+                auto it = current_keys->find(string(data + p, key_end - p));
+                if (it != current_keys->end())
+                {
+                    size_t value = eq - data + 1;
+                    while (value != end && g_ascii_isspace(data[value]))
+                    {
+                        ++value;
+                    }
+                    it->second.push_back(KeyPos{ line, next, value, end });
+                }
+            }
+        }
+
+        line = next;
+    }
+
+    vector<Edit> edits;
+    string tail;  // New groups, appended at the end.
+    auto append_group = [&tail](string const& name, vector<pair<string, string>> const& values)
+    {
+        tail += "\n[";
+        tail += name;
+        tail += "]\n";
+        for (auto const& v : values)
+        {
+            add_line(tail, v.first, v.second);
+        }
+    };
+
+    for (auto const& name : order_)
+    {
+        GroupChanges const& gc = groups_.find(name)->second;
+        vector<GroupPos> const& occurrences = group_pos[name];
+        map<string, vector<KeyPos>> const& keys = key_pos[name];
+
+        if (gc.removed)
+        {
+            for (size_t i = 0; i < occurrences.size(); ++i)
+            {
+                string replacement;
+                if (i == 0 && !gc.values.empty())
+                {
+                    replacement = "[" + name + "]\n";
+                    for (auto const& v : gc.values)
+                    {
+                        add_line(replacement, v.first, v.second);
+                    }
+                }
+                edits.push_back(Edit{ occurrences[i].header, occurrences[i].content_end, move(replacement) });
+            }
+            if (occurrences.empty() && !gc.values.empty())
+            {
+                append_group(name, gc.values);
+            }
+            continue;
+        }
+
+        for (auto const& k : gc.removed_keys)
+        {
+            for (auto const& pos : keys.find(k)->second)
+            {
+                edits.push_back(Edit{ pos.start, pos.next, string() });
+            }
+        }
+
+        vector<pair<string, string>> new_keys;
+        for (auto const& v : gc.values)
+        {
+            auto const& positions = keys.find(v.first)->second;
+            if (positions.empty())
+            {
+                new_keys.push_back(v);
+            }
+            else
+            {
+                // Only the value changes; the key and the spacing around '=' stay as they are.
+                edits.push_back(Edit{ positions.back().value_begin, positions.back().value_end, v.second });
+            }
+        }
+        if (new_keys.empty())
+        {
+            continue;
+        }
+        if (occurrences.empty())
+        {
+            append_group(name, new_keys);
+            continue;
+        }
+        size_t at = occurrences.back().content_end;
+        string lines;
+        if (at > 0 && data[at - 1] != '\n')
+        {
+            lines += '\n';  // The last line of the file has no newline.
+        }
+        for (auto const& v : new_keys)
+        {
+            add_line(lines, v.first, v.second);
+        }
+        edits.push_back(Edit{ at, at, move(lines) });
+    }
+
+    // Insertions sort before a replacement that starts at the same offset.
+    stable_sort(edits.begin(), edits.end(), [](Edit const& a, Edit const& b)
+    {
+        return a.begin < b.begin || (a.begin == b.begin && a.end < b.end);
+    });
+
+    string result;
+    size_t size = text.size() + tail.size() + 1;
+    for (auto const& e : edits)
+    {
+        size += e.text.size();
+    }
+    result.reserve(size);
+
+    size_t pos = 0;
+    for (auto const& e : edits)
+    {
+        result.append(text, pos, e.begin - pos);
+        result += e.text;
+        pos = e.end;
+    }
+    result.append(text, pos, string::npos);
+
+    if (!tail.empty())
+    {
+        if (result.empty())
+        {
+            tail.erase(0, 1);  // No blank line before the first group.
+        }
+        else if (result.back() != '\n')
+        {
+            result += '\n';
+        }
+        result += tail;
+    }
+    return result;
+}
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <unity/util/internal/ParallelFor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+void parallel_for(size_t count, size_t num_threads, function<void(size_t)> const& task)
+{
+    atomic<size_t> next(0);
+    mutex error_mutex;
+    exception_ptr error;
+    auto work = [&]
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(error_mutex);
+                if (!error)
+                {
+                    error = current_exception();
+                }
+            }
+        }
+    };
+
+    // A thread that is still joinable when its destructor runs terminates the
+    // process, so the threads are joined even if starting another one fails.
+    vector<thread> threads;
+    num_threads = min(num_threads, count);
+    try
+    {
+        threads.reserve(num_threads);
+        for (size_t t = 1; t < num_threads; ++t)
+        {
+            threads.emplace_back(work);
+        }
+    }
+    catch (std::exception const&)
+    {
+        // system_error or bad_alloc: the threads we have take on the rest.
+    }
+    work();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    if (error)
+    {
+        rethrow_exception(error);
+    }
+}
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
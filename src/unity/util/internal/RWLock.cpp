@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unity/util/internal/RWLock.h>
+
+#include <glib.h>
+
+namespace unity
+{
+
+namespace util
+{
+
+namespace internal
+{
+
+ReaderLock::ReaderLock(GRWLock& lock)
+    : lock_(lock)
+{
+    g_rw_lock_reader_lock(&lock_);
+}
+
+ReaderLock::~ReaderLock()
+{
+    g_rw_lock_reader_unlock(&lock_);
+}
+
+WriterLock::WriterLock(GRWLock& lock)
+    : lock_(lock)
+{
+    g_rw_lock_writer_lock(&lock_);
+}
+
+WriterLock::~WriterLock()
+{
+    g_rw_lock_writer_unlock(&lock_);
+}
+
+} // namespace internal
+
+} // namespace util
+
+} // namespace unity
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+#include <unity/util/FileIO.h>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace unity::util;
+
+// Benchmarks are not run as part of "make test". Run the FileIO_bench
+// executable by hand to compare numbers before and after a change.
+
+namespace
+{
+
+// Drops the files from the page cache, so the next read has to go to the disk.
+// This only works for clean pages, which is why the files are synced after writing.
+void drop_from_cache(vector<string> const& files)
+{
+    for (auto const& name : files)
+    {
+        int fd = open(name.c_str(), O_RDONLY);
+        if (fd != -1)
+        {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
+
+} // namespace
+
+TEST(FileIOBench, read_files_cold)
+{
+    // 500 small files, about the size of a .desktop file each.
+    string dir = TEST_RUNTIME_PATH "/fileio_bench";
+    mkdir(dir.c_str(), 0700);
+    vector<string> files;
+    string contents(3000, 'x');
+    for (int i = 0; i < 500; ++i)
+    {
+        string name = dir + "/file" + to_string(i);
+        int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        ASSERT_NE(-1, fd);
+        ASSERT_EQ(ssize_t(contents.size()), write(fd, contents.data(), contents.size()));
+        fsync(fd);
+        close(fd);
+        files.push_back(name);
+    }
+
+    const int rounds = 5;
+    auto time = [&](char const* scenario, bool cold, function<size_t()> read_all)
+    {
+        double total = 0;
+        size_t bytes = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            if (cold)
+            {
+                drop_from_cache(files);
+            }
+            auto start = chrono::steady_clock::now();
+            bytes += read_all();
+            total += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+        cout << setw(36) << left << scenario
+             << " files: " << files.size()
+             << " time per round: " << fixed << setprecision(2) << total / rounds << " ms"
+             << " (" << bytes / rounds << " bytes)" << endl;
+    };
+
+    auto serial = [&]
+    {
+        size_t bytes = 0;
+        for (auto const& name : files)
+        {
+            bytes += read_text_file(name).size();
+        }
+        return bytes;
+    };
+    auto parallel = [&]
+    {
+        size_t bytes = 0;
+        for (auto const& r : read_files(files))
+        {
+            bytes += r.contents.size();
+        }
+        return bytes;
+    };
+
+    for (bool cold : { true, false })
+    {
+        time(cold ? "read_text_file() serial, cold" : "read_text_file() serial, warm", cold, serial);
+        time(cold ? "read_files(), cold" : "read_files(), warm", cold, parallel);
+    }
+
+    for (auto const& name : files)
+    {
+        remove(name.c_str());
+    }
+    rmdir(dir.c_str());
+}
@@ -22,6 +22,11 @@
 #include <gtest/gtest.h>
 
 #include <fstream>
+#include <set>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/stat.h>
 
 using namespace std;
 using namespace unity;
@@ -53,6 +58,263 @@ TEST(FileIO, basic)
     EXPECT_TRUE(s.empty());
 }
 
+TEST(FileIO, unsizedFiles)
+{
+    // Files in /proc report a size of zero.
+    string status = read_text_file("/proc/self/status");
+    EXPECT_EQ(0u, status.find("Name:"));
+    EXPECT_EQ('\n', status.back());
+
+    // A pipe delivers the data in several short reads.
+    string contents;
+    for (int i = 0; i < 20000; ++i)
+    {
+        contents += "line " + to_string(i) + "\n";
+    }
+    remove("fifo");
+    ASSERT_EQ(0, mkfifo("fifo", 0600));
+    thread writer([&contents]
+    {
+        FILE* f = fopen("fifo", "w");
+        for (size_t pos = 0; pos < contents.size(); pos += 1000)
+        {
+            fwrite(contents.data() + pos, 1, min(size_t(1000), contents.size() - pos), f);
+            fflush(f);
+        }
+        fclose(f);
+    });
+    EXPECT_EQ(contents, read_text_file("fifo"));
+    writer.join();
+    remove("fifo");
+}
+
+TEST(FileIO, chunks)
+{
+    string contents;
+    for (int i = 0; i < 1000; ++i)
+    {
+        contents += "line " + to_string(i) + "\n";
+    }
+    remove("chunkfile");
+    FILE* f = fopen("chunkfile", "w");
+    EXPECT_NE(f, nullptr);
+    fputs(contents.c_str(), f);
+    fclose(f);
+
+    string result;
+    vector<size_t> sizes;
+    read_file_chunks("chunkfile", [&](char const* data, size_t size)
+    {
+        result.append(data, size);
+        sizes.push_back(size);
+        return true;
+    }, 1000);
+    EXPECT_EQ(contents, result);
+    ASSERT_EQ((contents.size() + 999) / 1000, sizes.size());
+    EXPECT_EQ(1000u, sizes.front());
+    EXPECT_EQ(contents.size() % 1000, sizes.back());
+
+    // Returning false stops reading.
+    int calls = 0;
+    read_file_chunks("chunkfile", [&calls](char const*, size_t) { return ++calls < 2; }, 100);
+    EXPECT_EQ(2, calls);
+
+    remove("empty");
+    f = fopen("empty", "w");
+    EXPECT_NE(f, nullptr);
+    fclose(f);
+    calls = 0;
+    read_file_chunks("empty", [&calls](char const*, size_t) { return ++calls != 0; });
+    EXPECT_EQ(0, calls);
+
+    EXPECT_THROW(read_file_chunks("chunkfile", [](char const*, size_t) { return true; }, 0),
+                 InvalidArgumentException);
+    EXPECT_THROW(read_file_chunks("no_such_file", [](char const*, size_t) { return true; }), FileException);
+    remove("chunkfile");
+}
+
+TEST(FileIO, readFiles)
+{
+    vector<string> names;
+    for (int i = 0; i < 50; ++i)
+    {
+        string name = "batch" + to_string(i);
+        remove(name.c_str());
+        if (i % 10 != 3)
+        {
+            FILE* f = fopen(name.c_str(), "w");
+            EXPECT_NE(f, nullptr);
+            fputs(("contents of " + name).c_str(), f);
+            fclose(f);
+        }
+        names.push_back(name);
+    }
+
+    for (unsigned threads : { 0, 1, 4 })
+    {
+        vector<FileReadResult> results = read_files(names, threads);
+        ASSERT_EQ(names.size(), results.size());
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            if (i % 10 == 3)
+            {
+                EXPECT_EQ("unity::FileException: cannot open \"" + names[i]
+                              + "\": No such file or directory (errno = 2)",
+                          results[i].error);
+                EXPECT_TRUE(results[i].contents.empty());
+            }
+            else
+            {
+                EXPECT_EQ("", results[i].error);
+                EXPECT_EQ("contents of " + names[i], results[i].contents);
+            }
+        }
+    }
+    EXPECT_TRUE(read_files({}).empty());
+
+    for (auto const& name : names)
+    {
+        remove(name.c_str());
+    }
+}
+
+TEST(FileIO, mapFile)
+{
+    string contents;
+    for (int i = 0; i < 10000; ++i)
+    {
+        contents += "line " + to_string(i) + "\n";
+    }
+    remove("mapfile");
+    FILE* f = fopen("mapfile", "w");
+    EXPECT_NE(f, nullptr);
+    fputs(contents.c_str(), f);
+    fclose(f);
+
+    MappedFile m = map_file("mapfile");
+    EXPECT_EQ(contents.size(), m.size());
+    EXPECT_FALSE(m.empty());
+    EXPECT_EQ(contents, string(m.begin(), m.end()));
+    EXPECT_EQ(contents, m.str());
+
+    // The mapping moves with the object.
+    MappedFile m2(move(m));
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(nullptr, m.data());
+    EXPECT_EQ(contents, m2.str());
+    m = move(m2);
+    EXPECT_EQ(contents, m.str());
+    EXPECT_TRUE(m2.empty());
+
+    // The mapping stays valid after the file is removed.
+    remove("mapfile");
+    EXPECT_EQ(contents, m.str());
+
+    remove("empty");
+    f = fopen("empty", "w");
+    EXPECT_NE(f, nullptr);
+    fclose(f);
+    MappedFile e = map_file("empty");
+    EXPECT_TRUE(e.empty());
+    EXPECT_EQ(nullptr, e.data());
+    EXPECT_EQ("", e.str());
+}
+
+namespace
+{
+
+set<string> directory_entries(string const& dir)
+{
+    set<string> entries;
+    DIR* d = opendir(dir.c_str());
+    while (dirent* e = readdir(d))
+    {
+        if (e->d_name[0] != '.')
+        {
+            entries.insert(e->d_name);
+        }
+    }
+    closedir(d);
+    return entries;
+}
+
+}
+
+TEST(FileIO, writeFiles)
+{
+    ASSERT_EQ(0, system("rm -rf writedir"));
+    ASSERT_EQ(0, mkdir("writedir", 0700));
+
+    for (auto policy : { SyncPolicy::None, SyncPolicy::File, SyncPolicy::FileAndDirectory })
+    {
+        write_text_file("writedir/text", "some chars\n", policy);
+        EXPECT_EQ("some chars\n", read_text_file("writedir/text"));
+    }
+    write_text_file("writedir/text", "");
+    EXPECT_EQ("", read_text_file("writedir/text"));
+
+    vector<uint8_t> binary{ 0, 1, 2, 255 };
+    write_binary_file("writedir/binary", binary);
+    EXPECT_EQ(binary, read_binary_file("writedir/binary"));
+
+    // The permissions of an existing file are kept.
+    ASSERT_EQ(0, chmod("writedir/binary", 0640));
+    write_binary_file("writedir/binary", vector<uint8_t>{ 3 });
+    struct stat st;
+    ASSERT_EQ(0, stat("writedir/binary", &st));
+    EXPECT_EQ(0640u, st.st_mode & 07777);
+    EXPECT_EQ(vector<uint8_t>{ 3 }, read_binary_file("writedir/binary"));
+
+    // More chunks than writev() accepts in one call.
+    vector<string> pieces;
+    vector<FileChunk> chunks;
+    string expected;
+    for (int i = 0; i < 3000; ++i)
+    {
+        pieces.push_back(i % 7 == 0 ? string() : to_string(i) + ",");
+        expected += pieces.back();
+    }
+    for (auto const& piece : pieces)
+    {
+        chunks.push_back(FileChunk{ piece.data(), piece.size() });
+    }
+    write_file_chunks("writedir/chunks", chunks, SyncPolicy::FileAndDirectory);
+    EXPECT_EQ(expected, read_text_file("writedir/chunks"));
+
+    // A reader that opened the old file still sees the old contents.
+    MappedFile old = map_file("writedir/chunks");
+    write_text_file("writedir/chunks", "new");
+    EXPECT_EQ(expected, old.str());
+    EXPECT_EQ("new", read_text_file("writedir/chunks"));
+
+    // The status of the written file is that of the file that ends up in place.
+    struct stat written;
+    write_text_file("writedir/chunks", "newer", SyncPolicy::None, &written);
+    ASSERT_EQ(0, stat("writedir/chunks", &st));
+    EXPECT_EQ(st.st_dev, written.st_dev);
+    EXPECT_EQ(st.st_ino, written.st_ino);
+    EXPECT_EQ(5, written.st_size);
+
+    // No temporary files are left behind.
+    EXPECT_EQ((set<string>{ "binary", "chunks", "text" }), directory_entries("writedir"));
+
+    // Errors
+    EXPECT_THROW(write_text_file("writedir/no_such_dir/file", "x"), FileException);
+    ASSERT_EQ(0, mkdir("writedir/dir", 0700));
+    try
+    {
+        write_text_file("writedir/dir", "x");
+        FAIL();
+    }
+    catch (FileException const& e)
+    {
+        EXPECT_EQ(EISDIR, e.error());
+    }
+    EXPECT_EQ((set<string>{ "binary", "chunks", "dir", "text" }), directory_entries("writedir"));
+
+    ASSERT_EQ(0, system("rm -rf writedir"));
+}
+
 TEST(FileIO, exceptions)
 {
     try
@@ -78,4 +340,7 @@ TEST(FileIO, exceptions)
     {
         EXPECT_EQ("unity::FileException: \"testdir\" is not a regular file (errno = 0)", e.to_string());
     }
+
+    EXPECT_THROW(map_file("no_such_file"), FileException);
+    EXPECT_THROW(map_file("testdir"), FileException);
 }
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <unity/UnityExceptions.h>
+#include <unity/util/IniGroup.h>
+#include <unity/util/IniParser.h>
+#include <unity-api-test-config.h>
+
+using namespace std;
+using namespace unity;
+using namespace unity::util;
+
+#define INI_FILE UNITY_API_TEST_DATADIR "/sample.ini"
+
+namespace
+{
+
+const IniParser::Engine engines[] = { IniParser::Engine::GKeyFile, IniParser::Engine::Native };
+
+}
+
+TEST(IniGroup, wholeGroup)
+{
+    for (auto engine : engines)
+    {
+        IniParser conf(INI_FILE, engine);
+        IniGroup first = conf.get_group("first");
+
+        EXPECT_EQ("first", first.name());
+        EXPECT_EQ(conf.get_keys("first"), first.get_keys());
+        EXPECT_TRUE(first.has_key("stringvalue"));
+        EXPECT_FALSE(first.has_key("missingvalue"));
+
+        EXPECT_EQ("hello", first.get_string("stringvalue"));
+        EXPECT_EQ(1, first.get_int("intvalue"));
+        EXPECT_EQ(2.345, first.get_double("doublevalue"));
+        EXPECT_TRUE(first.get_boolean("boolvalue"));
+        EXPECT_EQ("mundo", first.get_locale_string("locstring", "pt_BR"));
+        EXPECT_EQ("world", first.get_locale_string("locstring", "no_DF"));
+        EXPECT_EQ((vector<string>{"foo", "bar", "baz"}), first.get_string_array("array"));
+        EXPECT_EQ((vector<bool>{true, false, false}), first.get_boolean_array("boolarray"));
+        EXPECT_EQ((vector<string>{"x", "y", "z"}), first.get_locale_string_array("locstringarray", "pt_BR"));
+
+        IniGroup second = conf.get_group("second");
+        EXPECT_EQ((vector<int>{4, 5, 6, 78, 8, 9, 9, 345, 3}), second.get_int_array("intarray"));
+        EXPECT_EQ((vector<double>{4.5, 6.78, 9, 10.11}), second.get_double_array("doublearray"));
+
+        EXPECT_THROW(conf.get_group("nonexisting"), LogicException);
+    }
+}
+
+TEST(IniGroup, selectedKeys)
+{
+    for (auto engine : engines)
+    {
+        IniParser conf(INI_FILE, engine);
+        IniGroup first = conf.get_group("first", { "intvalue", "locstring", "missingvalue" });
+
+        EXPECT_EQ((vector<string>{"intvalue", "locstring", "locstring[en]", "locstring[pt_BR]"}), first.get_keys());
+        EXPECT_EQ(1, first.get_int("intvalue"));
+        EXPECT_EQ("mundo", first.get_locale_string("locstring", "pt_BR"));
+        EXPECT_FALSE(first.has_key("stringvalue"));
+    }
+}
+
+TEST(IniGroup, errors)
+{
+    for (auto engine : engines)
+    {
+        IniParser conf(INI_FILE, engine);
+        IniGroup first = conf.get_group("first");
+
+        try
+        {
+            first.get_string("missingvalue");
+            FAIL();
+        }
+        catch (const LogicException& e)
+        {
+            EXPECT_NE(string::npos, string(e.what()).find("unity::LogicException: Could not get string value"));
+            EXPECT_NE(string::npos, string(e.what()).find("group: first"));
+        }
+        EXPECT_THROW(first.get_int("doublevalue"), LogicException);
+        EXPECT_THROW(first.get_boolean("stringvalue"), LogicException);
+        EXPECT_THROW(first.get_int_array("array"), LogicException);
+
+        int i = 42;
+        EXPECT_FALSE(first.try_get_int("doublevalue", i));
+        EXPECT_FALSE(first.try_get_int("missingvalue", i));
+        EXPECT_EQ(42, i);
+        EXPECT_TRUE(first.try_get_int("intvalue", i));
+        EXPECT_EQ(1, i);
+
+        string s;
+        EXPECT_TRUE(first.try_get_locale_string("locstring", s, "pt_BR"));
+        EXPECT_EQ("mundo", s);
+        vector<bool> bools;
+        EXPECT_FALSE(first.try_get_boolean_array("array", bools));
+        EXPECT_TRUE(bools.empty());
+    }
+}
+
+TEST(IniGroup, isolatedFromParser)
+{
+    IniParser conf(INI_FILE);
+    IniGroup first = conf.get_group("first");
+
+    conf.set_string("first", "stringvalue", "changed");
+    conf.remove_group("first");
+
+    EXPECT_EQ("hello", first.get_string("stringvalue"));
+
+    IniGroup moved(move(first));
+    EXPECT_EQ("hello", moved.get_string("stringvalue"));
+}
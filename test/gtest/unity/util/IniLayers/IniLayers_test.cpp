@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+#include <unity/UnityExceptions.h>
+#include <unity/util/IniLayers.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace unity;
+using namespace unity::util;
+
+namespace
+{
+
+void write_file(const string& path, const string& text)
+{
+    // Replace the file, so a reload sees a new version even if the size and time stamp do not change.
+    string tmp = path + ".tmp";
+    auto f = fopen(tmp.c_str(), "w");
+    fputs(text.c_str(), f);
+    fclose(f);
+    rename(tmp.c_str(), path.c_str());
+}
+
+}
+
+TEST(IniLayers, precedence)
+{
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        IniParser::SPtr user(IniParser::from_data("[g]\na = user\nlist = x;y;\n[u]\nk = 1\n", engine));
+        IniParser::SPtr system(IniParser::from_data("[g]\na = system\nb = 2\n[s]\nk = true\n", engine));
+        IniLayers layers({ user, system });
+
+        EXPECT_EQ(2u, layers.size());
+        EXPECT_EQ(user, layers.layer(0));
+        EXPECT_THROW(layers.layer(2), InvalidArgumentException);
+
+        EXPECT_EQ("user", layers.get_string("g", "a"));
+        EXPECT_EQ(2, layers.get_int("g", "b"));
+        EXPECT_TRUE(layers.get_boolean("s", "k"));
+        EXPECT_EQ((vector<string>{ "x", "y" }), layers.get_string_array("g", "list"));
+        EXPECT_EQ(0, layers.layer_of("g", "a"));
+        EXPECT_EQ(1, layers.layer_of("g", "b"));
+        EXPECT_EQ(-1, layers.layer_of("g", "missing"));
+
+        EXPECT_EQ((vector<string>{ "g", "s", "u" }), layers.get_groups());
+        EXPECT_EQ((vector<string>{ "a", "b", "list" }), layers.get_keys("g"));
+        EXPECT_TRUE(layers.has_group("s"));
+        EXPECT_FALSE(layers.has_group("missing"));
+        EXPECT_TRUE(layers.has_key("u", "k"));
+        EXPECT_FALSE(layers.has_key("u", "missing"));
+
+        EXPECT_THROW(layers.get_string("missing", "a"), LogicException);
+        EXPECT_THROW(layers.get_int("g", "missing"), LogicException);
+        EXPECT_THROW(layers.get_int("g", "a"), LogicException);
+        EXPECT_THROW(layers.get_keys("missing"), LogicException);
+
+        int i = 5;
+        EXPECT_FALSE(layers.try_get_int("g", "a", i));
+        EXPECT_EQ(5, i);
+        EXPECT_TRUE(layers.try_get_int("u", "k", i));
+        EXPECT_EQ(1, i);
+        EXPECT_EQ(7, layers.get_int_or("g", "missing", 7));
+        EXPECT_EQ("dflt", layers.get_string_or("g", "missing", "dflt"));
+
+        // Direct changes to a layer are merged as they happen.
+        system->set_string("g", "a", "changed");
+        EXPECT_EQ("user", layers.get_string("g", "a"));
+        system->set_int("g", "c", 3);
+        EXPECT_EQ(3, layers.get_int("g", "c"));
+        system->remove_key("g", "b");
+        EXPECT_FALSE(layers.has_key("g", "b"));
+        user->remove_key("g", "a");
+        EXPECT_EQ("changed", layers.get_string("g", "a"));
+        EXPECT_EQ(1, layers.layer_of("g", "a"));
+        user->set_locale_string("g", "a", "Benutzer", "de");
+        EXPECT_EQ(0, layers.layer_of("g", "a[de]"));
+
+        user->set_int("s", "k", 4);
+        EXPECT_EQ(0, layers.layer_of("s", "k"));
+        user->remove_group("s");
+        EXPECT_TRUE(layers.get_boolean("s", "k"));
+        user->remove_group("u");
+        EXPECT_FALSE(layers.has_group("u"));
+
+        auto batch = system->batch();
+        batch.set_int("g", "d", 4);
+        batch.remove_group("s");
+        batch.commit();
+        EXPECT_EQ(4, layers.get_int("g", "d"));
+        EXPECT_FALSE(layers.has_group("s"));
+
+        // update() merges a whole layer again, which changes nothing here.
+        layers.update(1);
+        EXPECT_EQ("changed", layers.get_string("g", "a"));
+        EXPECT_EQ(4, layers.get_int("g", "d"));
+    }
+
+    EXPECT_THROW(IniLayers({ nullptr }), InvalidArgumentException);
+}
+
+TEST(IniLayers, locale)
+{
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        IniParser::SPtr user(IniParser::from_data("[g]\nName = mine\nList[fr] = u;v\n", engine));
+        IniParser::SPtr system(IniParser::from_data("[g]\n"
+                                                    "Name = Name\n"
+                                                    "Name[de] = Name de\n"
+                                                    "Title = Title\n"
+                                                    "Title[de] = Titel\n"
+                                                    "Title[de_DE] = Titel DE\n"
+                                                    "List = a;b\n"
+                                                    "List[de] = c;d\n",
+                                                    engine));
+        IniLayers layers({ user, system });
+
+        // The best translation in the first layer that has the key.
+        EXPECT_EQ("Titel DE", layers.get_locale_string("g", "Title", "de_DE.UTF-8"));
+        EXPECT_EQ("Titel", layers.get_locale_string("g", "Title", "de_AT"));
+        EXPECT_EQ("Title", layers.get_locale_string("g", "Title", "fr_FR"));
+        EXPECT_EQ("mine", layers.get_locale_string("g", "Name", "de_DE"));
+        EXPECT_EQ((vector<string>{ "c", "d" }), layers.get_locale_string_array("g", "List", "de"));
+        EXPECT_EQ((vector<string>{ "u", "v" }), layers.get_locale_string_array("g", "List", "fr_FR"));
+        EXPECT_EQ((vector<string>{ "a", "b" }), layers.get_locale_string_array("g", "List", "it"));
+
+        EXPECT_THROW(layers.get_locale_string("g", "missing", "de"), LogicException);
+        EXPECT_THROW(layers.get_locale_string("missing", "Name", "de"), LogicException);
+        EXPECT_THROW(layers.get_locale_string_array("g", "missing", "de"), LogicException);
+
+        string s = "unchanged";
+        vector<string> v;
+        EXPECT_FALSE(layers.try_get_locale_string("g", "missing", s, "de"));
+        EXPECT_FALSE(layers.try_get_locale_string_array("missing", "List", v, "de"));
+        EXPECT_EQ("unchanged", s);
+        EXPECT_TRUE(v.empty());
+        EXPECT_TRUE(layers.try_get_locale_string("g", "Title", s, "de"));
+        EXPECT_EQ("Titel", s);
+        EXPECT_TRUE(layers.try_get_locale_string_array("g", "List", v, "de"));
+        EXPECT_EQ((vector<string>{ "c", "d" }), v);
+        EXPECT_EQ("dflt", layers.get_locale_string_or("g", "missing", "dflt", "de"));
+        EXPECT_EQ("Titel", layers.get_locale_string_or("g", "Title", "dflt", "de"));
+
+        // A translation added to the first layer takes over for its locale only.
+        user->set_locale_string("g", "Title", "Benutzertitel", "de");
+        EXPECT_EQ("Benutzertitel", layers.get_locale_string("g", "Title", "de_DE"));
+        EXPECT_EQ("Title", layers.get_locale_string("g", "Title", "fr"));
+    }
+}
+
+TEST(IniLayers, xdg)
+{
+    string home = TEST_RUNTIME_PATH "/xdg_home";
+    string dir1 = TEST_RUNTIME_PATH "/xdg_dir1";
+    string dir2 = TEST_RUNTIME_PATH "/xdg_dir2";
+    for (auto const& d : { home, dir1, dir2 })
+    {
+        mkdir(d.c_str(), 0700);
+        remove((d + "/app.conf").c_str());
+    }
+    ASSERT_EQ(0, setenv("XDG_CONFIG_HOME", home.c_str(), 1));
+    ASSERT_EQ(0, setenv("XDG_CONFIG_DIRS", (dir1 + ":" + dir2).c_str(), 1));
+
+    write_file(home + "/app.conf", "[g]\na = home\n");
+    write_file(dir2 + "/app.conf", "[g]\na = dir2\nb = dir2\nc = dir2\n");
+
+    auto layers = IniLayers::from_xdg("app.conf");
+    ASSERT_EQ(2u, layers->size());
+    EXPECT_EQ("home", layers->get_string("g", "a"));
+    EXPECT_EQ("dir2", layers->get_string("g", "b"));
+
+    // A reload merges only the keys that changed in the reloaded layer.
+    EXPECT_FALSE(layers->reload());
+    write_file(dir2 + "/app.conf", "[g]\na = new\nb = new\nd = new\n");
+    write_file(home + "/app.conf", "[g]\nc = home\n");
+    EXPECT_TRUE(layers->reload());
+    EXPECT_EQ("new", layers->get_string("g", "a"));
+    EXPECT_EQ("new", layers->get_string("g", "b"));
+    EXPECT_EQ("home", layers->get_string("g", "c"));
+    EXPECT_EQ("new", layers->get_string("g", "d"));
+    EXPECT_EQ(0, layers->layer_of("g", "c"));
+
+    write_file(home + "/app.conf", "junk\n");
+    EXPECT_THROW(layers->reload(), FileException);
+    EXPECT_EQ("home", layers->get_string("g", "c"));
+
+    // Layers outlive the view.
+    auto layer = layers->layer(1);
+    layers.reset();
+    write_file(dir2 + "/app.conf", "[g]\na = later\n");
+    EXPECT_TRUE(layer->reload());
+
+    remove((home + "/app.conf").c_str());
+    remove((dir2 + "/app.conf").c_str());
+    EXPECT_EQ(0u, IniLayers::from_xdg("app.conf")->size());
+}
@@ -0,0 +1,900 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <unity/UnityExceptions.h>
+#include <unity/util/IniLayers.h>
+#include <unity/util/IniParser.h>
+#include <unity/util/IniSchema.h>
+#include <unity-api-test-config.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace unity::util;
+
+#define INI_FILE UNITY_API_TEST_DATADIR "/sample.ini"
+
+// Benchmarks are not run as part of "make test". Run the IniParser_bench
+// executable by hand to compare numbers before and after a change.
+
+namespace
+{
+
+const int reads_per_thread = 200000;
+
+// Runs reads_per_thread lookups on each of num_threads threads. Each thread
+// uses the parser returned by parser_for(thread_index). Returns the elapsed
+// wall clock time in milliseconds.
+template<typename ParserFor>
+double run_readers(int num_threads, ParserFor parser_for)
+{
+    atomic<bool> go(false);
+    vector<thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&go, &parser_for, t]
+        {
+            IniParser& conf = parser_for(t);
+            while (!go)
+            {
+                this_thread::yield();
+            }
+            for (int i = 0; i < reads_per_thread; ++i)
+            {
+                conf.get_int("first", "intvalue");
+                conf.get_string("second", "stringvalue");
+            }
+        });
+    }
+
+    auto start = chrono::steady_clock::now();
+    go = true;
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end - start).count();
+}
+
+void report(char const* scenario, int num_threads, double ms)
+{
+    double ops = 2.0 * reads_per_thread * num_threads;
+    cout << setw(28) << left << scenario
+         << " threads: " << setw(3) << num_threads
+         << " time: " << setw(10) << fixed << setprecision(1) << ms << " ms"
+         << " throughput: " << setprecision(2) << ops / ms / 1000.0 << " Mops/s" << endl;
+}
+
+vector<int> thread_counts()
+{
+    vector<int> counts;
+    int max_threads = max(1u, thread::hardware_concurrency());
+    for (int n = 1; n < max_threads; n *= 2)
+    {
+        counts.push_back(n);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+} // namespace
+
+TEST(IniParserBench, shared_parser_reads)
+{
+    IniParser conf(INI_FILE);
+    for (int n : thread_counts())
+    {
+        double ms = run_readers(n, [&conf](int) -> IniParser& { return conf; });
+        report("one shared parser", n, ms);
+    }
+}
+
+TEST(IniParserBench, separate_parser_reads)
+{
+    for (int n : thread_counts())
+    {
+        vector<IniParser::UPtr> parsers;
+        for (int t = 0; t < n; ++t)
+        {
+            parsers.emplace_back(new IniParser(INI_FILE));
+        }
+        double ms = run_readers(n, [&parsers](int t) -> IniParser& { return *parsers[t]; });
+        report("one parser per thread", n, ms);
+    }
+}
+
+TEST(IniParserBench, load)
+{
+    const int loads = 20000;
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < loads; ++i)
+        {
+            IniParser conf(INI_FILE, engine);
+            conf.get_string("first", "stringvalue");
+            conf.get_locale_string("first", "locstring", "pt_BR");
+        }
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count();
+        cout << setw(28) << left << (engine == IniParser::Engine::Native ? "load, native engine" : "load, GKeyFile engine")
+             << " loads: " << loads
+             << " time: " << fixed << setprecision(1) << ms << " ms"
+             << " per load: " << setprecision(2) << ms * 1000.0 / loads << " us" << endl;
+    }
+}
+
+TEST(IniParserBench, key_handle_reads)
+{
+    // Keys of the shape used by .desktop files, so the names are not trivially short.
+    const int lookups = 2000000;
+    string text = "[Desktop Entry]\n";
+    for (auto k : { "Type", "Version", "Name", "GenericName", "Comment", "Icon", "Exec", "TryExec", "Terminal",
+                    "Categories", "Keywords", "MimeType", "StartupNotify", "NoDisplay", "Hidden" })
+    {
+        text += string(k) + "=some value for " + k + "\n";
+    }
+    auto conf = IniParser::from_data(text, IniParser::Engine::Native);
+
+    const string group = "Desktop Entry";
+    const string key = "StartupNotify";
+    const IniKey handle(group, key);
+
+    auto time = [&](char const* scenario, function<void()> lookup)
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < lookups; ++i)
+        {
+            lookup();
+        }
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count();
+        cout << setw(28) << left << scenario
+             << " lookups: " << lookups
+             << " time: " << fixed << setprecision(1) << ms << " ms"
+             << " per lookup: " << setprecision(1) << ms * 1000000.0 / lookups << " ns" << endl;
+    };
+
+    string value;
+    time("get_string(group, key)", [&] { value = conf->get_string(group, key); });
+    time("get_string(IniKey)", [&] { value = conf->get_string(handle); });
+    time("try_get_string(group, key)", [&] { conf->try_get_string(group, key, value); });
+    time("try_get_string(IniKey)", [&] { conf->try_get_string(handle, value); });
+}
+
+TEST(IniParserBench, load_all)
+{
+    // A synthetic applications directory: 5,000 desktop files of typical size, with translations.
+    const int num_files = 5000;
+    char dir_template[] = "/tmp/IniParser_bench.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    const string dir = dir_template;
+    for (int i = 0; i < num_files; ++i)
+    {
+        string text = "[Desktop Entry]\nType=Application\nVersion=1.0\n";
+        text += "Name=Application " + to_string(i) + "\n";
+        for (auto lang : { "de", "es", "fr", "it", "ja", "pt_BR", "ru", "zh_CN" })
+        {
+            text += "Name[" + string(lang) + "]=Application " + to_string(i) + " (" + lang + ")\n";
+            text += "Comment[" + string(lang) + "]=Does useful things, number " + to_string(i) + "\n";
+        }
+        text += "Exec=app" + to_string(i) + " %U\nIcon=app" + to_string(i) + "\nTerminal=false\n";
+        text += "Categories=Utility;Development;\nMimeType=text/plain;text/x-c++src;\nStartupNotify=true\n";
+        text += "\n[Desktop Action new-window]\nName=New Window\nExec=app" + to_string(i) + " --new-window\n";
+        string path = dir + "/app" + to_string(i) + ".desktop";
+        auto f = fopen(path.c_str(), "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+    }
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        double single_ms = 0;
+        for (int n : thread_counts())
+        {
+            auto start = chrono::steady_clock::now();
+            auto result = IniParser::load_all({ dir }, ".desktop", engine, n);
+            auto end = chrono::steady_clock::now();
+            EXPECT_EQ(size_t(num_files), result.parsers.size());
+            double ms = chrono::duration<double, milli>(end - start).count();
+            if (n == 1)
+            {
+                single_ms = ms;
+            }
+            cout << setw(28) << left
+                 << (engine == IniParser::Engine::Native ? "load_all, native engine" : "load_all, GKeyFile engine")
+                 << " threads: " << setw(3) << n
+                 << " time: " << setw(10) << fixed << setprecision(1) << ms << " ms"
+                 << " speedup: " << setprecision(2) << single_ms / ms << endl;
+        }
+    }
+
+    for (int i = 0; i < num_files; ++i)
+    {
+        unlink((dir + "/app" + to_string(i) + ".desktop").c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+TEST(IniParserBench, cached_load)
+{
+    char dir_template[] = "/tmp/IniParser_cache.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    const string dir = dir_template;
+
+    // A small and a large file.
+    string large = dir + "/large.ini";
+    {
+        auto f = fopen(large.c_str(), "w");
+        for (int g = 0; g < 100; ++g)
+        {
+            fprintf(f, "[group %d]\n", g);
+            for (int k = 0; k < 200; ++k)
+            {
+                fprintf(f, "key%d = some value for key %d in group %d\n", k, k, g);
+            }
+        }
+        fclose(f);
+    }
+
+    for (auto const& file : { string(INI_FILE), large })
+    {
+        const int loads = file == large ? 200 : 20000;
+        for (int cached = 0; cached < 2; ++cached)
+        {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < loads; ++i)
+            {
+                if (cached)
+                {
+                    IniParser conf(file.c_str(), dir + "/cache");
+                }
+                else
+                {
+                    IniParser conf(file.c_str(), IniParser::Engine::Native);
+                }
+            }
+            auto end = chrono::steady_clock::now();
+            double ms = chrono::duration<double, milli>(end - start).count();
+            string scenario = string(file == large ? "large" : "small") + (cached ? ", compiled cache" : ", native engine");
+            cout << setw(28) << left << scenario
+                 << " loads: " << loads
+                 << " time: " << fixed << setprecision(1) << ms << " ms"
+                 << " per load: " << setprecision(2) << ms * 1000.0 / loads << " us" << endl;
+        }
+    }
+
+    string cmd = "rm -rf " + dir;
+    EXPECT_EQ(0, system(cmd.c_str()));
+}
+
+TEST(IniParserBench, locale_lookups)
+{
+    // A desktop file with the usual set of translations, as seen by an app drawer.
+    const int lookups = 500000;
+    string text = "[Desktop Entry]\nType=Application\nName=Editor\n";
+    for (auto lang : { "ar", "ca", "de", "es", "fr", "it", "ja", "ko", "nl", "pl", "pt", "pt_BR", "ru", "sv", "zh_CN" })
+    {
+        text += "Name[" + string(lang) + "]=Editor (" + lang + ")\n";
+    }
+
+    const string locale_name = "pt_BR.UTF-8";
+    const IniLocale locale(locale_name);
+    const IniKey name("Desktop Entry", "Name");
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        auto conf = IniParser::from_data(text, engine);
+        auto time = [&](char const* scenario, function<void()> lookup)
+        {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < lookups; ++i)
+            {
+                lookup();
+            }
+            auto end = chrono::steady_clock::now();
+            double ms = chrono::duration<double, milli>(end - start).count();
+            cout << setw(10) << left << (engine == IniParser::Engine::Native ? "native" : "GKeyFile")
+                 << setw(38) << scenario
+                 << " time: " << fixed << setprecision(1) << ms << " ms"
+                 << " per lookup: " << setprecision(1) << ms * 1000000.0 / lookups << " ns" << endl;
+        };
+
+        string value;
+        time("get_locale_string(locale name)", [&] { value = conf->get_locale_string("Desktop Entry", "Name", locale_name); });
+        time("get_locale_string(IniLocale)", [&] { value = conf->get_locale_string("Desktop Entry", "Name", locale); });
+        time("get_locale_string(IniKey, IniLocale)", [&] { value = conf->get_locale_string(name, locale); });
+    }
+}
+
+TEST(IniParserBench, array_reads)
+{
+    const int reads = 500000;
+    auto conf = IniParser::from_data("[g]\nints = 1;2;3;4;5;6;7;8;9;10;11;12;\n"
+                                     "doubles = 0.5;1.5;2.5;3.5;4.5;5.5;6.5;7.5;\n",
+                                     IniParser::Engine::Native);
+    auto time = [&](char const* scenario, function<void()> read)
+    {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < reads; ++i)
+        {
+            read();
+        }
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count();
+        cout << setw(34) << left << scenario
+             << " time: " << fixed << setprecision(1) << ms << " ms"
+             << " per read: " << setprecision(1) << ms * 1000000.0 / reads << " ns" << endl;
+    };
+
+    int ints[16];
+    double doubles[16];
+    size_t n = 0;
+    time("get_int_array() -> vector", [&] { n += conf->get_int_array("g", "ints").size(); });
+    time("get_int_array(buf, size)", [&] { n += conf->get_int_array("g", "ints", ints, 16); });
+    time("get_double_array() -> vector", [&] { n += conf->get_double_array("g", "doubles").size(); });
+    time("get_double_array(buf, size)", [&] { n += conf->get_double_array("g", "doubles", doubles, 16); });
+    EXPECT_NE(0u, n);
+}
+
+TEST(IniParserBench, batch_writes)
+{
+    // Saving the state of a window or similar: 20 keys of one group at a time, while
+    // other threads read from the same parser.
+    const int saves = 20000;
+    const int keys = 20;
+    vector<string> names;
+    for (int k = 0; k < keys; ++k)
+    {
+        names.push_back("key" + to_string(k));
+    }
+
+    for (int readers : { 0, 3 })
+    {
+        auto conf = IniParser::from_data("[state]\nkey0 = 0\n");
+        atomic<bool> done(false);
+        vector<thread> threads;
+        for (int t = 0; t < readers; ++t)
+        {
+            threads.emplace_back([&conf, &done]
+            {
+                int value;
+                while (!done)
+                {
+                    conf->try_get_int("state", "key0", value);
+                }
+            });
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < saves; ++i)
+        {
+            for (auto const& name : names)
+            {
+                conf->set_int("state", name, i);
+            }
+        }
+        auto mid = chrono::steady_clock::now();
+        auto batch = conf->batch();
+        for (int i = 0; i < saves; ++i)
+        {
+            for (auto const& name : names)
+            {
+                batch.set_int("state", name, i);
+            }
+            batch.commit();
+        }
+        auto end = chrono::steady_clock::now();
+
+        done = true;
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        for (int b = 0; b < 2; ++b)
+        {
+            double ms = chrono::duration<double, milli>(b ? end - mid : mid - start).count();
+            cout << setw(28) << left << (b ? "one batch per save" : "one set_int() per key")
+                 << " readers: " << readers
+                 << " time: " << fixed << setprecision(1) << ms << " ms"
+                 << " per save: " << setprecision(2) << ms * 1000.0 / saves << " us" << endl;
+        }
+    }
+}
+
+TEST(IniParserBench, visit_large)
+{
+    // A generated file with 400,000 keys. visit() runs first, so that the growth of the
+    // peak resident set size shows how much memory each approach needs.
+    char path[] = "/tmp/IniParser_visit.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    {
+        auto f = fdopen(fd, "w");
+        for (int g = 0; g < 400; ++g)
+        {
+            fprintf(f, "[group %d]\n", g);
+            for (int k = 0; k < 1000; ++k)
+            {
+                fprintf(f, "key%d = some value for key %d in group %d\n", k, k, g);
+            }
+        }
+        fclose(f);
+    }
+
+    struct CountingVisitor : public IniVisitor
+    {
+        size_t keys = 0;
+        bool key_value(const string&, const string&, const string&) override
+        {
+            ++keys;
+            return true;
+        }
+    };
+
+    auto max_rss_kb = []
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    };
+    auto report = [](char const* scenario, double ms, long rss_growth_kb)
+    {
+        cout << setw(28) << left << scenario
+             << " time: " << setw(8) << fixed << setprecision(1) << ms << " ms"
+             << " peak RSS growth: " << rss_growth_kb << " KiB" << endl;
+    };
+
+    long rss = max_rss_kb();
+    auto start = chrono::steady_clock::now();
+    CountingVisitor v;
+    IniParser::visit(path, v);
+    auto end = chrono::steady_clock::now();
+    EXPECT_EQ(400000u, v.keys);
+    report("visit()", chrono::duration<double, milli>(end - start).count(), max_rss_kb() - rss);
+
+    for (auto engine : { IniParser::Engine::Native, IniParser::Engine::GKeyFile })
+    {
+        rss = max_rss_kb();
+        start = chrono::steady_clock::now();
+        {
+            IniParser conf(path, engine);
+            EXPECT_EQ(1000u, conf.get_keys("group 0").size());
+        }
+        end = chrono::steady_clock::now();
+        report(engine == IniParser::Engine::Native ? "load, native engine" : "load, GKeyFile engine",
+               chrono::duration<double, milli>(end - start).count(), max_rss_kb() - rss);
+    }
+
+    unlink(path);
+}
+
+TEST(IniParserBench, snapshot_reads)
+{
+    // A reader that must not stall (an input thread, say) while another thread keeps
+    // changing and saving a config of 5,000 keys. Compares the latency of reads that
+    // take the lock with reads from snapshot().
+    char path[] = "/tmp/IniParser_snapshot.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    {
+        auto f = fdopen(fd, "w");
+        for (int g = 0; g < 50; ++g)
+        {
+            fprintf(f, "[group %d]\n", g);
+            for (int k = 0; k < 100; ++k)
+            {
+                fprintf(f, "key%d = %d\n", k, k);
+            }
+        }
+        fclose(f);
+    }
+
+    const int reads = 200000;
+    for (int use_snapshots : { 0, 1 })
+    {
+        IniParser conf(path);
+        if (use_snapshots)
+        {
+            conf.snapshot();
+        }
+
+        atomic<bool> done(false);
+        thread writer([&conf, &done]
+        {
+            for (int i = 0; !done; ++i)
+            {
+                conf.set_int("group 0", "key0", i);
+                conf.sync();
+            }
+        });
+
+        vector<double> latencies;
+        latencies.reserve(reads);
+        int value;
+        for (int i = 0; i < reads; ++i)
+        {
+            auto start = chrono::steady_clock::now();
+            if (use_snapshots)
+            {
+                conf.snapshot()->try_get_int("group 49", "key99", value);
+            }
+            else
+            {
+                conf.try_get_int("group 49", "key99", value);
+            }
+            latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        }
+        done = true;
+        writer.join();
+
+        sort(latencies.begin(), latencies.end());
+        cout << setw(28) << left << (use_snapshots ? "snapshot() reads" : "locked reads")
+             << fixed << setprecision(2)
+             << " p50: " << latencies[reads / 2] << " us"
+             << " p99: " << latencies[reads * 99 / 100] << " us"
+             << " p99.9: " << latencies[reads * 999 / 1000] << " us"
+             << " max: " << latencies.back() << " us" << endl;
+    }
+    unlink(path);
+}
+
+TEST(IniParserBench, layered_lookups)
+{
+    // Three layers (user, site, vendor defaults) with 200 keys each. The user layer sets
+    // 10 of them, the site layer 50, the defaults all of them. Resolves every key by
+    // trying each layer in turn and catching the exception for a miss, and with IniLayers.
+    vector<IniParser::SPtr> parsers;
+    for (int keys : { 10, 50, 200 })
+    {
+        string text = "[settings]\n";
+        for (int k = 0; k < keys; ++k)
+        {
+            text += "key" + to_string(k * 200 / keys) + " = " + to_string(k) + "\n";
+        }
+        parsers.emplace_back(IniParser::from_data(text, IniParser::Engine::Native));
+    }
+    vector<string> names;
+    for (int k = 0; k < 200; ++k)
+    {
+        names.push_back("key" + to_string(k));
+    }
+
+    const int rounds = 200;
+    long sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (auto const& name : names)
+        {
+            for (auto const& parser : parsers)
+            {
+                try
+                {
+                    sum += parser->get_int("settings", name);
+                    break;
+                }
+                catch (unity::LogicException const&)
+                {
+                }
+            }
+        }
+    }
+    auto mid = chrono::steady_clock::now();
+    IniLayers layers(parsers);
+    auto built = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (auto const& name : names)
+        {
+            sum += layers.get_int("settings", name);
+        }
+    }
+    auto end = chrono::steady_clock::now();
+
+    double lookups = double(rounds) * names.size();
+    auto report = [lookups](char const* scenario, chrono::steady_clock::duration d)
+    {
+        double ms = chrono::duration<double, milli>(d).count();
+        cout << setw(28) << left << scenario
+             << " time: " << setw(8) << fixed << setprecision(1) << ms << " ms"
+             << " per lookup: " << setprecision(3) << ms * 1000.0 / lookups << " us" << endl;
+    };
+    report("fallback chain", mid - start);
+    report("IniLayers", end - built);
+    cout << "IniLayers construction: " << setprecision(3)
+         << chrono::duration<double, milli>(built - mid).count() << " ms (checksum " << sum << ")" << endl;
+}
+
+TEST(IniParserBench, lazy_groups)
+{
+    // A .desktop file with 20 actions, each with 50 translations of its name, and 50
+    // translations of the name, comment, and keywords of the main group. The consumer
+    // reads three keys of "Desktop Entry". Loads 1000 parsers and keeps them, so the
+    // growth of the heap shows what each engine keeps per file.
+    string text = "[Desktop Entry]\nType=Application\nExec=app %U\nIcon=app\n";
+    for (char const* key : { "Name", "Comment", "Keywords" })
+    {
+        text += string(key) + "=Some text for " + key + "\n";
+        for (int l = 0; l < 50; ++l)
+        {
+            text += string(key) + "[l" + to_string(l) + "]=Translated text " + to_string(l) + "\n";
+        }
+    }
+    for (int a = 0; a < 20; ++a)
+    {
+        text += "\n[Desktop Action action" + to_string(a) + "]\nExec=app --action " + to_string(a) + "\nName=Action\n";
+        for (int l = 0; l < 50; ++l)
+        {
+            text += "Name[l" + to_string(l) + "]=Translated action " + to_string(l) + "\n";
+        }
+    }
+
+    const int files = 1000;
+    for (auto engine : { IniParser::Engine::Native, IniParser::Engine::Lazy })
+    {
+        vector<IniParser::UPtr> parsers;
+        parsers.reserve(files);
+        size_t heap_before = mallinfo2().uordblks;
+        auto start = chrono::steady_clock::now();
+        size_t sum = 0;
+        for (int f = 0; f < files; ++f)
+        {
+            parsers.push_back(IniParser::from_data(text, engine));
+            sum += parsers.back()->get_string("Desktop Entry", "Exec").size();
+            sum += parsers.back()->get_string("Desktop Entry", "Icon").size();
+            sum += parsers.back()->get_locale_string("Desktop Entry", "Name", "l7").size();
+        }
+        auto end = chrono::steady_clock::now();
+        size_t heap_after = mallinfo2().uordblks;
+
+        double ms = chrono::duration<double, milli>(end - start).count();
+        cout << setw(28) << left << (engine == IniParser::Engine::Lazy ? "lazy" : "native")
+             << " per file: " << fixed << setprecision(2) << ms * 1000.0 / files << " us"
+             << " heap per file: " << (heap_after - heap_before - text.size() * files) / files
+             << " bytes + text (checksum " << sum << ")" << endl;
+    }
+}
+
+TEST(IniParserBench, shared_names)
+{
+    // Resident set size of 3,000 desktop files loaded with load_all() and kept, with and
+    // without shared names. Each file has Name, GenericName, Comment, and Keywords in
+    // 40 languages, like the desktop files of a typical desktop installation. Set
+    // INI_BENCH_APPLICATIONS to a directory of real desktop files to measure those too.
+    const int num_files = 3000;
+    char dir_template[] = "/tmp/IniParser_names.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    const string dir = dir_template;
+    const char* langs[] = { "af", "ar", "ast", "be", "bg", "bn", "ca", "cs", "da", "de", "el", "en_GB", "eo",
+                            "es", "et", "eu", "fa", "fi", "fr", "ga", "gl", "he", "hi", "hr", "hu", "id", "it",
+                            "ja", "ko", "lt", "nb", "nl", "pl", "pt", "pt_BR", "ro", "ru", "sv", "uk", "zh_CN" };
+    for (int i = 0; i < num_files; ++i)
+    {
+        string text = "[Desktop Entry]\nType=Application\nVersion=1.0\n";
+        for (auto key : { "Name", "GenericName", "Comment", "Keywords" })
+        {
+            text += string(key) + "=" + key + " of application " + to_string(i) + "\n";
+            for (auto lang : langs)
+            {
+                text += string(key) + "[" + lang + "]=" + key + " " + to_string(i) + " " + lang + "\n";
+            }
+        }
+        text += "Exec=app" + to_string(i) + " %U\nIcon=app" + to_string(i) + "\nTerminal=false\n";
+        text += "Categories=Utility;Development;\nMimeType=text/plain;\nStartupNotify=true\n";
+        text += "\n[Desktop Action new-window]\nName=New Window\nExec=app" + to_string(i) + " --new-window\n";
+        string path = dir + "/app" + to_string(i) + ".desktop";
+        auto f = fopen(path.c_str(), "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+    }
+
+    auto resident_kb = []
+    {
+        long size = 0;
+        long pages = 0;
+        auto f = fopen("/proc/self/statm", "r");
+        if (f)
+        {
+            if (fscanf(f, "%ld %ld", &size, &pages) != 2)
+            {
+                pages = 0;
+            }
+            fclose(f);
+        }
+        return pages * sysconf(_SC_PAGESIZE) / 1024;
+    };
+
+    // Each measurement runs in a child process, so memory that one run returns to the
+    // allocator does not hide the growth of the next.
+    auto measure = [&resident_kb](const string& corpus, bool share)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            return;
+        }
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            IniParser::share_names(share);
+            long before = resident_kb();
+            auto start = chrono::steady_clock::now();
+            auto result = IniParser::load_all({ corpus }, ".desktop", IniParser::Engine::Native, 1);
+            auto end = chrono::steady_clock::now();
+            long growth = resident_kb() - before;
+            auto names = IniParser::shared_name_stats();
+            char line[256];
+            int n = snprintf(line, sizeof(line), "files: %zu RSS growth: %ld KiB load: %.1f ms shared names: %zu (%zu bytes)",
+                             result.parsers.size(), growth,
+                             chrono::duration<double, milli>(end - start).count(), names.names, names.bytes);
+            if (write(fds[1], line, n) != n)
+            {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        char line[256] = {};
+        if (read(fds[0], line, sizeof(line) - 1) < 0)
+        {
+            line[0] = '\0';
+        }
+        close(fds[0]);
+        waitpid(pid, nullptr, 0);
+        cout << setw(28) << left << (share ? "native, shared names" : "native") << " " << line << endl;
+    };
+
+    cout << "Generated corpus:" << endl;
+    measure(dir, false);
+    measure(dir, true);
+    char const* real = getenv("INI_BENCH_APPLICATIONS");
+    if (real)
+    {
+        cout << real << ":" << endl;
+        measure(real, false);
+        measure(real, true);
+    }
+
+    for (int i = 0; i < num_files; ++i)
+    {
+        unlink((dir + "/app" + to_string(i) + ".desktop").c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+TEST(IniParserBench, schema_reads)
+{
+    // Reads four typed settings of a service config over and over, by name and through an IniSchema.
+    UNITY_INI_KEY(Port, int, "Server", "Port");
+    UNITY_INI_KEY(Host, string, "Server", "Host");
+    UNITY_INI_KEY(Verbose, bool, "Logging", "Verbose");
+    UNITY_INI_KEY(Timeout, double, "Server", "Timeout");
+    typedef IniSchema<Port, Host, Verbose, Timeout> ServerConfig;
+
+    string text = "[Server]\n";
+    for (int k = 0; k < 50; ++k)
+    {
+        text += "Option" + to_string(k) + " = " + to_string(k) + "\n";
+    }
+    text += "Port = 8080\nHost = localhost\nTimeout = 2.5\n[Logging]\nVerbose = true\n";
+    auto conf = IniParser::from_data(text, IniParser::Engine::Native);
+
+    const int rounds = 500000;
+    long sum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        sum += conf->get_int("Server", "Port");
+        sum += conf->get_string("Server", "Host").size();
+        sum += conf->get_boolean("Logging", "Verbose");
+        sum += long(conf->get_double("Server", "Timeout"));
+    }
+    auto mid = chrono::steady_clock::now();
+    ServerConfig config(*conf);
+    auto bound = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        sum += config.get<Port>();
+        sum += config.get<Host>().size();
+        sum += config.get<Verbose>();
+        sum += long(config.get<Timeout>());
+    }
+    auto end = chrono::steady_clock::now();
+
+    double lookups = double(rounds) * ServerConfig::size();
+    auto report = [lookups](char const* scenario, chrono::steady_clock::duration d)
+    {
+        double ms = chrono::duration<double, milli>(d).count();
+        cout << setw(28) << left << scenario
+             << " time: " << setw(8) << fixed << setprecision(1) << ms << " ms"
+             << " per lookup: " << setprecision(1) << ms * 1000000.0 / lookups << " ns" << endl;
+    };
+    report("get_*(group, key)", mid - start);
+    report("IniSchema::get<Key>()", end - bound);
+    cout << "IniSchema::bind(): " << setprecision(3)
+         << chrono::duration<double, micro>(bound - mid).count() << " us (checksum " << sum << ")" << endl;
+}
+
+TEST(IniParserBench, key_enumeration)
+{
+    // Counts the X-* extension keys of 2000 desktop-style files, with get_keys() and with for_each_key().
+    vector<IniParser::UPtr> files;
+    for (int f = 0; f < 2000; ++f)
+    {
+        string text = "[Desktop Entry]\nType=Application\nName=App " + to_string(f) + "\nExec=app\n";
+        for (int k = 0; k < 20; ++k)
+        {
+            text += (k % 4 == 0 ? "X-Vendor-Option" : "Option") + to_string(k) + "=value\n";
+        }
+        files.emplace_back(IniParser::from_data(text, IniParser::Engine::Native));
+    }
+
+    const int rounds = 50;
+    long count = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (auto const& conf : files)
+        {
+            for (auto const& key : conf->get_keys("Desktop Entry"))
+            {
+                count += key.compare(0, 2, "X-") == 0;
+            }
+        }
+    }
+    auto mid = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (auto const& conf : files)
+        {
+            conf->for_each_key("Desktop Entry", [&count](const char* name, size_t size)
+            {
+                count += size >= 2 && name[0] == 'X' && name[1] == '-';
+                return true;
+            });
+        }
+    }
+    auto end = chrono::steady_clock::now();
+
+    double files_read = double(rounds) * files.size();
+    auto report = [files_read](char const* scenario, chrono::steady_clock::duration d)
+    {
+        double ms = chrono::duration<double, milli>(d).count();
+        cout << setw(28) << left << scenario
+             << " time: " << setw(8) << fixed << setprecision(1) << ms << " ms"
+             << " per file: " << setprecision(1) << ms * 1000000.0 / files_read << " ns" << endl;
+    };
+    report("get_keys()", mid - start);
+    report("for_each_key()", end - mid);
+    cout << "checksum " << count << endl;
+}
@@ -18,9 +18,19 @@
 
 #include <gtest/gtest.h>
 #include <unity/UnityExceptions.h>
+#include <unity/util/FileIO.h>
 #include <unity/util/IniParser.h>
 #include <unity-api-test-config.h>
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 using namespace std;
 using namespace unity;
 using namespace unity::util;
@@ -410,3 +420,1289 @@ TEST(IniParser, writeError)
     // Sync (exception as target is a directory)
     EXPECT_THROW(conf.sync(), FileException);
 }
+
+TEST(IniParser, nativeEngineMatchesGKeyFile)
+{
+    IniParser gkf(INI_FILE, IniParser::Engine::GKeyFile);
+    IniParser native(INI_FILE, IniParser::Engine::Native);
+
+    EXPECT_EQ(gkf.get_start_group(), native.get_start_group());
+    EXPECT_EQ(gkf.get_groups(), native.get_groups());
+    for (auto const& group : gkf.get_groups())
+    {
+        EXPECT_TRUE(native.has_group(group));
+        EXPECT_EQ(gkf.get_keys(group), native.get_keys(group));
+    }
+    EXPECT_FALSE(native.has_group("nonexisting"));
+    EXPECT_FALSE(native.has_key("first", "missingvalue"));
+    EXPECT_THROW(native.has_key("nonexisting", "stringvalue"), LogicException);
+
+    EXPECT_EQ(gkf.get_string("first", "stringvalue"), native.get_string("first", "stringvalue"));
+    EXPECT_EQ(gkf.get_int("first", "intvalue"), native.get_int("first", "intvalue"));
+    EXPECT_EQ(gkf.get_double("first", "intvalue"), native.get_double("first", "intvalue"));
+    EXPECT_EQ(gkf.get_double("first", "doublevalue"), native.get_double("first", "doublevalue"));
+    EXPECT_EQ(gkf.get_boolean("first", "boolvalue"), native.get_boolean("first", "boolvalue"));
+    EXPECT_EQ(gkf.get_boolean("second", "boolvalue"), native.get_boolean("second", "boolvalue"));
+
+    EXPECT_EQ("world", native.get_locale_string("first", "locstring", "en"));
+    EXPECT_EQ("mundo", native.get_locale_string("first", "locstring", "pt_BR"));
+    EXPECT_EQ("mundo", native.get_locale_string("first", "locstring", "pt_BR.UTF-8"));
+    EXPECT_EQ("world", native.get_locale_string("first", "locstring", "no_DF"));
+
+    EXPECT_EQ(gkf.get_string_array("first", "array"), native.get_string_array("first", "array"));
+    EXPECT_EQ(gkf.get_boolean_array("first", "boolarray"), native.get_boolean_array("first", "boolarray"));
+    EXPECT_EQ(gkf.get_int_array("second", "intarray"), native.get_int_array("second", "intarray"));
+    EXPECT_EQ(gkf.get_double_array("second", "intarray"), native.get_double_array("second", "intarray"));
+    EXPECT_EQ(gkf.get_double_array("second", "doublearray"), native.get_double_array("second", "doublearray"));
+    EXPECT_EQ(gkf.get_locale_string_array("first", "locstringarray", "pt_BR"),
+              native.get_locale_string_array("first", "locstringarray", "pt_BR"));
+
+    try
+    {
+        native.get_string("foo", "bar");
+        FAIL();
+    }
+    catch (const LogicException& e)
+    {
+        EXPECT_NE(string::npos, string(e.what()).find("unity::LogicException: Could not get string value"));
+        EXPECT_NE(string::npos, string(e.what()).find("group: foo"));
+    }
+    EXPECT_THROW(native.get_string("first", "missingvalue"), LogicException);
+    EXPECT_THROW(native.get_int("first", "doublevalue"), LogicException);
+    EXPECT_THROW(native.get_boolean("first", "stringvalue"), LogicException);
+    EXPECT_THROW(native.get_double("first", "stringvalue"), LogicException);
+    EXPECT_THROW(native.get_int_array("first", "array"), LogicException);
+    EXPECT_THROW(native.get_int_array("second", "doublearray"), LogicException);
+    EXPECT_THROW(native.get_boolean_array("first", "array"), LogicException);
+}
+
+TEST(IniParser, nativeEngineSyntax)
+{
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("# leading comment\n"
+              "[g1]\r\n"
+              "  spaced  =   value with trailing space \n"
+              "escaped = a\\sb\\tc\\nd\\\\e\n"
+              "list = a\\;b;;c;\n"
+              "dup = 1\n"
+              "[g2]\n"
+              "k = v\n"
+              "[g1]\n"
+              "dup = 2\n"
+              "bad = \\x\n",
+              f);
+        fclose(f);
+    }
+
+    IniParser conf(INI_TEMP_FILE, IniParser::Engine::Native);
+
+    EXPECT_EQ((vector<string>{"g1", "g2"}), conf.get_groups());
+    EXPECT_EQ("value with trailing space ", conf.get_string("g1", "spaced"));
+    EXPECT_EQ("a b\tc\nd\\e", conf.get_string("g1", "escaped"));
+    EXPECT_EQ((vector<string>{"a;b", "", "c"}), conf.get_string_array("g1", "list"));
+    EXPECT_EQ(2, conf.get_int("g1", "dup"));
+    EXPECT_EQ("v", conf.get_string("g2", "k"));
+    EXPECT_THROW(conf.get_string("g1", "bad"), LogicException);
+
+    for (auto const& text : { "key = value\n", "[g1]\nnot a key value pair\n", "[g1\n", "[g1]\n=value\n" })
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs(text, f);
+        fclose(f);
+        EXPECT_THROW(IniParser(INI_TEMP_FILE, IniParser::Engine::Native), FileException) << text;
+    }
+
+    EXPECT_THROW(IniParser("nonexistant", IniParser::Engine::Native), FileException);
+}
+
+TEST(IniParser, lazyEngine)
+{
+    IniParser native(INI_FILE, IniParser::Engine::Native);
+    IniParser lazy(INI_FILE, IniParser::Engine::Lazy);
+    EXPECT_EQ(native.get_start_group(), lazy.get_start_group());
+    EXPECT_EQ(native.get_groups(), lazy.get_groups());
+    for (auto const& group : native.get_groups())
+    {
+        EXPECT_EQ(native.get_keys(group), lazy.get_keys(group));
+        for (auto const& key : native.get_keys(group))
+        {
+            EXPECT_EQ(native.get_string_or(group, key, "?"), lazy.get_string_or(group, key, "?")) << key;
+        }
+    }
+    EXPECT_EQ("mundo", lazy.get_locale_string("first", "locstring", "pt_BR"));
+
+    const string text = "# comment\n"
+                        "[Desktop Entry]\n"
+                        "Name = App\n"
+                        "Name[de] = Anwendung\n"
+                        "\n"
+                        "[Desktop Action new]\n"
+                        "Name = New\n"
+                        "this line is invalid\n"
+                        "  [Desktop Entry]  \r\n"
+                        "Exec = app\n"
+                        "Name = Last\n";
+    auto conf = IniParser::from_data(text, IniParser::Engine::Lazy);
+    EXPECT_EQ((vector<string>{ "Desktop Entry", "Desktop Action new" }), conf->get_groups());
+
+    // The occurrences of a group are merged, and the last duplicate key wins.
+    EXPECT_EQ("Last", conf->get_string("Desktop Entry", "Name"));
+    EXPECT_EQ("Anwendung", conf->get_locale_string("Desktop Entry", "Name", "de"));
+    EXPECT_EQ((vector<string>{ "Name", "Name[de]", "Exec", "Name" }), conf->get_keys("Desktop Entry"));
+
+    // An invalid line is only reported when its group is read.
+    EXPECT_TRUE(conf->has_group("Desktop Action new"));
+    EXPECT_THROW(conf->get_string("Desktop Action new", "Name"), LogicException);
+    string value;
+    EXPECT_FALSE(conf->try_get_string("Desktop Action new", "Name", value));
+    EXPECT_THROW(IniParser::from_data(text, IniParser::Engine::Native), FileException);
+
+    // Anything before the first group is still checked up front.
+    EXPECT_THROW(IniParser::from_data("key = value\n[g]\n", IniParser::Engine::Lazy), FileException);
+    EXPECT_THROW(IniParser::from_data("[g\n", IniParser::Engine::Lazy), FileException);
+
+    // Concurrent first reads of the same group parse it once.
+    auto many = IniParser::from_data("[a]\nk = 1\n[b]\nk = 2\n", IniParser::Engine::Lazy);
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&many] { EXPECT_EQ(2, many->get_int("b", "k")); });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    // Writes work as for the native engine.
+    many->set_int("a", "k", 10);
+    EXPECT_EQ(10, many->get_int("a", "k"));
+    EXPECT_EQ(2, many->get_int("b", "k"));
+}
+
+TEST(IniParser, sharedNames)
+{
+    IniParser plain(INI_FILE, IniParser::Engine::Native);
+
+    IniParser::share_names(true);
+    IniParser shared(INI_FILE, IniParser::Engine::Native);
+    auto stats = IniParser::shared_name_stats();
+    EXPECT_GT(stats.names, 0u);
+    EXPECT_GT(stats.bytes, 0u);
+
+    // A second parser with the same names adds nothing to the table.
+    IniParser shared2(INI_FILE, IniParser::Engine::Native);
+    EXPECT_EQ(stats.names, IniParser::shared_name_stats().names);
+
+    EXPECT_EQ(plain.get_start_group(), shared.get_start_group());
+    EXPECT_EQ(plain.get_groups(), shared.get_groups());
+    for (auto const& group : plain.get_groups())
+    {
+        EXPECT_EQ(plain.get_keys(group), shared.get_keys(group));
+        for (auto const& key : plain.get_keys(group))
+        {
+            EXPECT_EQ(plain.get_string_or(group, key, "?"), shared.get_string_or(group, key, "?")) << key;
+        }
+    }
+    EXPECT_EQ("mundo", shared.get_locale_string("first", "locstring", "pt_BR"));
+    EXPECT_EQ(plain.get_int_array("second", "intarray"), shared.get_int_array("second", "intarray"));
+
+    // Writes start from the rebuilt text; sync() keeps the comments of the file.
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("# comment\n[g]\nk = 1\n", f);
+        fclose(f);
+    }
+    IniParser conf(INI_TEMP_FILE, IniParser::Engine::Native);
+    conf.set_int("g", "k2", 2);
+    EXPECT_EQ(1, conf.get_int("g", "k"));
+    conf.sync();
+    EXPECT_EQ("# comment\n[g]\nk = 1\nk2=2\n", read_text_file(INI_TEMP_FILE));
+
+    IniParser::share_names(false);
+}
+
+TEST(IniParser, manyGroups)
+{
+    // Groups are found through a hash index, including groups whose headers appear more than once.
+    string text;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int g = 0; g < 5000; ++g)
+        {
+            text += "[group" + to_string(g) + "]\nkey" + to_string(pass) + " = " + to_string(g) + "\n";
+        }
+    }
+    for (auto engine : { IniParser::Engine::Native, IniParser::Engine::Lazy })
+    {
+        auto conf = IniParser::from_data(text, engine);
+        EXPECT_EQ(5000u, conf->get_groups().size());
+        EXPECT_EQ("group0", conf->get_start_group());
+        for (int g = 0; g < 5000; g += 7)
+        {
+            string group = "group" + to_string(g);
+            EXPECT_EQ((vector<string>{ "key0", "key1" }), conf->get_keys(group));
+            EXPECT_EQ(g, conf->get_int(group, "key1"));
+        }
+        EXPECT_FALSE(conf->has_group("group5000"));
+    }
+}
+
+TEST(IniParser, nativeEngineWrite)
+{
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("[g1]\nk1 = v1\n", f);
+        fclose(f);
+    }
+
+    IniParser conf(INI_TEMP_FILE, IniParser::Engine::Native);
+    EXPECT_NO_THROW(conf.sync());
+    EXPECT_EQ("v1", conf.get_string("g1", "k1"));
+
+    conf.set_int("g1", "k2", 42);
+    EXPECT_EQ("v1", conf.get_string("g1", "k1"));
+    EXPECT_EQ(42, conf.get_int("g1", "k2"));
+    conf.sync();
+
+    IniParser conf2(INI_TEMP_FILE, IniParser::Engine::Native);
+    EXPECT_EQ("v1", conf2.get_string("g1", "k1"));
+    EXPECT_EQ(42, conf2.get_int("g1", "k2"));
+}
+
+TEST(IniParser, fromData)
+{
+    string text = read_text_file(INI_FILE);
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        auto conf = IniParser::from_data(text, engine);
+        EXPECT_EQ("hello", conf->get_string("first", "stringvalue"));
+        EXPECT_EQ(2, conf->get_int("second", "intvalue"));
+        EXPECT_EQ("mundo", conf->get_locale_string("first", "locstring", "pt_BR"));
+
+        conf = IniParser::from_data(text.data(), text.size(), engine);
+        EXPECT_EQ("hello", conf->get_string("first", "stringvalue"));
+
+        // Nothing to sync to.
+        EXPECT_NO_THROW(conf->sync());
+        conf->set_int("first", "intvalue", 7);
+        EXPECT_EQ(7, conf->get_int("first", "intvalue"));
+        EXPECT_THROW(conf->sync(), LogicException);
+
+        EXPECT_THROW(IniParser::from_data(string("not an ini file"), engine), FileException);
+    }
+}
+
+TEST(IniParser, fromFd)
+{
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        int fd = open(INI_FILE, O_RDONLY);
+        ASSERT_NE(-1, fd);
+        auto conf = IniParser::from_fd(fd, engine);
+        close(fd);
+        EXPECT_EQ("hello", conf->get_string("first", "stringvalue"));
+        EXPECT_EQ((vector<int>{4, 5, 6, 78, 8, 9, 9, 345, 3}), conf->get_int_array("second", "intarray"));
+
+        int fds[2];
+        ASSERT_EQ(0, pipe(fds));
+        string text = "[g]\nk = v\n";
+        ASSERT_EQ(ssize_t(text.size()), write(fds[1], text.data(), text.size()));
+        close(fds[1]);
+        conf = IniParser::from_fd(fds[0], engine);
+        close(fds[0]);
+        EXPECT_EQ("v", conf->get_string("g", "k"));
+
+        EXPECT_THROW(IniParser::from_fd(-1, engine), FileException);
+    }
+}
+
+TEST(IniParser, nonThrowingQueries)
+{
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        IniParser conf(INI_FILE, engine);
+
+        string s = "unchanged";
+        EXPECT_TRUE(conf.try_get_string("first", "stringvalue", s));
+        EXPECT_EQ("hello", s);
+        s = "unchanged";
+        EXPECT_FALSE(conf.try_get_string("first", "missingvalue", s));
+        EXPECT_FALSE(conf.try_get_string("nonexisting", "stringvalue", s));
+        EXPECT_EQ("unchanged", s);
+
+        EXPECT_TRUE(conf.try_get_locale_string("first", "locstring", s, "pt_BR"));
+        EXPECT_EQ("mundo", s);
+        EXPECT_FALSE(conf.try_get_locale_string("first", "missingvalue", s, "pt_BR"));
+        EXPECT_FALSE(conf.try_get_locale_string("nonexisting", "locstring", s));
+
+        int i = -1;
+        EXPECT_TRUE(conf.try_get_int("first", "intvalue", i));
+        EXPECT_EQ(1, i);
+        i = -1;
+        EXPECT_FALSE(conf.try_get_int("first", "doublevalue", i));
+        EXPECT_FALSE(conf.try_get_int("first", "missingvalue", i));
+        EXPECT_EQ(-1, i);
+
+        bool b = true;
+        EXPECT_TRUE(conf.try_get_boolean("second", "boolvalue", b));
+        EXPECT_FALSE(b);
+        EXPECT_FALSE(conf.try_get_boolean("first", "stringvalue", b));
+
+        double d = 0;
+        EXPECT_TRUE(conf.try_get_double("first", "doublevalue", d));
+        EXPECT_EQ(2.345, d);
+        EXPECT_FALSE(conf.try_get_double("first", "stringvalue", d));
+
+        vector<int> ints;
+        EXPECT_TRUE(conf.try_get_int_array("second", "intarray", ints));
+        EXPECT_EQ(9u, ints.size());
+        ints = {42};
+        EXPECT_FALSE(conf.try_get_int_array("first", "array", ints));
+        EXPECT_EQ(vector<int>{42}, ints);
+
+        vector<string> strings;
+        EXPECT_TRUE(conf.try_get_string_array("first", "array", strings));
+        EXPECT_EQ((vector<string>{"foo", "bar", "baz"}), strings);
+        EXPECT_TRUE(conf.try_get_locale_string_array("first", "locstringarray", strings, "pt_BR"));
+        EXPECT_EQ((vector<string>{"x", "y", "z"}), strings);
+        EXPECT_FALSE(conf.try_get_locale_string_array("first", "locstringarray", strings, "de_DE"));
+        EXPECT_FALSE(conf.try_get_locale_string_array("first", "missingvalue", strings, "pt_BR"));
+        EXPECT_EQ((vector<string>{"x", "y", "z"}), strings);
+        EXPECT_FALSE(conf.try_get_string_array("nonexisting", "array", strings));
+
+        vector<bool> bools;
+        EXPECT_TRUE(conf.try_get_boolean_array("first", "boolarray", bools));
+        EXPECT_EQ((vector<bool>{true, false, false}), bools);
+        EXPECT_FALSE(conf.try_get_boolean_array("first", "array", bools));
+
+        vector<double> doubles;
+        EXPECT_TRUE(conf.try_get_double_array("second", "doublearray", doubles));
+        EXPECT_EQ((vector<double>{4.5, 6.78, 9, 10.11}), doubles);
+        EXPECT_FALSE(conf.try_get_double_array("second", "missingvalue", doubles));
+
+        EXPECT_EQ("hello", conf.get_string_or("first", "stringvalue", "default"));
+        EXPECT_EQ("default", conf.get_string_or("first", "missingvalue", "default"));
+        EXPECT_EQ("mundo", conf.get_locale_string_or("first", "locstring", "default", "pt_BR"));
+        EXPECT_EQ("default", conf.get_locale_string_or("nonexisting", "locstring", "default", "pt_BR"));
+        EXPECT_EQ(1, conf.get_int_or("first", "intvalue", 99));
+        EXPECT_EQ(99, conf.get_int_or("first", "missingvalue", 99));
+        EXPECT_EQ(99, conf.get_int_or("first", "stringvalue", 99));
+        EXPECT_TRUE(conf.get_boolean_or("first", "boolvalue", false));
+        EXPECT_TRUE(conf.get_boolean_or("nonexisting", "boolvalue", true));
+        EXPECT_EQ(2.345, conf.get_double_or("first", "doublevalue", 1.5));
+        EXPECT_EQ(1.5, conf.get_double_or("first", "missingvalue", 1.5));
+
+        EXPECT_EQ((vector<string>{"a", "b", "c"}), conf.get_string_array_or("first", "stringarray", {}));
+        EXPECT_EQ(vector<string>{"d"}, conf.get_string_array_or("first", "missingvalue", {"d"}));
+        EXPECT_EQ((vector<string>{"x", "y", "z"}),
+                  conf.get_locale_string_array_or("first", "locstringarray", {}, "pt_BR"));
+        EXPECT_EQ(vector<bool>{true}, conf.get_boolean_array_or("first", "array", {true}));
+        EXPECT_EQ(vector<int>{7}, conf.get_int_array_or("second", "doublearray", {7}));
+        EXPECT_EQ(vector<double>{0.5}, conf.get_double_array_or("second", "missingvalue", {0.5}));
+    }
+}
+
+TEST(IniParser, enumeration)
+{
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native, IniParser::Engine::Lazy })
+    {
+        IniParser conf(INI_FILE, engine);
+
+        vector<string> groups;
+        conf.for_each_group([&groups](const char* name, size_t size)
+        {
+            groups.emplace_back(name, size);
+            return true;
+        });
+        EXPECT_EQ(conf.get_groups(), groups);
+
+        for (auto const& group : groups)
+        {
+            vector<string> keys;
+            conf.for_each_key(group, [&keys](const char* name, size_t size)
+            {
+                keys.emplace_back(name, size);
+                return true;
+            });
+            EXPECT_EQ(conf.get_keys(group), keys);
+        }
+
+        // Returning false stops the enumeration.
+        int calls = 0;
+        conf.for_each_group([&calls](const char*, size_t) { return ++calls < 1; });
+        EXPECT_EQ(1, calls);
+        calls = 0;
+        conf.for_each_key(groups[0], [&calls](const char*, size_t) { return ++calls < 2; });
+        EXPECT_EQ(2, calls);
+
+        EXPECT_THROW(conf.for_each_key("missing", [](const char*, size_t) { return true; }), LogicException);
+    }
+}
+
+TEST(IniParser, keyHandles)
+{
+    const IniKey intvalue("first", "intvalue");
+    const IniKey locstring("first", "locstring");
+    const IniKey missing_key("first", "missingvalue");
+    const IniKey missing_group("nonexisting", "intvalue");
+
+    EXPECT_EQ("first", intvalue.group());
+    EXPECT_EQ("intvalue", intvalue.key());
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        // The same handles work with any parser.
+        IniParser conf(INI_FILE, engine);
+        IniParser other(INI_FILE, engine);
+
+        EXPECT_TRUE(conf.has_key(intvalue));
+        EXPECT_FALSE(conf.has_key(missing_key));
+        EXPECT_THROW(conf.has_key(missing_group), LogicException);
+
+        EXPECT_EQ(1, conf.get_int(intvalue));
+        EXPECT_EQ(1, other.get_int(intvalue));
+        EXPECT_EQ("1", conf.get_string(intvalue));
+        EXPECT_EQ(2.345, conf.get_double(IniKey("first", "doublevalue")));
+        EXPECT_TRUE(conf.get_boolean(IniKey("first", "boolvalue")));
+        EXPECT_EQ("mundo", conf.get_locale_string(locstring, "pt_BR"));
+        EXPECT_EQ("world", conf.get_locale_string(locstring, "no_DF"));
+
+        try
+        {
+            conf.get_string(missing_key);
+            FAIL();
+        }
+        catch (const LogicException& e)
+        {
+            EXPECT_NE(string::npos, string(e.what()).find("unity::LogicException: Could not get string value"));
+        }
+        EXPECT_THROW(conf.get_int(missing_group), LogicException);
+        EXPECT_THROW(conf.get_boolean(locstring), LogicException);
+
+        int i = 42;
+        EXPECT_FALSE(conf.try_get_int(missing_key, i));
+        EXPECT_FALSE(conf.try_get_int(locstring, i));
+        EXPECT_EQ(42, i);
+        EXPECT_TRUE(conf.try_get_int(intvalue, i));
+        EXPECT_EQ(1, i);
+
+        string s;
+        EXPECT_TRUE(conf.try_get_string(intvalue, s));
+        EXPECT_EQ("1", s);
+        EXPECT_TRUE(conf.try_get_locale_string(locstring, s, "pt_BR"));
+        EXPECT_EQ("mundo", s);
+        EXPECT_FALSE(conf.try_get_locale_string(missing_group, s));
+
+        bool b = false;
+        double d = 0;
+        EXPECT_TRUE(conf.try_get_boolean(IniKey("first", "boolvalue"), b));
+        EXPECT_TRUE(b);
+        EXPECT_TRUE(conf.try_get_double(IniKey("first", "doublevalue"), d));
+        EXPECT_EQ(2.345, d);
+
+        // After a write, the native engine hands over to GKeyFile; handles keep working.
+        conf.set_int("first", "intvalue", 7);
+        EXPECT_EQ(7, conf.get_int(intvalue));
+    }
+}
+
+TEST(IniParser, localeTables)
+{
+    const IniLocale de("de_DE.UTF-8@euro");
+    EXPECT_EQ("de_DE.UTF-8@euro", de.name());
+    ASSERT_EQ(8u, de.variants().size());
+    EXPECT_EQ("de_DE.UTF-8@euro", de.variants().front());
+    EXPECT_EQ("de", de.variants().back());
+    EXPECT_FALSE(IniLocale().variants().empty());
+
+    const string text = "[g]\n"
+                        "Name = Name\n"
+                        "Name[de] = Name de\n"
+                        "Name[de_DE] = Name de_DE\n"
+                        "Name[fr] = Nom\n"
+                        "List = a;b\n"
+                        "List[de] = c;d\n"
+                        "Plain = plain\n";
+    const IniLocale fr("fr_FR");
+    const IniLocale pt("pt_BR");
+    const IniKey name("g", "Name");
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        auto conf = IniParser::from_data(text, engine);
+
+        // The results match those for the locale name.
+        for (auto const& locale : { de, fr, pt })
+        {
+            EXPECT_EQ(conf->get_locale_string("g", "Name", locale.name()), conf->get_locale_string("g", "Name", locale));
+            EXPECT_EQ(conf->get_locale_string_array("g", "List", locale.name()),
+                      conf->get_locale_string_array("g", "List", locale));
+        }
+        EXPECT_EQ("Name de_DE", conf->get_locale_string("g", "Name", de));
+        EXPECT_EQ("Nom", conf->get_locale_string(name, fr));
+        EXPECT_EQ("Name", conf->get_locale_string(name, pt));
+        EXPECT_EQ("plain", conf->get_locale_string("g", "Plain", de));
+        EXPECT_EQ((vector<string>{ "c", "d" }), conf->get_locale_string_array("g", "List", de));
+        EXPECT_EQ((vector<string>{ "a", "b" }), conf->get_locale_string_array("g", "List", fr));
+
+        EXPECT_THROW(conf->get_locale_string("g", "missing", de), LogicException);
+        EXPECT_THROW(conf->get_locale_string("missing", "Name", de), LogicException);
+        EXPECT_THROW(conf->get_locale_string_array("g", "missing", de), LogicException);
+        EXPECT_THROW(conf->get_locale_string(IniKey("missing", "Name"), de), LogicException);
+
+        string s = "unchanged";
+        vector<string> v;
+        EXPECT_FALSE(conf->try_get_locale_string("g", "missing", s, de));
+        EXPECT_FALSE(conf->try_get_locale_string("missing", "Name", s, de));
+        EXPECT_FALSE(conf->try_get_locale_string(IniKey("g", "missing"), s, de));
+        EXPECT_FALSE(conf->try_get_locale_string_array("g", "missing", v, de));
+        EXPECT_EQ("unchanged", s);
+        EXPECT_TRUE(v.empty());
+        EXPECT_TRUE(conf->try_get_locale_string("g", "Name", s, fr));
+        EXPECT_EQ("Nom", s);
+        EXPECT_TRUE(conf->try_get_locale_string(name, s, de));
+        EXPECT_EQ("Name de_DE", s);
+        EXPECT_TRUE(conf->try_get_locale_string_array("g", "List", v, de));
+        EXPECT_EQ((vector<string>{ "c", "d" }), v);
+
+        // Translations of names too long for the stack buffer are found as well.
+        const string long_key(300, 'k');
+        auto long_conf = IniParser::from_data("[g]\n" + long_key + "[de] = lang\n", engine);
+        EXPECT_EQ("lang", long_conf->get_locale_string("g", long_key, de));
+        EXPECT_TRUE(long_conf->try_get_locale_string("g", long_key, s, de));
+        EXPECT_FALSE(long_conf->try_get_locale_string("g", long_key, s, fr));
+    }
+}
+
+TEST(IniParser, bufferArrays)
+{
+    const string text = "[g]\n"
+                        "ints = 1;2;3;\n"
+                        "doubles = 1.5;\\s2.5\n"
+                        "bools = true;false;1\n"
+                        "empty =\n"
+                        "bad = 1;x;3\n";
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        auto conf = IniParser::from_data(text, engine);
+
+        int ints[4] = { 0, 0, 0, 42 };
+        EXPECT_EQ(3u, conf->get_int_array("g", "ints", ints, 4));
+        EXPECT_EQ(1, ints[0]);
+        EXPECT_EQ(2, ints[1]);
+        EXPECT_EQ(3, ints[2]);
+        EXPECT_EQ(42, ints[3]);
+        EXPECT_EQ(conf->get_int_array("g", "ints"), vector<int>(ints, ints + 3));
+
+        // A list that does not fit reports its full size.
+        int small[2] = { 0, 0 };
+        EXPECT_EQ(3u, conf->get_int_array("g", "ints", small, 2));
+        EXPECT_EQ(2, small[1]);
+        EXPECT_EQ(3u, conf->get_int_array("g", "ints", nullptr, 0));
+
+        double doubles[2];
+        EXPECT_EQ(2u, conf->get_double_array("g", "doubles", doubles, 2));
+        EXPECT_EQ(1.5, doubles[0]);
+        EXPECT_EQ(2.5, doubles[1]);
+
+        bool bools[3];
+        EXPECT_EQ(3u, conf->get_boolean_array("g", "bools", bools, 3));
+        EXPECT_TRUE(bools[0]);
+        EXPECT_FALSE(bools[1]);
+        EXPECT_TRUE(bools[2]);
+
+        EXPECT_EQ(0u, conf->get_int_array("g", "empty", ints, 4));
+
+        // Elements that do not fit are still validated.
+        EXPECT_THROW(conf->get_int_array("g", "bad", small, 1), LogicException);
+        EXPECT_THROW(conf->get_int_array("g", "missing", ints, 4), LogicException);
+        EXPECT_THROW(conf->get_double_array("missing", "ints", doubles, 2), LogicException);
+        EXPECT_THROW(conf->get_boolean_array("g", "ints", bools, 3), LogicException);
+
+        size_t count = 99;
+        EXPECT_FALSE(conf->try_get_int_array("g", "bad", ints, 4, count));
+        EXPECT_FALSE(conf->try_get_int_array("g", "missing", ints, 4, count));
+        EXPECT_FALSE(conf->try_get_double_array("missing", "ints", doubles, 2, count));
+        EXPECT_FALSE(conf->try_get_boolean_array("g", "ints", bools, 3, count));
+        EXPECT_EQ(99u, count);
+        EXPECT_TRUE(conf->try_get_int_array("g", "ints", ints, 4, count));
+        EXPECT_EQ(3u, count);
+        EXPECT_TRUE(conf->try_get_double_array("g", "doubles", doubles, 2, count));
+        EXPECT_EQ(2u, count);
+        EXPECT_TRUE(conf->try_get_boolean_array("g", "bools", bools, 3, count));
+        EXPECT_EQ(3u, count);
+    }
+}
+
+TEST(IniParser, batchWrites)
+{
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("[g1]\nk1 = v1\nk2 = 2\n\n[g2]\nk3 = x\n", f);
+        fclose(f);
+    }
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        IniParser conf(INI_TEMP_FILE, engine);
+        auto batch = conf.batch();
+        EXPECT_EQ(0u, batch.size());
+
+        batch.set_string("g1", "k1", "new");
+        batch.set_locale_string("g1", "k1", "neu", "de");
+        batch.set_boolean("g1", "b", true);
+        batch.set_int("g1", "k2", 20);
+        batch.set_double("g1", "d", 1.5);
+        batch.set_string_array("g3", "s", { "a", "b;c" });
+        batch.set_locale_string_array("g3", "s", { "x" }, "fr");
+        batch.set_boolean_array("g3", "b", { true, false });
+        batch.set_int_array("g3", "i", { 1, 2, 3 });
+        batch.set_double_array("g3", "d", { 0.5 });
+        batch.remove_key("g1", "missing");
+        batch.remove_group("missing");
+        batch.remove_group("g2");
+        EXPECT_EQ(13u, batch.size());
+
+        // Nothing is visible before the commit.
+        EXPECT_EQ("v1", conf.get_string("g1", "k1"));
+        EXPECT_FALSE(conf.has_group("g3"));
+
+        batch.commit();
+        EXPECT_EQ(0u, batch.size());
+        EXPECT_EQ("new", conf.get_string("g1", "k1"));
+        EXPECT_EQ("neu", conf.get_locale_string("g1", "k1", "de"));
+        EXPECT_TRUE(conf.get_boolean("g1", "b"));
+        EXPECT_EQ(20, conf.get_int("g1", "k2"));
+        EXPECT_EQ(1.5, conf.get_double("g1", "d"));
+        EXPECT_EQ((vector<string>{ "a", "b;c" }), conf.get_string_array("g3", "s"));
+        EXPECT_EQ((vector<string>{ "x" }), conf.get_locale_string_array("g3", "s", "fr"));
+        EXPECT_EQ((vector<bool>{ true, false }), conf.get_boolean_array("g3", "b"));
+        EXPECT_EQ((vector<int>{ 1, 2, 3 }), conf.get_int_array("g3", "i"));
+        EXPECT_EQ((vector<double>{ 0.5 }), conf.get_double_array("g3", "d"));
+        EXPECT_FALSE(conf.has_group("g2"));
+
+        // The file is unchanged until the batch is committed with sync.
+        EXPECT_EQ("v1", IniParser(INI_TEMP_FILE).get_string("g1", "k1"));
+        batch.set_int("g1", "k2", 21);
+        batch.commit(true);
+        {
+            IniParser other(INI_TEMP_FILE);
+            EXPECT_EQ("new", other.get_string("g1", "k1"));
+            EXPECT_EQ(21, other.get_int("g1", "k2"));
+            EXPECT_FALSE(other.has_group("g2"));
+        }
+
+        // A batch that is not committed changes nothing.
+        {
+            auto discarded = conf.batch();
+            discarded.set_int("g1", "k2", 99);
+            auto moved = move(discarded);
+            moved.set_int("g1", "k3", 99);
+            EXPECT_EQ(2u, moved.size());
+            moved.clear();
+            moved.commit();
+            auto other = conf.batch();
+            other.set_int("g1", "k2", 98);
+        }
+        EXPECT_EQ(21, conf.get_int("g1", "k2"));
+        EXPECT_FALSE(conf.has_key("g1", "k3"));
+
+        // Restore the file for the next engine.
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("[g1]\nk1 = v1\nk2 = 2\n\n[g2]\nk3 = x\n", f);
+        fclose(f);
+    }
+
+    // A sync that fails is reported, but the changes are applied.
+    auto conf = IniParser::from_data("[g]\nk = 1\n");
+    auto batch = conf->batch();
+    batch.set_int("g", "k", 2);
+    EXPECT_THROW(batch.commit(true), LogicException);
+    EXPECT_EQ(2, conf->get_int("g", "k"));
+}
+
+TEST(IniParser, snapshots)
+{
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        auto conf = IniParser::from_data("[g]\nk = 1\nName[de] = Hallo\n", engine);
+        auto s1 = conf->snapshot();
+        EXPECT_EQ(s1, conf->snapshot());
+        EXPECT_EQ(1, s1->get_int("g", "k"));
+        EXPECT_EQ("Hallo", s1->get_locale_string("g", "Name", "de"));
+
+        // Changes publish a new snapshot; older ones stay as they were.
+        conf->set_int("g", "k", 2);
+        auto s2 = conf->snapshot();
+        EXPECT_NE(s1, s2);
+        EXPECT_EQ(1, s1->get_int("g", "k"));
+        EXPECT_EQ(2, s2->get_int("g", "k"));
+
+        conf->remove_key("g", "Name[de]");
+        EXPECT_TRUE(s2->has_key("g", "Name[de]"));
+        EXPECT_FALSE(conf->snapshot()->has_key("g", "Name[de]"));
+
+        // A batch publishes once.
+        auto batch = conf->batch();
+        batch.set_int("g", "a", 3);
+        batch.set_int("g", "b", 3);
+        batch.commit();
+        auto s3 = conf->snapshot();
+        EXPECT_EQ(3, s3->get_int("g", "a"));
+        EXPECT_EQ(3, s3->get_int("g", "b"));
+        EXPECT_THROW(s3->get_int("g", "missing"), LogicException);
+    }
+
+    // Reloads publish too.
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("[g]\nk = 1\n", f);
+        fclose(f);
+    }
+    IniParser conf(INI_TEMP_FILE, IniParser::Engine::Native);
+    auto before = conf.snapshot();
+    {
+        string tmp = INI_TEMP_FILE ".tmp";
+        auto f = fopen(tmp.c_str(), "w");
+        fputs("[g]\nk = 2\n", f);
+        fclose(f);
+        rename(tmp.c_str(), INI_TEMP_FILE);
+    }
+    EXPECT_TRUE(conf.reload());
+    EXPECT_EQ(1, before->get_int("g", "k"));
+    EXPECT_EQ(2, conf.snapshot()->get_int("g", "k"));
+
+    // Readers always see the keys of a batch together, while a writer keeps changing them.
+    atomic<bool> done(false);
+    thread writer([&]
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            auto batch = conf.batch();
+            batch.set_int("g", "x", i);
+            batch.set_int("g", "y", i);
+            batch.commit();
+        }
+        done = true;
+    });
+    while (!done)
+    {
+        auto s = conf.snapshot();
+        EXPECT_EQ(s->get_int_or("g", "x", -1), s->get_int_or("g", "y", -1));
+    }
+    writer.join();
+    EXPECT_EQ(199, conf.snapshot()->get_int("g", "y"));
+}
+
+namespace
+{
+
+// Records every callback as a line of text.
+class RecordingVisitor : public IniVisitor
+{
+public:
+    vector<string> events;
+    size_t stop_after = size_t(-1);
+
+    bool group(const string& group) override
+    {
+        events.push_back("[" + group + "]");
+        return events.size() < stop_after;
+    }
+
+    bool key_value(const string& group, const string& key, const string& value) override
+    {
+        events.push_back(group + "/" + key + "=" + value);
+        return events.size() < stop_after;
+    }
+
+    bool comment(const string& text) override
+    {
+        events.push_back("#" + text);
+        return events.size() < stop_after;
+    }
+};
+
+}
+
+TEST(IniParser, visit)
+{
+    auto write_text = [](const string& text)
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+    };
+    write_text("# Top\n"
+               "[g1]\n"
+               "k1 = v1\n"
+               "\n"
+               "  k2=a\\sb;c;\r\n"
+               "[g2]\n"
+               "#comment  \n"
+               "k3 =\n"
+               "[g1]\n"
+               "k1 = again");
+    const vector<string> expected = { "# Top", "[g1]", "g1/k1=v1", "g1/k2=a\\sb;c;", "[g2]",
+                                      "#comment  ", "g2/k3=", "[g1]", "g1/k1=again" };
+
+    // The result does not depend on where the chunks end.
+    for (size_t chunk_size : { size_t(1), size_t(3), size_t(7), size_t(64 * 1024) })
+    {
+        RecordingVisitor v;
+        IniParser::visit(INI_TEMP_FILE, v, chunk_size);
+        EXPECT_EQ(expected, v.events) << "chunk size " << chunk_size;
+    }
+
+    // The default callbacks do nothing.
+    IniVisitor nothing;
+    IniParser::visit(INI_FILE, nothing);
+
+    // Returning false stops the scan.
+    {
+        RecordingVisitor v;
+        v.stop_after = 3;
+        IniParser::visit(INI_TEMP_FILE, v, 4);
+        EXPECT_EQ(vector<string>(expected.begin(), expected.begin() + 3), v.events);
+    }
+
+    // Errors are reported after the lines before the error.
+    write_text("[g]\nk = v\nnot a key\n");
+    {
+        RecordingVisitor v;
+        try
+        {
+            IniParser::visit(INI_TEMP_FILE, v);
+            FAIL();
+        }
+        catch (const FileException& e)
+        {
+            EXPECT_NE(string::npos, string(e.what()).find("not a key-value pair"));
+        }
+        EXPECT_EQ((vector<string>{ "[g]", "g/k=v" }), v.events);
+    }
+    write_text("k = v\n[g]\n");
+    {
+        RecordingVisitor v;
+        EXPECT_THROW(IniParser::visit(INI_TEMP_FILE, v), FileException);
+    }
+    {
+        RecordingVisitor v;
+        EXPECT_THROW(IniParser::visit("no_such_file", v), FileException);
+    }
+}
+
+TEST(IniParser, syncAsync)
+{
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("[g1]\nk1 = 0\n", f);
+        fclose(f);
+    }
+
+    {
+        IniParser conf(INI_TEMP_FILE);
+
+        // Nothing is written before the delay expires or flush() is called.
+        for (int i = 1; i <= 100; ++i)
+        {
+            conf.set_int("g1", "k1", i);
+            conf.sync_async(chrono::hours(1));
+        }
+        EXPECT_EQ(0, IniParser(INI_TEMP_FILE).get_int("g1", "k1"));
+
+        conf.flush();
+        EXPECT_EQ(100, IniParser(INI_TEMP_FILE).get_int("g1", "k1"));
+
+        // Nothing pending.
+        EXPECT_NO_THROW(conf.flush());
+
+        // The write happens by itself once the delay expires.
+        conf.set_int("g1", "k1", 200);
+        conf.sync_async(chrono::milliseconds(10));
+        int value = 0;
+        for (int i = 0; i < 500 && value != 200; ++i)
+        {
+            this_thread::sleep_for(chrono::milliseconds(10));
+            value = IniParser(INI_TEMP_FILE).get_int("g1", "k1");
+        }
+        EXPECT_EQ(200, value);
+
+        // The destructor completes a pending write.
+        conf.set_int("g1", "k1", 300);
+        conf.sync_async(chrono::hours(1));
+    }
+    EXPECT_EQ(300, IniParser(INI_TEMP_FILE).get_int("g1", "k1"));
+
+    // Data without a file: the changes made after scheduling the write cannot be saved.
+    auto conf = IniParser::from_data(string("[g1]\nk1 = 0\n"));
+    EXPECT_NO_THROW(conf->sync_async());
+    conf->set_int("g1", "k1", 7);
+    EXPECT_THROW(conf->sync_async(), LogicException);
+    EXPECT_THROW(conf->flush(), LogicException);
+}
+
+TEST(IniParser, syncAsyncError)
+{
+    auto f = fopen(INI_TEMP_FILE, "w");
+    fclose(f);
+
+    IniParser conf(INI_TEMP_FILE);
+
+    ASSERT_EQ(0, remove(INI_TEMP_FILE));
+    ASSERT_EQ(0, mkdir(INI_TEMP_FILE, 0700));
+
+    std::shared_ptr<void> rmdir_raii(nullptr, [](void*)
+    {
+        rmdir(INI_TEMP_FILE);
+    });
+
+    conf.set_boolean("g1", "k1", true);
+    conf.sync_async(chrono::hours(1));
+    EXPECT_THROW(conf.flush(), FileException);
+
+    // The error is reported once, and the changes are still unsaved.
+    EXPECT_NO_THROW(conf.flush());
+    EXPECT_THROW(conf.sync(), FileException);
+}
+
+TEST(IniParser, syncRewritesOnlyChanges)
+{
+    const string original =
+        "# Settings\n"
+        "[g1]\n"
+        "k1 = v1\n"
+        "k2   =   2\n"
+        "\n"
+        "# The second group\n"
+        "[g2]\n"
+        "k3 = a;b;c;\n"
+        "k4 = gone\n";
+    auto write_text = [](const string& text)
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+    };
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        write_text(original);
+
+        IniParser conf(INI_TEMP_FILE, engine);
+        conf.set_int("g1", "k2", 42);
+        conf.set_locale_string("g1", "k1", "v1 de", "de");
+        conf.remove_key("g2", "k4");
+        conf.set_boolean("g3", "k5", true);
+        conf.sync();
+
+        EXPECT_EQ("# Settings\n"
+                  "[g1]\n"
+                  "k1 = v1\n"
+                  "k2   =   42\n"
+                  "k1[de]=v1 de\n"
+                  "\n"
+                  "# The second group\n"
+                  "[g2]\n"
+                  "k3 = a;b;c;\n"
+                  "\n"
+                  "[g3]\n"
+                  "k5=true\n",
+                  read_text_file(INI_TEMP_FILE));
+
+        // Removing and recreating a group replaces it in place.
+        conf.remove_group("g1");
+        conf.set_string("g1", "k6", "x");
+        conf.sync();
+        EXPECT_EQ("# Settings\n"
+                  "[g1]\n"
+                  "k6=x\n"
+                  "\n"
+                  "# The second group\n"
+                  "[g2]\n"
+                  "k3 = a;b;c;\n"
+                  "\n"
+                  "[g3]\n"
+                  "k5=true\n",
+                  read_text_file(INI_TEMP_FILE));
+
+        // If the file was replaced behind our back, all of the parser's data is written.
+        write_text("[other]\nk=v\n");
+        conf.set_int("g2", "k7", 7);
+        conf.sync();
+        IniParser check(INI_TEMP_FILE);
+        EXPECT_FALSE(check.has_group("other"));
+        EXPECT_EQ("x", check.get_string("g1", "k6"));
+        EXPECT_EQ(7, check.get_int("g2", "k7"));
+        EXPECT_EQ((vector<string>{"a", "b", "c"}), check.get_string_array("g2", "k3"));
+    }
+}
+
+TEST(IniParser, reload)
+{
+    auto write_text = [](const string& text)
+    {
+        // Replace the file, so its identity changes even if the size and time stamp do not.
+        string tmp = INI_TEMP_FILE ".tmp";
+        auto f = fopen(tmp.c_str(), "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+        rename(tmp.c_str(), INI_TEMP_FILE);
+    };
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        write_text("[g1]\nk1 = 1\nk2 = 2\n[g2]\nk3 = 3\n");
+        IniParser conf(INI_TEMP_FILE, engine);
+
+        vector<IniParser::Changes> seen;
+        unsigned id = conf.add_change_callback([&seen](const IniParser::Changes& c) { seen.push_back(c); });
+
+        // Nothing changed.
+        EXPECT_FALSE(conf.reload());
+        EXPECT_TRUE(seen.empty());
+
+        write_text("[g1]\nk1 = 1\nk2 = two\nk4 = 4\n[g3]\nk5 = 5\n");
+        EXPECT_TRUE(conf.reload());
+        ASSERT_EQ(1u, seen.size());
+        auto const& c = seen[0];
+        EXPECT_EQ(vector<string>{"g3"}, c.added_groups);
+        EXPECT_EQ(vector<string>{"g2"}, c.removed_groups);
+        EXPECT_EQ((vector<pair<string, string>>{{"g1", "k4"}, {"g3", "k5"}}), c.added_keys);
+        EXPECT_EQ((vector<pair<string, string>>{{"g2", "k3"}}), c.removed_keys);
+        EXPECT_EQ((vector<pair<string, string>>{{"g1", "k2"}}), c.changed_keys);
+        EXPECT_EQ("two", conf.get_string("g1", "k2"));
+        EXPECT_FALSE(conf.has_group("g2"));
+
+        // Our own writes do not cause a reload.
+        conf.set_int("g1", "k1", 10);
+        conf.sync();
+        EXPECT_FALSE(conf.reload());
+
+        // A reload keeps unsaved changes on top of the new contents, and reports
+        // differences against what the parser held, unsaved changes included.
+        conf.set_int("g1", "k1", 20);
+        conf.remove_key("g1", "k4");
+        write_text("[g1]\nk1 = 10\nk2 = 2\nk4 = 4\n");
+        EXPECT_TRUE(conf.reload());
+        EXPECT_EQ(20, conf.get_int("g1", "k1"));
+        EXPECT_EQ(2, conf.get_int("g1", "k2"));
+        EXPECT_FALSE(conf.has_key("g1", "k4"));
+        ASSERT_EQ(2u, seen.size());
+        EXPECT_EQ((vector<pair<string, string>>{{"g1", "k2"}}), seen[1].changed_keys);
+        EXPECT_EQ(vector<string>{"g3"}, seen[1].removed_groups);
+        EXPECT_EQ((vector<pair<string, string>>{{"g3", "k5"}}), seen[1].removed_keys);
+        EXPECT_TRUE(seen[1].added_keys.empty());
+
+        // The kept changes are still unsaved, and sync() writes them into the new file.
+        conf.sync();
+        EXPECT_FALSE(conf.reload());
+        {
+            IniParser written(INI_TEMP_FILE);
+            EXPECT_EQ(20, written.get_int("g1", "k1"));
+            EXPECT_EQ(2, written.get_int("g1", "k2"));
+            EXPECT_FALSE(written.has_key("g1", "k4"));
+        }
+
+        // An invalid file leaves the contents alone.
+        write_text("junk\n");
+        EXPECT_THROW(conf.reload(), FileException);
+        EXPECT_EQ(20, conf.get_int("g1", "k1"));
+
+        conf.remove_change_callback(id);
+        write_text("[g1]\nk1 = 11\n");
+        EXPECT_TRUE(conf.reload());
+        EXPECT_EQ(2u, seen.size());
+    }
+
+    auto conf = IniParser::from_data(string("[g1]\nk1 = 0\n"));
+    EXPECT_THROW(conf->reload(), LogicException);
+    EXPECT_THROW(conf->watch(), LogicException);
+}
+
+TEST(IniParser, watch)
+{
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs("[g1]\nk1 = 1\n", f);
+        fclose(f);
+    }
+
+    IniParser conf(INI_TEMP_FILE, IniParser::Engine::Native);
+
+    mutex m;
+    condition_variable cond;
+    vector<IniParser::Changes> seen;
+    conf.add_change_callback([&](const IniParser::Changes& c)
+    {
+        lock_guard<mutex> lock(m);
+        seen.push_back(c);
+        cond.notify_all();
+    });
+    conf.watch();
+    conf.watch();
+
+    // Another parser writes the file; the watcher picks up the change.
+    {
+        IniParser writer(INI_TEMP_FILE);
+        writer.set_int("g1", "k1", 2);
+        writer.sync();
+    }
+
+    unique_lock<mutex> lock(m);
+    ASSERT_TRUE(cond.wait_for(lock, chrono::seconds(10), [&seen] { return !seen.empty(); }));
+    EXPECT_EQ((vector<pair<string, string>>{{"g1", "k1"}}), seen[0].changed_keys);
+    EXPECT_EQ(2, conf.get_int("g1", "k1"));
+}
+
+TEST(IniParser, loadAll)
+{
+    const string dir = TEST_RUNTIME_PATH "/load_all";
+    auto write_text = [](const string& path, const string& text)
+    {
+        auto f = fopen(path.c_str(), "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+    };
+    mkdir(dir.c_str(), 0700);
+    mkdir((dir + "/sub.desktop").c_str(), 0700);
+    for (int i = 0; i < 20; ++i)
+    {
+        write_text(dir + "/app" + to_string(i) + ".desktop", "[Desktop Entry]\nName=App " + to_string(i) + "\n");
+    }
+    write_text(dir + "/broken.desktop", "no group\n");
+    write_text(dir + "/other.ini", "[g]\nk=v\n");
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native })
+    {
+        for (unsigned threads : { 0u, 1u, 3u })
+        {
+            auto result = IniParser::load_all({ dir, INI_FILE, dir + "/missing", dir + "/app0.desktop" },
+                                              ".desktop", engine, threads);
+            EXPECT_EQ(21u, result.parsers.size());
+            for (int i = 0; i < 20; ++i)
+            {
+                auto const& conf = result.parsers.at(dir + "/app" + to_string(i) + ".desktop");
+                EXPECT_EQ("App " + to_string(i), conf->get_string("Desktop Entry", "Name"));
+            }
+            EXPECT_EQ("hello", result.parsers.at(INI_FILE)->get_string("first", "stringvalue"));
+
+            EXPECT_EQ(2u, result.errors.size());
+            EXPECT_NE(string::npos, result.errors.at(dir + "/broken.desktop").find("Could not load ini file"));
+            EXPECT_NE(string::npos, result.errors.at(dir + "/missing").find("Could not load ini file"));
+        }
+    }
+
+    auto result = IniParser::load_all({ dir });
+    EXPECT_EQ(21u, result.parsers.size());
+    EXPECT_EQ(1u, result.errors.size());
+
+    result = IniParser::load_all({});
+    EXPECT_TRUE(result.parsers.empty());
+    EXPECT_TRUE(result.errors.empty());
+}
+
+TEST(IniParser, compiledCache)
+{
+    const string cache_dir = TEST_RUNTIME_PATH "/ini_cache";
+    auto write_text = [](const string& text)
+    {
+        auto f = fopen(INI_TEMP_FILE, "w");
+        fputs(text.c_str(), f);
+        fclose(f);
+    };
+    auto cache_files = [&cache_dir]
+    {
+        vector<string> files;
+        DIR* d = opendir(cache_dir.c_str());
+        for (struct dirent* e; d && (e = readdir(d));)
+        {
+            if (e->d_name[0] != '.')
+            {
+                files.push_back(cache_dir + "/" + e->d_name);
+            }
+        }
+        if (d)
+        {
+            closedir(d);
+        }
+        return files;
+    };
+    for (auto const& f : cache_files())
+    {
+        unlink(f.c_str());
+    }
+
+    write_text("[g1]\nk1 = one\nk2 = 2\n");
+    {
+        IniParser conf(INI_TEMP_FILE, cache_dir);
+        EXPECT_EQ("one", conf.get_string("g1", "k1"));
+    }
+    ASSERT_EQ(1u, cache_files().size());
+    string cache_file = cache_files()[0];
+
+    // Change the text but keep size, inode, and time stamp: the cache is used as is.
+    struct stat st;
+    ASSERT_EQ(0, stat(INI_TEMP_FILE, &st));
+    write_text("[g1]\nk1 = ONE\nk2 = 2\n");
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    ASSERT_EQ(0, utimensat(AT_FDCWD, INI_TEMP_FILE, times, 0));
+    {
+        IniParser conf(INI_TEMP_FILE, cache_dir);
+        EXPECT_EQ("one", conf.get_string("g1", "k1"));
+        EXPECT_EQ(2, conf.get_int("g1", "k2"));
+        EXPECT_EQ((vector<string>{"k1", "k2"}), conf.get_keys("g1"));
+
+        // Writing works on top of cached data.
+        conf.set_int("g1", "k3", 3);
+        EXPECT_EQ("one", conf.get_string("g1", "k1"));
+        EXPECT_EQ(3, conf.get_int("g1", "k3"));
+    }
+
+    // A corrupt cache is ignored and replaced.
+    {
+        string bytes = read_text_file(cache_file);
+        bytes[bytes.size() - 3] ^= 0x20;
+        auto f = fopen(cache_file.c_str(), "w");
+        fwrite(bytes.data(), 1, bytes.size(), f);
+        fclose(f);
+    }
+    {
+        IniParser conf(INI_TEMP_FILE, cache_dir);
+        EXPECT_EQ("ONE", conf.get_string("g1", "k1"));
+    }
+    {
+        // Truncated.
+        string bytes = read_text_file(cache_file);
+        auto f = fopen(cache_file.c_str(), "w");
+        fwrite(bytes.data(), 1, bytes.size() / 2, f);
+        fclose(f);
+        IniParser conf(INI_TEMP_FILE, cache_dir);
+        EXPECT_EQ("ONE", conf.get_string("g1", "k1"));
+    }
+
+    // A changed file makes the cache stale.
+    write_text("[g1]\nk1 = changed\n[g2]\n");
+    {
+        IniParser conf(INI_TEMP_FILE, cache_dir);
+        EXPECT_EQ("changed", conf.get_string("g1", "k1"));
+        EXPECT_TRUE(conf.has_group("g2"));
+    }
+    {
+        IniParser conf(INI_TEMP_FILE, cache_dir);
+        EXPECT_EQ("changed", conf.get_string("g1", "k1"));
+    }
+    EXPECT_EQ(1u, cache_files().size());
+
+    // Errors are the same as without a cache.
+    EXPECT_THROW(IniParser(TEST_RUNTIME_PATH "/no_such_file.ini", cache_dir), FileException);
+    write_text("junk\n");
+    EXPECT_THROW(IniParser(INI_TEMP_FILE, cache_dir), FileException);
+
+    // An unusable cache directory only costs the caching.
+    IniParser conf(INI_FILE, string("/proc/no_such_dir"));
+    EXPECT_EQ("hello", conf.get_string("first", "stringvalue"));
+}
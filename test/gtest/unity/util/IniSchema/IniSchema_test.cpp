@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+#include <unity/UnityExceptions.h>
+#include <unity/util/IniLayers.h>
+#include <unity/util/IniSchema.h>
+
+using namespace std;
+using namespace unity;
+using namespace unity::util;
+
+namespace
+{
+
+UNITY_INI_KEY(Width, int, "Window", "Width");
+UNITY_INI_KEY(Title, string, "Window", "Title");
+UNITY_INI_KEY(Fullscreen, bool, "Window", "Fullscreen");
+UNITY_INI_KEY(Scale, double, "Window", "Scale");
+UNITY_INI_KEY(Plugins, vector<string>, "Plugins", "Enabled");
+UNITY_INI_KEY(Sizes, vector<int>, "Plugins", "Sizes");
+UNITY_INI_KEY(Missing, int, "Window", "Height");
+
+typedef IniSchema<Width, Title, Fullscreen, Scale, Plugins, Sizes, Missing> Config;
+
+const char* const text =
+    "[Window]\n"
+    "Width = 640\n"
+    "Title = Hello\n"
+    "Fullscreen = maybe\n"
+    "Scale = 1.5\n"
+    "[Plugins]\n"
+    "Enabled = a;b;\n"
+    "Sizes = 1;2;3\n";
+
+}
+
+TEST(IniSchema, basic)
+{
+    static_assert(Config::size() == 7, "unexpected schema size");
+
+    for (auto engine : { IniParser::Engine::GKeyFile, IniParser::Engine::Native, IniParser::Engine::Lazy })
+    {
+        IniParser::UPtr parser(IniParser::from_data(text, engine));
+        Config config(*parser);
+
+        EXPECT_TRUE(config.has<Width>());
+        EXPECT_EQ(640, config.get<Width>());
+        EXPECT_EQ("Hello", config.get<Title>());
+        EXPECT_EQ(1.5, config.get<Scale>());
+        EXPECT_EQ((vector<string>{ "a", "b" }), config.get<Plugins>());
+        EXPECT_EQ((vector<int>{ 1, 2, 3 }), config.get<Sizes>());
+
+        // A value of the wrong type is absent, just like a missing key.
+        EXPECT_FALSE(config.has<Fullscreen>());
+        EXPECT_FALSE(config.has<Missing>());
+        EXPECT_TRUE(config.get_or<Fullscreen>(true));
+        EXPECT_EQ(480, config.get_or<Missing>(480));
+        EXPECT_EQ(640, config.get_or<Width>(1));
+
+        try
+        {
+            config.get<Missing>();
+            FAIL();
+        }
+        catch (LogicException const& e)
+        {
+            EXPECT_STREQ("unity::LogicException: IniSchema::get(): key is missing or does not have "
+                         "the declared type (group: Window, key: Height)",
+                         e.what());
+        }
+    }
+}
+
+TEST(IniSchema, rebind)
+{
+    Config config;
+    EXPECT_FALSE(config.has<Width>());
+    EXPECT_THROW(config.get<Width>(), LogicException);
+
+    IniParser::UPtr parser(IniParser::from_data(text, IniParser::Engine::Native));
+    config.bind(*parser);
+    Config copy(config);
+
+    parser->set_int("Window", "Width", 800);
+    parser->set_int("Window", "Height", 600);
+    parser->remove_key("Window", "Title");
+    EXPECT_EQ(640, config.get<Width>());  // Schemas are not updated until they are bound again.
+
+    config.bind(*parser);
+    EXPECT_EQ(800, config.get<Width>());
+    EXPECT_EQ(600, config.get<Missing>());
+    EXPECT_FALSE(config.has<Title>());
+
+    EXPECT_EQ(640, copy.get<Width>());
+    EXPECT_EQ("Hello", copy.get<Title>());
+}
+
+TEST(IniSchema, layers)
+{
+    IniParser::SPtr user(IniParser::from_data("[Window]\nWidth = 1024\n", IniParser::Engine::Native));
+    IniParser::SPtr system(IniParser::from_data(text, IniParser::Engine::Native));
+    IniLayers layers({ user, system });
+
+    IniSchema<Width, Title> config(layers);
+    EXPECT_EQ(1024, config.get<Width>());
+    EXPECT_EQ("Hello", config.get<Title>());
+}
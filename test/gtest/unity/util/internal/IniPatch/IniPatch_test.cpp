@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unity/util/internal/IniPatch.h>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace unity::util::internal;
+
+namespace
+{
+
+const string text =
+    "# Leading comment\n"
+    "[first]\n"
+    "a = 1\n"
+    "  b=2\n"
+    "\n"
+    "# Comment for second\n"
+    "[second]\n"
+    "c  =  3\n"
+    "c = 4\n"
+    "Name[de] = Hallo\n"
+    "\n"
+    "[first]\n"
+    "d = 5\n";
+
+}
+
+TEST(IniPatch, empty)
+{
+    IniPatch patch;
+    EXPECT_TRUE(patch.empty());
+    EXPECT_EQ(text, patch.apply(text));
+}
+
+TEST(IniPatch, setExisting)
+{
+    IniPatch patch;
+    patch.set_value("first", "b", "20");
+    patch.set_value("second", "c", "40");
+    patch.set_value("second", "Name[de]", "Welt");
+    patch.set_value("first", "d", "");
+    EXPECT_FALSE(patch.empty());
+
+    // Only the values change; the last of duplicate keys is the one that is updated.
+    EXPECT_EQ("# Leading comment\n"
+              "[first]\n"
+              "a = 1\n"
+              "  b=20\n"
+              "\n"
+              "# Comment for second\n"
+              "[second]\n"
+              "c  =  3\n"
+              "c = 40\n"
+              "Name[de] = Welt\n"
+              "\n"
+              "[first]\n"
+              "d = \n",
+              patch.apply(text));
+}
+
+TEST(IniPatch, addKeysAndGroups)
+{
+    IniPatch patch;
+    patch.set_value("second", "e", "6");
+    patch.set_value("first", "f", "7");
+    patch.set_value("third", "g", "8");
+    patch.set_value("second", "h", "9");
+
+    EXPECT_EQ("# Leading comment\n"
+              "[first]\n"
+              "a = 1\n"
+              "  b=2\n"
+              "\n"
+              "# Comment for second\n"
+              "[second]\n"
+              "c  =  3\n"
+              "c = 4\n"
+              "Name[de] = Hallo\n"
+              "e=6\n"
+              "h=9\n"
+              "\n"
+              "[first]\n"
+              "d = 5\n"
+              "f=7\n"
+              "\n"
+              "[third]\n"
+              "g=8\n",
+              patch.apply(text));
+
+    EXPECT_EQ("[g]\nk = v\nk2=v2\n", [] { IniPatch p; p.set_value("g", "k2", "v2"); return p.apply("[g]\nk = v"); }());
+    EXPECT_EQ("[g]\nk=v\n", [] { IniPatch p; p.set_value("g", "k", "v"); return p.apply(""); }());
+}
+
+TEST(IniPatch, removeKeys)
+{
+    IniPatch patch;
+    patch.remove_key("second", "c");
+    patch.remove_key("first", "a");
+    patch.remove_key("first", "missing");
+    patch.remove_key("missing", "a");
+
+    EXPECT_EQ("# Leading comment\n"
+              "[first]\n"
+              "  b=2\n"
+              "\n"
+              "# Comment for second\n"
+              "[second]\n"
+              "Name[de] = Hallo\n"
+              "\n"
+              "[first]\n"
+              "d = 5\n",
+              patch.apply(text));
+
+    // A later set overrides an earlier remove, and vice versa.
+    IniPatch p2;
+    p2.remove_key("first", "a");
+    p2.set_value("first", "a", "10");
+    p2.set_value("first", "d", "50");
+    p2.remove_key("first", "d");
+    EXPECT_EQ("# Leading comment\n"
+              "[first]\n"
+              "a = 10\n"
+              "  b=2\n"
+              "\n"
+              "# Comment for second\n"
+              "[second]\n"
+              "c  =  3\n"
+              "c = 4\n"
+              "Name[de] = Hallo\n"
+              "\n"
+              "[first]\n",
+              p2.apply(text));
+}
+
+TEST(IniPatch, removeGroups)
+{
+    IniPatch patch;
+    patch.remove_group("first");
+    patch.remove_group("missing");
+
+    // Comments that precede the next group stay with it.
+    EXPECT_EQ("# Leading comment\n"
+              "\n"
+              "# Comment for second\n"
+              "[second]\n"
+              "c  =  3\n"
+              "c = 4\n"
+              "Name[de] = Hallo\n"
+              "\n",
+              patch.apply(text));
+
+    // Replacing the contents of a group rewrites its first occurrence in place.
+    IniPatch p2;
+    p2.remove_group("first");
+    p2.set_value("first", "x", "1");
+    p2.remove_group("second");
+    p2.remove_group("third");
+    p2.set_value("third", "y", "2");
+    EXPECT_EQ("# Leading comment\n"
+              "[first]\n"
+              "x=1\n"
+              "\n"
+              "# Comment for second\n"
+              "\n"
+              "\n"
+              "[third]\n"
+              "y=2\n",
+              p2.apply(text));
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 Canonical Ltd
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <unity/util/internal/ParallelFor.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace unity::util::internal;
+
+TEST(ParallelFor, everyIndexOnce)
+{
+    for (size_t threads : { 1, 2, 8, 100 })
+    {
+        vector<atomic<int>> calls(37);  // Value-initialized to 0.
+        parallel_for(calls.size(), threads, [&](size_t i) { ++calls[i]; });
+        for (auto const& c : calls)
+        {
+            EXPECT_EQ(1, c);
+        }
+    }
+}
+
+TEST(ParallelFor, empty)
+{
+    bool called = false;
+    parallel_for(0, 4, [&](size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
+TEST(ParallelFor, exception)
+{
+    atomic<int> calls(0);
+    try
+    {
+        parallel_for(20, 4, [&](size_t i)
+        {
+            ++calls;
+            if (i % 5 == 0)
+            {
+                throw runtime_error("failed");
+            }
+        });
+        FAIL();
+    }
+    catch (runtime_error const& e)
+    {
+        EXPECT_STREQ("failed", e.what());
+    }
+    EXPECT_EQ(20, calls);
+}